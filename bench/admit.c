@@ -0,0 +1,201 @@
+/* ============================ BEG CONFIG ================================ */
+
+#define DEFAULT_NUM_PROCS 32
+
+#define DEFAULT_NUM_ITERS 100000
+
+#define DEFAULT_NUM_CHUNK 0
+
+#define DEFAULT_UNIQ      31415
+
+
+/* ======================= INTERNAL CONFIG ================================ */
+
+
+#ifndef _GNU_SOURCE
+# define _GNU_SOURCE
+#endif
+
+#ifdef NDEBUG
+# undef NDEBUG
+#endif
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../src/include/ipc.h"
+#include "../src/include/sbma.h"
+#include "../src/include/vmm.h"
+
+#define XSTR(X) #X
+#define STR(X)  XSTR(X)
+
+static int    NUM_PROCS = DEFAULT_NUM_PROCS;
+static size_t NUM_ITERS = DEFAULT_NUM_ITERS;
+static int    NUM_CHUNK = DEFAULT_NUM_CHUNK;
+static int    UNIQ      = DEFAULT_UNIQ;
+
+static inline void
+_gettime(struct timespec * const t)
+{
+  struct timespec tt;
+  clock_gettime(CLOCK_MONOTONIC, &tt);
+  t->tv_sec = tt.tv_sec;
+  t->tv_nsec = tt.tv_nsec;
+}
+
+static inline long unsigned
+_getelapsed(struct timespec const * const ts,
+            struct timespec const * const te)
+{
+  struct timespec t;
+  if (te->tv_nsec < ts->tv_nsec) {
+    t.tv_nsec = 1000000000UL + te->tv_nsec - ts->tv_nsec;
+    t.tv_sec = te->tv_sec - 1 - ts->tv_sec;
+  }
+  else {
+    t.tv_nsec = te->tv_nsec - ts->tv_nsec;
+    t.tv_sec = te->tv_sec - ts->tv_sec;
+  }
+  return (unsigned long)(t.tv_sec * 1000000000UL + t.tv_nsec);
+}
+
+static inline void
+_parse(int argc, char * argv[])
+{
+  int i;
+
+  for (i=1; i<argc; ++i) {
+    if (0 == strncmp("--procs=", argv[i], 8)) {
+      NUM_PROCS = atoi(argv[i]+8);
+    }
+    else if (0 == strncmp("--iters=", argv[i], 8)) {
+      NUM_ITERS = atol(argv[i]+8);
+    }
+    else if (0 == strncmp("--chunk=", argv[i], 8)) {
+      NUM_CHUNK = atoi(argv[i]+8);
+    }
+    else if (0 == strncmp("--uniq=", argv[i], 7)) {
+      UNIQ = atoi(argv[i]+7);
+    }
+  }
+
+  assert(0 < NUM_PROCS);
+  assert(0 <= NUM_CHUNK);
+}
+
+/* Each rank repeatedly admits, dirties, cleans and releases one page, which
+ * exercises the per-process counters of the shared memory region from all
+ * ranks at once. */
+static void
+_rank(volatile int * const barrier, unsigned long * const t_ad,
+      unsigned long * const t_di)
+{
+  int ret;
+  size_t i;
+  struct timespec ts, te;
+  struct ipc * ipc;
+
+  ret = SBMA_init("/tmp/", UNIQ, (size_t)sysconf(_SC_PAGESIZE), NUM_PROCS,
+    (size_t)NUM_PROCS*(NUM_CHUNK+1), SBMA_parse_optstr("noosvmm"));
+  assert(0 == ret);
+  ret = SBMA_mallopt(M_CHUNK, NUM_CHUNK);
+  assert(0 == ret);
+
+  ipc = &(_vmm_.ipc);
+
+  /* Wait for all ranks to join. */
+  (void)__sync_fetch_and_add(barrier, 1);
+  while (NUM_PROCS != *barrier);
+
+  _gettime(&ts);
+  for (i=0; i<NUM_ITERS; ++i) {
+    ret = ipc_madmit(ipc, 1, 0);
+    assert(0 == ret);
+
+    IPC_INTER_CRITICAL_SECTION_BEG(ipc);
+    ipc_atomic_dec(ipc, 1, 0);
+    IPC_INTER_CRITICAL_SECTION_END(ipc);
+  }
+  _gettime(&te);
+  *t_ad = _getelapsed(&ts, &te);
+
+  _gettime(&ts);
+  for (i=0; i<NUM_ITERS; ++i) {
+    ret = ipc_mdirty(ipc, 1);
+    assert(-1 != ret);
+    ret = ipc_mdirty(ipc, -1);
+    assert(-1 != ret);
+  }
+  _gettime(&te);
+  *t_di = _getelapsed(&ts, &te);
+
+  ret = SBMA_destroy();
+  assert(0 == ret);
+}
+
+int main(int argc, char * argv[])
+{
+  int p, st;
+  unsigned long t_ad, t_di;
+  volatile int * barrier;
+  unsigned long * times;
+
+  _parse(argc, argv);
+
+  fprintf(stderr, "==========================\n");
+  fprintf(stderr, "General ==================\n");
+  fprintf(stderr, "==========================\n");
+  fprintf(stderr, "  Version      = %9s\n", STR(VERSION));
+  fprintf(stderr, "  Build date   = %9s\n", STR(DATE));
+  fprintf(stderr, "  Git commit   = %9s\n", STR(COMMIT));
+  fprintf(stderr, "  Ranks        = %9d\n", NUM_PROCS);
+  fprintf(stderr, "  Iterations   = %9lu\n", NUM_ITERS);
+  fprintf(stderr, "  Credit chunk = %9d\n", NUM_CHUNK);
+  fprintf(stderr, "  Slot size    = %9lu\n", sizeof(struct ipc_slot));
+  fprintf(stderr, "\n");
+
+  /* ===== Acquire resources ===== */
+  barrier = mmap(NULL, (1+2*NUM_PROCS)*sizeof(unsigned long),
+    PROT_READ|PROT_WRITE, MAP_SHARED|MAP_ANONYMOUS, -1, 0);
+  assert(MAP_FAILED != barrier);
+  times = (unsigned long*)((char*)barrier+sizeof(unsigned long));
+  *barrier = 0;
+
+  /* ===== Run ranks ===== */
+  for (p=0; p<NUM_PROCS; ++p) {
+    if (0 == fork()) {
+      _rank(barrier, &(times[2*p]), &(times[2*p+1]));
+      _exit(EXIT_SUCCESS);
+    }
+  }
+  for (p=0; p<NUM_PROCS; ++p) {
+    (void)wait(&st);
+    assert(WIFEXITED(st) && EXIT_SUCCESS == WEXITSTATUS(st));
+  }
+
+  /* ===== Report ===== */
+  for (t_ad=0,t_di=0,p=0; p<NUM_PROCS; ++p) {
+    t_ad += times[2*p];
+    t_di += times[2*p+1];
+  }
+
+  fprintf(stderr, "==========================\n");
+  fprintf(stderr, "Timing (ns/op per rank) ==\n");
+  fprintf(stderr, "==========================\n");
+  fprintf(stderr, "  Admit/release = %8.1f\n",
+    (double)t_ad/NUM_PROCS/NUM_ITERS);
+  fprintf(stderr, "  Dirty/clean   = %8.1f\n",
+    (double)t_di/NUM_PROCS/NUM_ITERS/2);
+
+  /* ===== Release resources ===== */
+  munmap((void*)barrier, (1+2*NUM_PROCS)*sizeof(unsigned long));
+
+  return EXIT_SUCCESS;
+}
@@ -34,9 +34,7 @@ THE SOFTWARE.
 /****************************************************************************/
 /*! Initialization variables. */
 /****************************************************************************/
-#ifdef USE_THREAD
 extern pthread_mutex_t init_lock;
-#endif
 
 
 /****************************************************************************/
@@ -46,7 +46,8 @@ SBMA_EXTERN int
 sbma_free(void * const __ptr)
 {
   int ret, retval;
-  size_t page_size, s_pages, n_pages, f_pages, c_pages, d_pages;
+  size_t page_size, meta_size, s_pages, n_pages, f_pages, c_pages, d_pages;
+  size_t p_pages;
   struct ate * ate;
   char fname[FILENAME_MAX];
 
@@ -55,13 +56,22 @@ sbma_free(void * const __ptr)
   /* Default return value. */
   retval = 0;
 
-  page_size = _vmm_.page_size;
-  s_pages   = 1+((sizeof(struct ate)-1)/page_size);
-  ate       = (struct ate*)((uintptr_t)__ptr-(s_pages*page_size));
+  meta_size = _vmm_.page_size;
+  s_pages   = 1+((sizeof(struct ate)-1)/meta_size);
+  ate       = (struct ate*)((uintptr_t)__ptr-(s_pages*meta_size));
+  page_size = ate->page_size;
   n_pages   = ate->n_pages;
-  c_pages   = ate->c_pages;
-  d_pages   = ate->d_pages;
-  f_pages   = 1+((n_pages*sizeof(uint8_t)-1)/page_size);
+  f_pages   = 1+((n_pages*sizeof(uint8_t)-1)/meta_size);
+
+  /* Invalidate ate. This waits for the eviction thread to finish walking the
+   * allocation table, if it is, after which the ate can no longer be found. */
+  ret = mmu_invalidate_ate(&(_vmm_.mmu), ate);
+  if (-1 == ret)
+    retval = -1;
+
+  c_pages = ate->c_pages;
+  d_pages = ate->d_pages;
+  p_pages = ate->p_pages;
 
   /* Remove the file. */
   ret = snprintf(fname, FILENAME_MAX, "%s%d-%zx", _vmm_.fstem, (int)getpid(),\
@@ -72,29 +82,29 @@ sbma_free(void * const __ptr)
   if (-1 == ret && ENOENT != errno)
     retval = -1;
 
-  /* Invalidate ate. */
-  ret = mmu_invalidate_ate(&(_vmm_.mmu), ate);
-  if (-1 == ret)
-    retval = -1;
-
   /* Destory ate lock. */
   ret = lock_free(&(ate->lock));
   if (-1 == ret)
     retval = -1;
 
   /* Free resources. */
-  ret = munmap((void*)ate, (s_pages+n_pages+f_pages)*page_size);
+  ret = munmap((void*)ate, (s_pages+f_pages)*meta_size+n_pages*page_size);
   if (-1 == ret)
     retval = -1;
+  else
+    VMM_TRACK(&_vmm_, memal, -(uint64_t)(n_pages*page_size));
 
   /* Update memory file. */
+  ret = ipc_mpin(&(_vmm_.ipc), -VMM_TO_SYS(page_size, p_pages));
+  if (-1 == ret)
+    retval = -1;
   for (;;) {
     if (VMM_METACH == (_vmm_.opts&VMM_METACH))
-      retval = ipc_mevict(&(_vmm_.ipc), VMM_TO_SYS(s_pages+c_pages+f_pages),\
-        VMM_TO_SYS(d_pages));
+      retval = ipc_mevict(&(_vmm_.ipc), VMM_TO_SYS(meta_size, s_pages+f_pages)+\
+        VMM_TO_SYS(page_size, c_pages), VMM_TO_SYS(page_size, d_pages));
     else
-      retval = ipc_mevict(&(_vmm_.ipc), VMM_TO_SYS(c_pages),\
-        VMM_TO_SYS(d_pages));
+      retval = ipc_mevict(&(_vmm_.ipc), VMM_TO_SYS(page_size, c_pages),\
+        VMM_TO_SYS(page_size, d_pages));
     if (-2 != retval)
       break;
   }
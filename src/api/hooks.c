@@ -34,19 +34,25 @@ THE SOFTWARE.
 #pragma GCC optimize("O0")
 
 
-#include <dlfcn.h>     /* dlsym */
+#include <dlfcn.h>     /* dlsym, dlvsym */
 #include <errno.h>     /* errno library */
 #include <fcntl.h>     /* open */
 #include <malloc.h>    /* struct mallinfo */
 #include <mqueue.h>    /* mq_*send, mq_*receive */
+#include <poll.h>      /* poll */
+#include <pthread.h>   /* pthread library */
 #include <semaphore.h> /* semaphore library */
 #include <stdarg.h>    /* stdarg library */
 #include <stddef.h>    /* size_t */
 #include <stdio.h>     /* FILE */
-#include <string.h>    /* memset, memcpy */
+#include <stdlib.h>    /* atoi */
+#include <string.h>    /* memset, memcpy, strchr, strrchr */
+#include <sys/epoll.h> /* epoll_wait */
 #include <sys/mman.h>  /* mlock, munlock */
 #include <sys/stat.h>  /* stat, open */
 #include <sys/types.h> /* stat, open */
+#include <sys/wait.h>  /* waitpid */
+#include <time.h>      /* nanosleep */
 #include <unistd.h>    /* ssize_t, stat */
 #include "common.h"
 #include "ipc.h"
@@ -71,6 +77,23 @@ do {                                                                        \
 } while (0)
 
 
+/****************************************************************************/
+/* glibc keeps the pre-2.3.2 condition variables under the same names, and
+ * dlsym returns the oldest version of a symbol, so the current one must be
+ * requested by version where it exists */
+/****************************************************************************/
+#define HOOK_COND_VER "GLIBC_2.3.2"
+
+#define HOOK_INIT_VER(func, ver)                                            \
+do {                                                                        \
+  if (NULL == _libc_##func) {                                               \
+    *((void **) &_libc_##func) = dlvsym(RTLD_NEXT, #func, ver);             \
+    if (NULL == _libc_##func)                                               \
+      HOOK_INIT(func);                                                      \
+  }                                                                         \
+} while (0)
+
+
 /****************************************************************************/
 /* memory and function pointer for internal_calloc */
 /****************************************************************************/
@@ -369,6 +392,280 @@ libc_msync(void * const addr, size_t const len, int const flags)
 }
 
 
+/****************************************************************************/
+/*! Hook: libc pthread_cond_wait */
+/****************************************************************************/
+SBMA_EXPORT(internal, int
+libc_pthread_cond_wait(pthread_cond_t * const cond,
+                       pthread_mutex_t * const mutex));
+SBMA_EXTERN int
+libc_pthread_cond_wait(pthread_cond_t * const cond,
+                       pthread_mutex_t * const mutex)
+{
+  static int (*_libc_pthread_cond_wait)(pthread_cond_t*, pthread_mutex_t*)=\
+    NULL;
+
+  HOOK_INIT_VER(pthread_cond_wait, HOOK_COND_VER);
+
+  return _libc_pthread_cond_wait(cond, mutex);
+}
+
+
+/****************************************************************************/
+/*! Hook: libc pthread_cond_timedwait */
+/****************************************************************************/
+SBMA_EXPORT(internal, int
+libc_pthread_cond_timedwait(pthread_cond_t * const cond,
+                            pthread_mutex_t * const mutex,
+                            struct timespec const * const abstime));
+SBMA_EXTERN int
+libc_pthread_cond_timedwait(pthread_cond_t * const cond,
+                            pthread_mutex_t * const mutex,
+                            struct timespec const * const abstime)
+{
+  static int (*_libc_pthread_cond_timedwait)(pthread_cond_t*,\
+    pthread_mutex_t*, struct timespec const*)=NULL;
+
+  HOOK_INIT_VER(pthread_cond_timedwait, HOOK_COND_VER);
+
+  return _libc_pthread_cond_timedwait(cond, mutex, abstime);
+}
+
+
+/****************************************************************************/
+/*! Hook: libc pthread_barrier_wait */
+/****************************************************************************/
+SBMA_EXPORT(internal, int
+libc_pthread_barrier_wait(pthread_barrier_t * const barrier));
+SBMA_EXTERN int
+libc_pthread_barrier_wait(pthread_barrier_t * const barrier)
+{
+  static int (*_libc_pthread_barrier_wait)(pthread_barrier_t*)=NULL;
+
+  HOOK_INIT(pthread_barrier_wait);
+
+  return _libc_pthread_barrier_wait(barrier);
+}
+
+
+/****************************************************************************/
+/*! Hook: libc sem_wait */
+/****************************************************************************/
+SBMA_EXTERN int
+libc_sem_wait(sem_t * const sem)
+{
+  static int (*_libc_sem_wait)(sem_t*)=NULL;
+
+  HOOK_INIT(sem_wait);
+
+  return _libc_sem_wait(sem);
+}
+
+
+/****************************************************************************/
+/*! Hook: libc sem_timedwait */
+/****************************************************************************/
+SBMA_EXPORT(internal, int
+libc_sem_timedwait(sem_t * const sem, struct timespec const * const abstime));
+SBMA_EXTERN int
+libc_sem_timedwait(sem_t * const sem, struct timespec const * const abstime)
+{
+  static int (*_libc_sem_timedwait)(sem_t*, struct timespec const*)=NULL;
+
+  HOOK_INIT(sem_timedwait);
+
+  return _libc_sem_timedwait(sem, abstime);
+}
+
+
+/****************************************************************************/
+/*! Hook: libc poll */
+/****************************************************************************/
+SBMA_EXPORT(internal, int
+libc_poll(struct pollfd * const fds, nfds_t const nfds, int const timeout));
+SBMA_EXTERN int
+libc_poll(struct pollfd * const fds, nfds_t const nfds, int const timeout)
+{
+  static int (*_libc_poll)(struct pollfd*, nfds_t, int)=NULL;
+
+  HOOK_INIT(poll);
+
+  return _libc_poll(fds, nfds, timeout);
+}
+
+
+/****************************************************************************/
+/*! Hook: libc epoll_wait */
+/****************************************************************************/
+SBMA_EXPORT(internal, int
+libc_epoll_wait(int const epfd, struct epoll_event * const events,
+                int const maxevents, int const timeout));
+SBMA_EXTERN int
+libc_epoll_wait(int const epfd, struct epoll_event * const events,
+                int const maxevents, int const timeout)
+{
+  static int (*_libc_epoll_wait)(int, struct epoll_event*, int, int)=NULL;
+
+  HOOK_INIT(epoll_wait);
+
+  return _libc_epoll_wait(epfd, events, maxevents, timeout);
+}
+
+
+/****************************************************************************/
+/*! Hook: libc nanosleep */
+/****************************************************************************/
+SBMA_EXTERN int
+libc_nanosleep(struct timespec const * const req, struct timespec * const rem)
+{
+  static int (*_libc_nanosleep)(struct timespec const*, struct timespec*)=\
+    NULL;
+
+  HOOK_INIT(nanosleep);
+
+  return _libc_nanosleep(req, rem);
+}
+
+
+/****************************************************************************/
+/*! Hook: libc waitpid */
+/****************************************************************************/
+SBMA_EXPORT(internal, pid_t
+libc_waitpid(pid_t const pid, int * const status, int const options));
+SBMA_EXTERN pid_t
+libc_waitpid(pid_t const pid, int * const status, int const options)
+{
+  static pid_t (*_libc_waitpid)(pid_t, int*, int)=NULL;
+
+  HOOK_INIT(waitpid);
+
+  return _libc_waitpid(pid, status, options);
+}
+
+
+/****************************************************************************/
+/* Number of threads of this process which are blocked in a hooked call,
+ * whether signaling has been enabled automatically because all of its
+ * threads are, and whether signaling had been enabled explicitly, see
+ * SBMA_sigon(), at that time. */
+/****************************************************************************/
+static int hook_n_block=0;
+static int hook_auto=0;
+static int hook_sigon=0;
+
+
+/****************************************************************************/
+/*! Return the number of threads of the application, i.e., those of the
+ *  process less those started by the runtime, or -1 if it cannot be read. */
+/****************************************************************************/
+SBMA_STATIC int
+hook_n_thread(void)
+{
+  int fd, i, n;
+  ssize_t len;
+  char * p;
+  char buf[1024];
+
+  fd = libc_open("/proc/self/stat", O_RDONLY);
+  if (-1 == fd)
+    return -1;
+  len = libc_read(fd, buf, sizeof(buf)-1);
+  (void)close(fd);
+  if (0 >= len)
+    return -1;
+  buf[len] = '\0';
+
+  /* The command name may contain spaces, so the fields are counted from
+   * its closing parenthesis. The number of threads is the 20th field. */
+  p = strrchr(buf, ')');
+  for (i=0; NULL!=p && i<18; ++i)
+    p = strchr(p+1, ' ');
+  if (NULL == p)
+    return -1;
+  n = atoi(p+1);
+
+  n -= (1 == _vmm_.evict) ? 1 : 0;
+  n -= (1 == _vmm_.adapt) ? 1 : 0;
+  n -= (1 == _vmm_.io) ? VMM_IO_THREADS : 0;
+
+  return n;
+}
+
+
+/****************************************************************************/
+/*! Enable signaling, if the autosig option was selected and the calling
+ *  thread is the last thread of the application to block. Returns 1 if
+ *  hook_block_end() must be called once the thread unblocks, 0 otherwise.
+ *
+ *  Note:
+ *    1)  Signaling is not enabled when addr is in SBMA memory, since the
+ *        kernel may write to addr while the thread is blocked, and memory
+ *        released in the meantime would then fail with EFAULT instead of
+ *        faulting back in.
+ *    2)  Signaling is process-wide, so it is enabled only once every thread
+ *        of the application is blocked, and disabled as soon as any of them
+ *        unblocks. Otherwise, an idle helper thread, e.g., of a thread pool,
+ *        would keep a computing process signaled. */
+/****************************************************************************/
+SBMA_STATIC int
+hook_block_beg(void * const addr)
+{
+  int n;
+  struct ipc * ipc;
+
+  if (1 != _vmm_.init || VMM_AUTOSIG != (_vmm_.opts&VMM_AUTOSIG))
+    return 0;
+  if (NULL != addr && 1 == SBMA_mexist(addr))
+    return 0;
+
+  ipc = &(_vmm_.ipc);
+
+  IPC_INTRA_CRITICAL_SECTION_BEG(ipc);
+  ++hook_n_block;
+  if (0 == hook_auto) {
+    n = hook_n_thread();
+    if (0 < n && hook_n_block >= n) {
+      hook_auto  = 1;
+      hook_sigon = (IPC_SIGON == (ipc->slot[ipc->id].flags&IPC_SIGON));
+      if (0 == hook_sigon)
+        (void)SBMA_sigon();
+    }
+  }
+  IPC_INTRA_CRITICAL_SECTION_END(ipc);
+
+  return 1;
+}
+
+
+/****************************************************************************/
+/*! Restore signaling after a successful hook_block_beg(), once the calling
+ *  thread has unblocked. */
+/****************************************************************************/
+SBMA_STATIC void
+hook_block_end(int const block)
+{
+  int err;
+  struct ipc * ipc;
+
+  if (0 == block)
+    return;
+
+  err = errno;
+  ipc = &(_vmm_.ipc);
+
+  IPC_INTRA_CRITICAL_SECTION_BEG(ipc);
+  --hook_n_block;
+  if (1 == hook_auto) {
+    hook_auto = 0;
+    if (0 == hook_sigon)
+      (void)SBMA_sigoff();
+  }
+  IPC_INTRA_CRITICAL_SECTION_END(ipc);
+
+  errno = err;
+}
+
+
 /****************************************************************************/
 /*! Hook: malloc */
 /****************************************************************************/
@@ -615,11 +912,12 @@ read(int const fd, void * const buf, size_t const count)
   /* NOTE: Consider the following execution sequence. During the call to
    * memset, the first n pages of buf are loaded, then the process must wait
    * because the system cannot support any additional memory. While waiting,
-   * the process receives a SIGIPC and evicts all of the memory which it had
-   * previously admitted. When memset finishes, buf[0, count) is not all
-   * resident. This is an error. A hack to address this is to first call
-   * SBMA_mtouch which does a single load for the whole range. However, this
-   * is a larger issue which should be addressed at some point. */
+   * the process is asked to release memory and evicts all of the memory
+   * which it had previously admitted. When memset finishes, buf[0, count)
+   * is not all resident. This is an error. A hack to address this is to
+   * first call SBMA_mtouch which does a single load for the whole range.
+   * However, this is a larger issue which should be addressed at some
+   * point. */
   if (1 == SBMA_mexist(buf)) {
     /* NOTE: memset() must be used instead of SBMA_mtouch() for the following
      * reason. If the relevant memory page has been written to disk and thus,
@@ -732,6 +1030,157 @@ msync(void * const addr, size_t const len, int const flags)
 }
 
 
+/****************************************************************************/
+/*! Hook: pthread_cond_wait */
+/****************************************************************************/
+SBMA_EXTERN int
+pthread_cond_wait(pthread_cond_t * const cond, pthread_mutex_t * const mutex)
+{
+  int ret, block;
+
+  block = hook_block_beg(cond);
+  ret = libc_pthread_cond_wait(cond, mutex);
+  hook_block_end(block);
+
+  return ret;
+}
+
+
+/****************************************************************************/
+/*! Hook: pthread_cond_timedwait */
+/****************************************************************************/
+SBMA_EXTERN int
+pthread_cond_timedwait(pthread_cond_t * const cond,
+                       pthread_mutex_t * const mutex,
+                       struct timespec const * const abstime)
+{
+  int ret, block;
+
+  block = hook_block_beg(cond);
+  ret = libc_pthread_cond_timedwait(cond, mutex, abstime);
+  hook_block_end(block);
+
+  return ret;
+}
+
+
+/****************************************************************************/
+/*! Hook: pthread_barrier_wait */
+/****************************************************************************/
+SBMA_EXTERN int
+pthread_barrier_wait(pthread_barrier_t * const barrier)
+{
+  int ret, block;
+
+  block = hook_block_beg(barrier);
+  ret = libc_pthread_barrier_wait(barrier);
+  hook_block_end(block);
+
+  return ret;
+}
+
+
+/****************************************************************************/
+/*! Hook: sem_wait */
+/****************************************************************************/
+SBMA_EXTERN int
+sem_wait(sem_t * const sem)
+{
+  int ret, block;
+
+  block = hook_block_beg(sem);
+  ret = libc_sem_wait(sem);
+  hook_block_end(block);
+
+  return ret;
+}
+
+
+/****************************************************************************/
+/*! Hook: sem_timedwait */
+/****************************************************************************/
+SBMA_EXTERN int
+sem_timedwait(sem_t * const sem, struct timespec const * const abstime)
+{
+  int ret, block;
+
+  block = hook_block_beg(sem);
+  ret = libc_sem_timedwait(sem, abstime);
+  hook_block_end(block);
+
+  return ret;
+}
+
+
+/****************************************************************************/
+/*! Hook: poll */
+/****************************************************************************/
+SBMA_EXTERN int
+poll(struct pollfd * const fds, nfds_t const nfds, int const timeout)
+{
+  int ret, block=0;
+
+  if (0 != timeout)
+    block = hook_block_beg(fds);
+  ret = libc_poll(fds, nfds, timeout);
+  hook_block_end(block);
+
+  return ret;
+}
+
+
+/****************************************************************************/
+/*! Hook: epoll_wait */
+/****************************************************************************/
+SBMA_EXTERN int
+epoll_wait(int const epfd, struct epoll_event * const events,
+           int const maxevents, int const timeout)
+{
+  int ret, block=0;
+
+  if (0 != timeout)
+    block = hook_block_beg(events);
+  ret = libc_epoll_wait(epfd, events, maxevents, timeout);
+  hook_block_end(block);
+
+  return ret;
+}
+
+
+/****************************************************************************/
+/*! Hook: nanosleep */
+/****************************************************************************/
+SBMA_EXTERN int
+nanosleep(struct timespec const * const req, struct timespec * const rem)
+{
+  int ret, block;
+
+  block = hook_block_beg(rem);
+  ret = libc_nanosleep(req, rem);
+  hook_block_end(block);
+
+  return ret;
+}
+
+
+/****************************************************************************/
+/*! Hook: waitpid */
+/****************************************************************************/
+SBMA_EXTERN pid_t
+waitpid(pid_t const pid, int * const status, int const options)
+{
+  int block=0;
+  pid_t ret;
+
+  if (0 == (options&WNOHANG))
+    block = hook_block_beg(status);
+  ret = libc_waitpid(pid, status, options);
+  hook_block_end(block);
+
+  return ret;
+}
+
+
 #pragma GCC pop_options
 
 
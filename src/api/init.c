@@ -35,9 +35,7 @@ THE SOFTWARE.
 /****************************************************************************/
 /*! Initialization variables. */
 /****************************************************************************/
-#ifdef USE_THREAD
 pthread_mutex_t init_lock=PTHREAD_MUTEX_INITIALIZER;
-#endif
 
 
 /****************************************************************************/
@@ -0,0 +1,290 @@
+/*
+Copyright (c) 2015,2016 Jeremy Iverson
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+
+#ifndef _GNU_SOURCE
+# define _GNU_SOURCE 1
+#endif
+
+
+#include <errno.h>       /* errno library */
+#include <linux/futex.h> /* FUTEX_WAIT */
+#include <stddef.h>      /* NULL, size_t */
+#include <sys/syscall.h> /* SYS_futex */
+#include <time.h>        /* struct timespec, clock_gettime */
+#include <unistd.h>      /* sysconf, syscall */
+#include "common.h"
+#include "ipc.h"
+#include "sbma.h"
+#include "vmm.h"
+
+
+/****************************************************************************/
+/*! Queue an asynchronous admission of ticket->len bytes of memory. The call
+ *  returns immediately, and the ticket is completed by the eviction thread
+ *  once the memory has been admitted and is held for the ticket, from which
+ *  the next SBMA_mtouch() or page fault is served without waiting. The
+ *  memory stays held, even if other processes ask the process to release
+ *  memory, until it is used or the ticket is canceled. On completion,
+ *  ticket->status is set, ticket->efd, if not -1, is written to as an
+ *  eventfd, and ticket->cb, if not NULL, is called from the eviction thread,
+ *  so it must not block. */
+/****************************************************************************/
+SBMA_EXTERN int
+sbma_madmit_async(struct sbma_ticket * const __tkt)
+{
+  size_t sys_page_size;
+
+  if (NULL == __tkt) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  sys_page_size = (size_t)sysconf(_SC_PAGESIZE);
+  __tkt->pages  = (__tkt->len+sys_page_size-1)/sys_page_size;
+
+  /* Nothing to admit if the memory is not managed by the runtime. */
+  if (1 != _vmm_.init || 0 == __tkt->pages) {
+    IPC_TICKET_DONE(__tkt, 0);
+    return 0;
+  }
+
+  return ipc_mqueue(&(_vmm_.ipc), __tkt);
+}
+
+
+/****************************************************************************/
+/*! Wait for an asynchronous admission or prefetch to complete, for at most
+ *  timeout, or forever if timeout is NULL. If the ticket is still pending
+ *  once timeout has passed, it is canceled and -1 is returned with errno set
+ *  to ETIMEDOUT. If the ticket failed, -1 is returned with errno set to
+ *  ENOMEM. */
+/****************************************************************************/
+SBMA_EXTERN int
+sbma_madmit_wait(struct sbma_ticket * const __tkt,
+                 struct timespec const * const __timeout)
+{
+  int ret, status;
+  struct timespec te, tn, ts;
+  struct timespec const * timeout=__timeout;
+
+  if (NULL == __tkt) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  if (NULL != timeout) {
+    ret = clock_gettime(CLOCK_MONOTONIC, &te);
+    if (-1 == ret)
+      return -1;
+    te.tv_sec  += timeout->tv_sec;
+    te.tv_nsec += timeout->tv_nsec;
+    if (te.tv_nsec >= 1000000000) {
+      te.tv_sec++;
+      te.tv_nsec -= 1000000000;
+    }
+  }
+
+  while (1 == (status=__tkt->status)) {
+    if (NULL == timeout) {
+      (void)syscall(SYS_futex, &(__tkt->status), FUTEX_WAIT, 1, NULL, NULL,\
+        0);
+      continue;
+    }
+
+    ret = clock_gettime(CLOCK_MONOTONIC, &tn);
+    if (-1 == ret)
+      return -1;
+
+    if (tn.tv_sec > te.tv_sec ||\
+        (tn.tv_sec == te.tv_sec && tn.tv_nsec >= te.tv_nsec))
+    {
+      /* A ticket which cannot be canceled is being completed, so wait for
+       * it without a timeout. */
+      if (0 == ipc_mcancel(&(_vmm_.ipc), __tkt) ||\
+          0 == vmm_prefetch_cancel(&_vmm_, __tkt))
+      {
+        __tkt->status = -1;
+        errno = ETIMEDOUT;
+        return -1;
+      }
+      timeout = NULL;
+      continue;
+    }
+
+    ts.tv_sec  = te.tv_sec-tn.tv_sec;
+    ts.tv_nsec = te.tv_nsec-tn.tv_nsec;
+    if (ts.tv_nsec < 0) {
+      ts.tv_sec--;
+      ts.tv_nsec += 1000000000;
+    }
+    (void)syscall(SYS_futex, &(__tkt->status), FUTEX_WAIT, 1, &ts, NULL, 0);
+  }
+
+  if (0 != status) {
+    errno = ENOMEM;
+    return -1;
+  }
+
+  return 0;
+}
+
+
+/****************************************************************************/
+/*! Cancel a pending asynchronous admission or prefetch, or return the memory
+ *  still held for an admitted ticket to the system. The ticket is not
+ *  completed, its status is set to -1 directly. Returns -1 if the ticket is
+ *  neither pending nor holding memory. */
+/****************************************************************************/
+SBMA_EXTERN int
+sbma_madmit_cancel(struct sbma_ticket * const __tkt)
+{
+  if (NULL == __tkt || 1 != _vmm_.init) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  if (-1 == ipc_mcancel(&(_vmm_.ipc), __tkt) &&\
+      -1 == vmm_prefetch_cancel(&_vmm_, __tkt) &&\
+      -1 == ipc_mrevoke(&(_vmm_.ipc), __tkt))
+  {
+    errno = EALREADY;
+    return -1;
+  }
+
+  __tkt->status = -1;
+
+  return 0;
+}
+
+
+#ifdef TEST
+#include <string.h>   /* memset */
+#include <sys/wait.h> /* waitpid */
+
+/* Two processes share 400 pages. The parent admits a ticket for 100 pages
+ * while it has 100 pages resident, then the child asks it to release memory
+ * before the parent waits for the ticket. The parent must release its
+ * resident pages but keep the memory held for the ticket, and its next 100
+ * pages must then be admitted without asking anyone. */
+int
+main(int argc, char * argv[])
+{
+  int ret, i, st, uniq, cp[2], pc[2];
+  char c;
+  size_t pg, numreq;
+  volatile char x;
+  char * a;
+  pid_t pid;
+  struct sbma_ticket tkt;
+  volatile struct ipc_slot * slot;
+
+  if (0 == argc || NULL == argv) {}
+
+  pg   = (size_t)sysconf(_SC_PAGESIZE);
+  uniq = (int)getpid();
+
+  if (-1 == pipe(cp) || -1 == pipe(pc))
+    return 1;
+
+  pid = fork();
+  if (-1 == pid)
+    return 1;
+
+  ret = SBMA_init("/tmp/", uniq, pg, 2, 400,\
+    SBMA_parse_optstr("evict,lzyrd,noghost,nometach,noosvmm"));
+  if (-1 == ret)
+    return 1;
+
+  if (0 == pid) {
+    /* child: hold 100 pages, then ask for 150 once the ticket is admitted */
+    a = sbma_malloc(250*pg);
+    memset(a, 1, 100*pg);
+    if (1 != write(cp[1], "r", 1) || 1 != read(pc[0], &c, 1))
+      _exit(1);
+    memset(a+100*pg, 1, 150*pg);
+    if (1 != write(cp[1], "d", 1) || 1 != read(pc[0], &c, 1))
+      _exit(1);
+    sbma_free(a);
+    _exit(-1 == SBMA_destroy());
+  }
+
+  slot = &(_vmm_.ipc.slot[_vmm_.ipc.id]);
+  a    = sbma_malloc(100*pg);
+  memset(a, 1, 100*pg);
+  if (1 != read(cp[0], &c, 1))
+    return 1;
+
+  memset(&tkt, 0, sizeof(tkt));
+  tkt.len = 100*pg;
+  tkt.efd = -1;
+  ret = SBMA_madmit_async(&tkt);
+  if (-1 == ret)
+    return 1;
+  for (i=0; i<10000 && 1==tkt.status; ++i)
+    usleep(1000);
+  if (0 != tkt.status || 100 != slot->r_mem)
+    return 1;
+
+  /* the child asks for memory between the admission and the wait */
+  if (1 != write(pc[1], "g", 1) || 1 != read(cp[0], &c, 1))
+    return 1;
+  if (100 != slot->r_mem || 100 != slot->c_mem)
+    return 1;
+
+  ret = SBMA_madmit_wait(&tkt, NULL);
+  if (-1 == ret)
+    return 1;
+
+  numreq = _vmm_.ipc.stat.numreq;
+  for (i=0; i<100; ++i)
+    x = a[i*pg];
+  if (numreq != _vmm_.ipc.stat.numreq || 0 != slot->r_mem)
+    return 1;
+
+  /* memory held for a ticket which is canceled is returned */
+  tkt.len = 10*pg;
+  ret = SBMA_madmit_async(&tkt);
+  if (-1 == ret)
+    return 1;
+  ret = SBMA_madmit_wait(&tkt, NULL);
+  if (-1 == ret || 10 != slot->r_mem)
+    return 1;
+  ret = SBMA_madmit_cancel(&tkt);
+  if (-1 == ret || 0 != slot->r_mem || 100 != slot->c_mem)
+    return 1;
+
+  if (1 != write(pc[1], "f", 1) || -1 == waitpid(pid, &st, 0))
+    return 1;
+  if (!WIFEXITED(st) || 0 != WEXITSTATUS(st))
+    return 1;
+
+  sbma_free(a);
+  ret = SBMA_destroy();
+  if (-1 == ret)
+    return 1;
+
+  if (0 == x) {} /* suppress unused warning */
+
+  return 0;
+}
+#endif
@@ -0,0 +1,137 @@
+/*
+Copyright (c) 2015,2016 Jeremy Iverson
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+
+#ifndef _GNU_SOURCE
+# define _GNU_SOURCE 1
+#endif
+
+
+#include <errno.h>     /* errno library */
+#include <stdint.h>    /* uintptr_t */
+#include <stddef.h>    /* NULL, size_t */
+#include <sys/types.h> /* ssize_t */
+#include "common.h"
+#include "lock.h"
+#include "mmu.h"
+#include "sbma.h"
+#include "vmm.h"
+
+
+/****************************************************************************/
+/*! Advise the runtime of the access pattern of a range of an allocation.
+ *  SBMA_MADV_SEQUENTIAL and SBMA_MADV_RANDOM choose the read granularity of
+ *  faults in the range, overriding the lzyrd option. SBMA_MADV_COLD and
+ *  SBMA_MADV_HOT apply to the whole allocation, since allocations are
+ *  evicted and cleaned whole: cold allocations are evicted and cleaned
+ *  before the others, hot ones after. SBMA_MADV_NORMAL clears both kinds of
+ *  advice. */
+/****************************************************************************/
+SBMA_EXTERN int
+sbma_madvise(void * const __addr, size_t const __len, int const __advice)
+{
+  int ret;
+  size_t ip, beg, end;
+  ssize_t numrw;
+  struct ate * ate;
+
+  switch (__advice) {
+    case SBMA_MADV_WILLNEED:
+    numrw = sbma_mtouch(NULL, __addr, __len);
+    return (-1 == numrw) ? -1 : 0;
+
+    case SBMA_MADV_DONTNEED:
+    numrw = sbma_mevict(__addr, __len);
+    return (-1 == numrw) ? -1 : 0;
+
+    case SBMA_MADV_NORMAL:
+    case SBMA_MADV_SEQUENTIAL:
+    case SBMA_MADV_RANDOM:
+    case SBMA_MADV_COLD:
+    case SBMA_MADV_HOT:
+    break;
+
+    default:
+    errno = EINVAL;
+    return -1;
+  }
+
+  ate = mmu_lookup_ate(&(_vmm_.mmu), __addr);
+  if ((struct ate*)-1 == ate) {
+    return -1;
+  }
+  else if (NULL == ate) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  /* need to make sure that all bytes are captured, thus beg is a floor
+   * operation and end is a ceil operation. */
+  beg = ((uintptr_t)__addr-ate->base)/ate->page_size;
+  end = (0 == __len) ? beg :\
+    1+(((uintptr_t)__addr+__len-ate->base-1)/ate->page_size);
+  if (end > ate->n_pages)
+    end = ate->n_pages;
+
+  switch (__advice) {
+    case SBMA_MADV_NORMAL:
+    for (ip=beg; ip<end; ++ip)
+      ate->flags[ip] &= ~MMU_ADVICE;
+    ate->prio = MMU_WARM;
+    break;
+
+    case SBMA_MADV_SEQUENTIAL:
+    for (ip=beg; ip<end; ++ip)
+      ate->flags[ip] = (ate->flags[ip]&~MMU_ADVRN)|MMU_ADVSQ;
+    break;
+
+    case SBMA_MADV_RANDOM:
+    for (ip=beg; ip<end; ++ip)
+      ate->flags[ip] = (ate->flags[ip]&~MMU_ADVSQ)|MMU_ADVRN;
+    break;
+
+    case SBMA_MADV_COLD:
+    ate->prio = MMU_COLD;
+    break;
+
+    case SBMA_MADV_HOT:
+    ate->prio = MMU_HOT;
+    break;
+  }
+
+  ret = lock_let(&(ate->lock));
+  if (-1 == ret)
+    return -1;
+
+  return 0;
+}
+
+
+#ifdef TEST
+int
+main(int argc, char * argv[])
+{
+  if (0 == argc || NULL == argv) {}
+
+  return 0;
+}
+#endif
@@ -28,36 +28,43 @@ THE SOFTWARE.
 
 #include <malloc.h> /* struct mallinfo */
 #include <string.h> /* memset */
+#include <unistd.h> /* sysconf */
 #include "sbma.h"
 #include "vmm.h"
 
 
 /****************************************************************************/
-/*! Return some memory statistics */
+/*! Return some memory statistics. The fields are truncated to int, see
+ *  SBMA_mstats() for the complete statistics. */
 /****************************************************************************/
 SBMA_EXTERN struct mallinfo
 sbma_mallinfo(void)
 {
+  size_t sys_size;
   struct mallinfo mi;
+  struct sbma_stats const volatile * st;
 
   memset(&mi, 0, sizeof(struct mallinfo));
 
-  mi.smblks   = _vmm_.numipc;  /* received SIGIPC faults */
-  mi.ordblks  = _vmm_.numhipc; /* honored SIGIPC faults */
+  sys_size = (size_t)sysconf(_SC_PAGESIZE);
+  st       = &(_vmm_.ipc.stat);
 
-  mi.usmblks  = _vmm_.numrd; /* syspages read from disk */
-  mi.fsmblks  = _vmm_.numwr; /* syspages wrote to disk */
-  mi.uordblks = _vmm_.numrf; /* read faults */
-  mi.fordblks = _vmm_.numwf; /* write faults */
+  mi.smblks   = st->numipc;  /* received eviction requests */
+  mi.ordblks  = st->numhipc; /* honored eviction requests */
+
+  mi.usmblks  = st->bytrd/sys_size; /* syspages read from disk */
+  mi.fsmblks  = st->bytwr/sys_size; /* syspages wrote to disk */
+  mi.uordblks = st->numrf;          /* read faults */
+  mi.fordblks = st->numwf;          /* write faults */
 
   if (0 == _vmm_.ipc.init) {
     mi.hblks = _vmm_.ipc.curpages;  /* syspages loaded */
   }
   else {
-    mi.hblks = _vmm_.ipc.c_mem[_vmm_.ipc.id]; /* ... */
+    mi.hblks = _vmm_.ipc.slot[_vmm_.ipc.id].c_mem; /* ... */
   }
   mi.hblkhd   = _vmm_.ipc.maxpages; /* high water mark for loaded syspages */
-  mi.keepcost = _vmm_.numpages;     /* syspages allocated */
+  mi.keepcost = st->memal/sys_size; /* syspages allocated */
 
   return mi;
 }
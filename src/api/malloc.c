@@ -26,6 +26,7 @@ THE SOFTWARE.
 #endif
 
 
+#include <errno.h>     /* errno library */
 #include <fcntl.h>     /* O_WRONLY, O_CREAT, O_EXCL */
 #include <stdint.h>    /* uint8_t, uintptr_t */
 #include <stddef.h>    /* NULL, size_t */
@@ -43,13 +44,21 @@ THE SOFTWARE.
 
 
 /****************************************************************************/
-/*! Allocate memory via anonymous mmap. */
+/*! Allocate memory via anonymous mmap, with the residency policy given by
+ *  the VMM_POLICY bits of policy, instead of those of the runtime options.
+ *  The policy may be obtained with SBMA_parse_optstr(), e.g., "aggrd" for a
+ *  small array which is always used in full, or "lzyrd" for a large one
+ *  which is accessed sparsely. The memory is managed in pages of page_size
+ *  bytes, which must be a multiple of the page size given to SBMA_init(), or
+ *  0 to choose by size, i.e., pages of M_BIGPAGE pages for an allocation
+ *  which spans at least VMM_BIG_PAGES of them. */
 /****************************************************************************/
 SBMA_EXTERN void *
-sbma_malloc(size_t const __size)
+sbma_malloc_ex(size_t const __size, int const __policy,
+               size_t const __page_size)
 {
   int ret, fd;
-  size_t i, page_size, s_pages, n_pages, f_pages;
+  size_t i, page_size, meta_size, s_pages, n_pages, f_pages, s_mem, n_mem;
   uintptr_t addr;
   void * retval;
   struct ate * ate;
@@ -59,34 +68,60 @@ sbma_malloc(size_t const __size)
   if (0 == __size)
     return NULL;
 
+  /* aggressive charging is only valid with lazy reading, see
+   * SBMA_parse_optstr() */
+  if ((VMM_INVLD == (__policy&VMM_INVLD)) ||\
+      (VMM_AGGCH == (__policy&(VMM_LZYRD|VMM_AGGCH))))
+  {
+    errno = EINVAL;
+    return NULL;
+  }
+
   SBMA_STATE_CHECK();
 
+  if (0 != __page_size%_vmm_.page_size) {
+    errno = EINVAL;
+    return NULL;
+  }
+
   /* Default return value. */
   retval = NULL;
 
+  /* Choose the page size of app pages, struct and flag pages always use the
+   * page size of the vmm, so that the ate can be found from the app
+   * memory. */
+  meta_size = _vmm_.page_size;
+  if (0 != __page_size)
+    page_size = __page_size;
+  else if (__size/_vmm_.big_size >= VMM_BIG_PAGES)
+    page_size = _vmm_.big_size;
+  else
+    page_size = meta_size;
+
   /* Compute allocation sizes. */
-  page_size = _vmm_.page_size;
-  s_pages   = 1+((sizeof(struct ate)-1)/page_size);      /* struct pages */
-  n_pages   = 1+((__size-1)/page_size);                  /* app pages */
-  f_pages   = 1+((n_pages*sizeof(uint8_t)-1)/page_size); /* flag pages */
+  s_pages = 1+((sizeof(struct ate)-1)/meta_size);      /* struct pages */
+  n_pages = 1+((__size-1)/page_size);                  /* app pages */
+  f_pages = 1+((n_pages*sizeof(uint8_t)-1)/meta_size); /* flag pages */
+  s_mem   = VMM_TO_SYS(meta_size, s_pages+f_pages);
+  n_mem   = VMM_TO_SYS(page_size, n_pages);
 
   /* Check memory file to see if there is enough free memory to complete this
    * allocation. */
   for (;;) {
     if (VMM_METACH == (_vmm_.opts&VMM_METACH)) {
       if (VMM_RSDNT == (_vmm_.opts&VMM_RSDNT)) {
-        ret = ipc_madmit(&(_vmm_.ipc), VMM_TO_SYS(s_pages+n_pages+f_pages),\
-          _vmm_.opts&VMM_ADMITD);
+        ret = ipc_madmit(&(_vmm_.ipc), s_mem+n_mem,\
+          _vmm_.opts&(VMM_ADMITD|VMM_ADMITF));
       }
       else {
-        ret = ipc_madmit(&(_vmm_.ipc), VMM_TO_SYS(s_pages+f_pages),\
-          _vmm_.opts&VMM_ADMITD);
+        ret = ipc_madmit(&(_vmm_.ipc), s_mem,\
+          _vmm_.opts&(VMM_ADMITD|VMM_ADMITF));
       }
     }
     else {
       if (VMM_RSDNT == (_vmm_.opts&VMM_RSDNT))
-        ret = ipc_madmit(&(_vmm_.ipc), VMM_TO_SYS(n_pages),\
-          _vmm_.opts&VMM_ADMITD);
+        ret = ipc_madmit(&(_vmm_.ipc), n_mem,\
+          _vmm_.opts&(VMM_ADMITD|VMM_ADMITF));
       else
         ret = 0;
     }
@@ -99,7 +134,7 @@ sbma_malloc(size_t const __size)
   /* Allocate memory with read/write permission and locked into memory.
    * Since the SBMA library bypasses the OS swap space, MAP_NORESERVE is used
    * here to prevent the system for reserving swap space. */
-  addr = (uintptr_t)mmap(NULL, (s_pages+n_pages+f_pages)*page_size,
+  addr = (uintptr_t)mmap(NULL, (s_pages+f_pages)*meta_size+n_pages*page_size,
     PROT_READ|PROT_WRITE, SBMA_MMAP_FLAG, -1, 0);
   if ((uintptr_t)MAP_FAILED == addr)
     goto CLEANUP1;
@@ -107,13 +142,13 @@ sbma_malloc(size_t const __size)
   if (VMM_RSDNT == (_vmm_.opts&VMM_RSDNT)) {
     /* Read-only protect application pages -- this will avoid the double
      * SIGSEGV for new allocations. */
-    ret = mprotect((void*)(addr+(s_pages*page_size)), n_pages*page_size,\
+    ret = mprotect((void*)(addr+(s_pages*meta_size)), n_pages*page_size,\
       PROT_READ);
   }
   else {
     /* Remove all protectection from application pages -- this reduces the
      * amount of memory which is admitted by default. */
-    ret = mprotect((void*)(addr+(s_pages*page_size)), n_pages*page_size,\
+    ret = mprotect((void*)(addr+(s_pages*meta_size)), n_pages*page_size,\
       PROT_NONE);
   }
   if (-1 == ret)
@@ -140,8 +175,9 @@ sbma_malloc(size_t const __size)
 #endif
 
   /* Set and populate ate structure. */
-  ate          = (struct ate*)addr;
-  ate->n_pages = n_pages;
+  ate            = (struct ate*)addr;
+  ate->page_size = page_size;
+  ate->n_pages   = n_pages;
   if (VMM_RSDNT == (_vmm_.opts&VMM_RSDNT)) {
     ate->l_pages = n_pages;
     ate->c_pages = n_pages;
@@ -151,8 +187,34 @@ sbma_malloc(size_t const __size)
     ate->c_pages = 0;
   }
   ate->d_pages = 0;
-  ate->base    = addr+(s_pages*page_size);
-  ate->flags   = (uint8_t*)(addr+((s_pages+n_pages)*page_size));
+  ate->p_pages = 0;
+  ate->prio    = MMU_WARM;
+  ate->phase   = 0;
+  ate->group   = 0;
+  ate->opts    = __policy&VMM_POLICY;
+  ate->r_frac  = 0;
+  ate->r_cnt   = 0;
+  ate->r_bulk  = 0;
+  ate->site    = NULL;
+  if (0 != (_vmm_.opts&(VMM_SITES|VMM_PROF)))
+    ate->site  = vmm_site(&_vmm_);
+  VMM_SITE_TRACK(ate, numal, 1);
+
+  /* An allocation made with the policy of the runtime options takes the
+   * policy learned for its site, if any, see VMM_PROF. Aggressive charging
+   * is kept along with lazy reading only. */
+  if (NULL != ate->site && (__policy&VMM_POLICY) == (_vmm_.opts&VMM_POLICY))
+  {
+    if (-1 != ate->site->opts) {
+      ate->opts = (ate->opts&~(VMM_LZYRD|VMM_AGGCH|VMM_LEARN))|\
+        ate->site->opts;
+      if (VMM_LZYRD == (ate->site->opts&VMM_LZYRD))
+        ate->opts |= __policy&VMM_AGGCH;
+    }
+    ate->prio = ate->site->prio;
+  }
+  ate->base    = addr+(s_pages*meta_size);
+  ate->flags   = (uint8_t*)(ate->base+(n_pages*page_size));
 
   if (VMM_RSDNT != (_vmm_.opts&VMM_RSDNT)) {
     for (i=0; i<n_pages; ++i)
@@ -168,6 +230,7 @@ sbma_malloc(size_t const __size)
   ret = mmu_insert_ate(&(_vmm_.mmu), ate);
   if (-1 == ret)
     goto CLEANUP4;
+  VMM_TRACK(&_vmm_, memal, n_pages*page_size);
 
   /**************************************************************************/
   /* Successful exit -- return pointer to appliction memory. */
@@ -188,19 +251,19 @@ sbma_malloc(size_t const __size)
   ret = unlink(fname);
   ASSERT(-1 != ret);
   CLEANUP2:
-  ret = munmap((void*)addr, (s_pages+n_pages+f_pages)*page_size);
+  ret = munmap((void*)addr, (s_pages+f_pages)*meta_size+n_pages*page_size);
   ASSERT(-1 != ret);
   CLEANUP1:
   for (;;) {
     if (VMM_METACH == (_vmm_.opts&VMM_METACH)) {
       if (VMM_RSDNT == (_vmm_.opts&VMM_RSDNT))
-        ret = ipc_mevict(&(_vmm_.ipc), VMM_TO_SYS(s_pages+n_pages+f_pages), 0);
+        ret = ipc_mevict(&(_vmm_.ipc), s_mem+n_mem, 0);
       else
-        ret = ipc_mevict(&(_vmm_.ipc), VMM_TO_SYS(s_pages+f_pages), 0);
+        ret = ipc_mevict(&(_vmm_.ipc), s_mem, 0);
     }
     else {
       if (VMM_RSDNT == (_vmm_.opts&VMM_RSDNT))
-        ret = ipc_mevict(&(_vmm_.ipc), VMM_TO_SYS(n_pages), 0);
+        ret = ipc_mevict(&(_vmm_.ipc), n_mem, 0);
       else
         ret = 0;
     }
@@ -219,6 +282,17 @@ sbma_malloc(size_t const __size)
 }
 
 
+/****************************************************************************/
+/*! Allocate memory via anonymous mmap, with the residency policy of the
+ *  runtime options. */
+/****************************************************************************/
+SBMA_EXTERN void *
+sbma_malloc(size_t const __size)
+{
+  return sbma_malloc_ex(__size, _vmm_.opts, 0);
+}
+
+
 #ifdef TEST
 int
 main(int argc, char * argv[])
@@ -26,6 +26,8 @@ THE SOFTWARE.
 #endif
 
 
+#include <errno.h> /* errno library */
+#include "ipc.h"
 #include "lock.h"
 #include "sbma.h"
 #include "vmm.h"
@@ -47,9 +49,81 @@ sbma_mallopt(int const __param, int const __value)
     case M_VMMOPTS:
     if (VMM_INVLD == (__value&VMM_INVLD))
       goto CLEANUP;
+    if (0 != (__value&(VMM_SITES|VMM_PROF)) &&\
+        -1 == vmm_site_init(&_vmm_, __value&VMM_PROF))
+    {
+      goto CLEANUP;
+    }
     _vmm_.opts = __value;
     break;
 
+    case M_CHUNK:
+    if (0 > __value)
+      goto CLEANUP;
+    /*=======================================================================*/
+    IPC_INTER_CRITICAL_SECTION_BEG(&(_vmm_.ipc));
+    /*=======================================================================*/
+    _vmm_.ipc.chunk = (size_t)__value;
+    (void)ipc_atomic_flush(&(_vmm_.ipc));
+    /*=======================================================================*/
+    IPC_INTER_CRITICAL_SECTION_END(&(_vmm_.ipc));
+    /*=======================================================================*/
+    break;
+
+    case M_QUOTA:
+    if (0 > __value)
+      goto CLEANUP;
+    if (-1 == ipc_mpolicy(&(_vmm_.ipc), (size_t)__value,\
+        _vmm_.ipc.slot[_vmm_.ipc.id].prio))
+      goto CLEANUP;
+    break;
+
+    case M_PRIORITY:
+    if (0 >= __value)
+      goto CLEANUP;
+    if (-1 == ipc_mpolicy(&(_vmm_.ipc), _vmm_.ipc.slot[_vmm_.ipc.id].quota,\
+        __value))
+      goto CLEANUP;
+    break;
+
+    case M_MAXMEM:
+    if (0 >= __value)
+      goto CLEANUP;
+    /*=======================================================================*/
+    IPC_INTER_CRITICAL_SECTION_BEG(&(_vmm_.ipc));
+    /*=======================================================================*/
+    *_vmm_.ipc.l_mem = (size_t)__value;
+    /*=======================================================================*/
+    IPC_INTER_CRITICAL_SECTION_END(&(_vmm_.ipc));
+    /*=======================================================================*/
+    break;
+
+    case M_GANG:
+    if (-1 > __value)
+      goto CLEANUP;
+    /*=======================================================================*/
+    IPC_INTER_CRITICAL_SECTION_BEG(&(_vmm_.ipc));
+    /*=======================================================================*/
+    *_vmm_.ipc.gang = __value;
+    /*=======================================================================*/
+    IPC_INTER_CRITICAL_SECTION_END(&(_vmm_.ipc));
+    /*=======================================================================*/
+    break;
+
+    case M_FLUSH:
+    if (0 > __value || 100 < __value)
+      goto CLEANUP;
+    _vmm_.flush = __value;
+    /* Wake the eviction thread, in case signaling is already enabled. */
+    IPC_MBOX_POST(&(_vmm_.ipc.mbox[_vmm_.ipc.id]));
+    break;
+
+    case M_BIGPAGE:
+    if (0 >= __value)
+      goto CLEANUP;
+    _vmm_.big_size = (size_t)__value*_vmm_.page_size;
+    break;
+
     default:
     goto CLEANUP;
   }
@@ -58,6 +132,17 @@ sbma_mallopt(int const __param, int const __value)
   if (-1 == ret)
     goto CLEANUP;
 
+  /* The budget is resized once the vmm lock is released, since shrinking it
+   * waits for processes to release memory. */
+  if (M_MAXMEM == __param) {
+    ret = ipc_mresize(&(_vmm_.ipc), (size_t)__value,\
+      _vmm_.opts&(VMM_ADMITD|VMM_ADMITF));
+    if (-2 == ret)
+      errno = EAGAIN;
+    if (0 != ret)
+      return -1;
+  }
+
   return 0;
 
   CLEANUP:
@@ -26,9 +26,11 @@ THE SOFTWARE.
 #endif
 
 
+#include <pthread.h>   /* pthread_mutex_lock, pthread_mutex_unlock */
 #include <stdint.h>    /* uint8_t */
 #include <stddef.h>    /* NULL, size_t */
 #include "common.h"
+#include "ipc.h"
 #include "lock.h"
 #include "sbma.h"
 #include "vmm.h"
@@ -41,11 +43,17 @@ SBMA_EXTERN int
 sbma_mcheck(char const * const __func, int const __line)
 {
   int ret, retval=0;
-  size_t i, c, l, d;
-  size_t c_pages=0, d_pages=0, s_pages, f_pages;
+  size_t i, c, l, d, p;
+  size_t c_pages=0, d_pages=0, p_pages=0, s_pages, f_pages;
   struct ate * ate;
 
   if (VMM_CHECK == (_vmm_.opts&VMM_CHECK)) {
+    /* Keep eviction requests from being served while checking, so that a
+     * partially completed eviction is never observed. */
+    ret = pthread_mutex_lock(&(_vmm_.ipc.mbox_mtx));
+    if (0 != ret)
+      return -1;
+
     ret = lock_get(&(_vmm_.lock));
     if (-1 == ret)
       goto CLEANUP1;
@@ -63,17 +71,23 @@ sbma_mcheck(char const * const __func, int const __line)
         s_pages  = 0;
         f_pages  = 0;
       }
-      c_pages += s_pages+ate->c_pages+f_pages;
-      d_pages += ate->d_pages;
+      /* Count in system pages, since allocations may differ in page
+       * size. */
+      c_pages += VMM_TO_SYS(_vmm_.page_size, s_pages+f_pages)+\
+        VMM_TO_SYS(ate->page_size, ate->c_pages);
+      d_pages += VMM_TO_SYS(ate->page_size, ate->d_pages);
+      p_pages += VMM_TO_SYS(ate->page_size, ate->p_pages);
 
       if (VMM_EXTRA == (_vmm_.opts&VMM_EXTRA)) {
-        for (l=0,c=0,d=0,i=0; i<ate->n_pages; ++i) {
+        for (l=0,c=0,d=0,p=0,i=0; i<ate->n_pages; ++i) {
           if (MMU_RSDNT != (ate->flags[i]&MMU_RSDNT))
             l++;
           if (MMU_CHRGD != (ate->flags[i]&MMU_CHRGD))
             c++;
           if (MMU_DIRTY == (ate->flags[i]&MMU_DIRTY))
             d++;
+          if (MMU_PINND == (ate->flags[i]&MMU_PINND))
+            p++;
         }
         if (l != ate->l_pages) {
           printf("[%5d] %s:%d l (%zu) != l_pages (%zu)\n", (int)getpid(),
@@ -90,6 +104,11 @@ sbma_mcheck(char const * const __func, int const __line)
             __func, __line, d, ate->d_pages);
           goto CLEANUP2;
         }
+        if (p != ate->p_pages) {
+          printf("[%5d] %s:%d p (%zu) != p_pages (%zu)\n", (int)getpid(),
+            __func, __line, p, ate->p_pages);
+          goto CLEANUP2;
+        }
       }
 
       ret = lock_let(&(ate->lock));
@@ -97,20 +116,32 @@ sbma_mcheck(char const * const __func, int const __line)
         goto CLEANUP2;
     }
 
-    if (VMM_TO_SYS(c_pages) != _vmm_.ipc.c_mem[_vmm_.ipc.id]) {
+    /* Credits held in the local pool, and memory held for admitted
+     * tickets, are charged to the process as well. */
+    c_pages += _vmm_.ipc.credit+_vmm_.ipc.slot[_vmm_.ipc.id].r_mem;
+    if (c_pages != _vmm_.ipc.slot[_vmm_.ipc.id].c_mem) {
       printf("[%5d] %s:%d c_pages (%zu) != c_mem[id] (%zu)\n", (int)getpid(),
-        __func, __line, VMM_TO_SYS(c_pages), _vmm_.ipc.c_mem[_vmm_.ipc.id]);
+        __func, __line, c_pages, _vmm_.ipc.slot[_vmm_.ipc.id].c_mem);
       retval = -1;
     }
-    if (VMM_TO_SYS(d_pages) != _vmm_.ipc.d_mem[_vmm_.ipc.id]) {
+    if (d_pages != _vmm_.ipc.slot[_vmm_.ipc.id].d_mem) {
       printf("[%5d] %s:%d d_pages (%zu) != d_mem[id] (%zu)\n", (int)getpid(),
-        __func, __line, VMM_TO_SYS(d_pages), _vmm_.ipc.d_mem[_vmm_.ipc.id]);
+        __func, __line, d_pages, _vmm_.ipc.slot[_vmm_.ipc.id].d_mem);
+      retval = -1;
+    }
+    if (p_pages != _vmm_.ipc.slot[_vmm_.ipc.id].p_mem) {
+      printf("[%5d] %s:%d p_pages (%zu) != p_mem[id] (%zu)\n", (int)getpid(),
+        __func, __line, p_pages, _vmm_.ipc.slot[_vmm_.ipc.id].p_mem);
       retval = -1;
     }
 
     ret = lock_let(&(_vmm_.lock));
     if (-1 == ret)
       goto CLEANUP1;
+
+    ret = pthread_mutex_unlock(&(_vmm_.ipc.mbox_mtx));
+    if (0 != ret)
+      return -1;
   }
   else {
     retval = 0;
@@ -124,6 +155,8 @@ sbma_mcheck(char const * const __func, int const __line)
   CLEANUP1:
   ret = lock_let(&(_vmm_.lock));
   ASSERT(-1 != ret);
+  ret = pthread_mutex_unlock(&(_vmm_.ipc.mbox_mtx));
+  ASSERT(0 == ret);
   return -1;
 }
 
@@ -47,7 +47,7 @@ sbma_mclear_probe(struct ate * const __ate, void * const __addr,
   size_t ip, beg, end, page_size, d_pages;
   volatile uint8_t * flags;
 
-  page_size = _vmm_.page_size;
+  page_size = __ate->page_size;
   flags     = __ate->flags;
 
   /* can only clear pages fully within range, thus beg is a ceil
@@ -64,7 +64,7 @@ sbma_mclear_probe(struct ate * const __ate, void * const __addr,
       d_pages++;
   }
 
-  *__d_pages = VMM_TO_SYS(d_pages);
+  *__d_pages = VMM_TO_SYS(page_size, d_pages);
 
   return 0;
 }
@@ -80,7 +80,7 @@ sbma_mclear_int(struct ate * const __ate, void * const __addr,
   size_t beg, end, page_size;
   ssize_t ret;
 
-  page_size = _vmm_.page_size;
+  page_size = __ate->page_size;
 
   /* can only clear pages fully within range, thus beg is a ceil
    * operation and end is a floor operation, except for when addr+len
@@ -167,9 +167,9 @@ sbma_mclearall(void)
     goto ERREXIT;
 
   for (ate=_vmm_.mmu.a_tbl; NULL!=ate; ate=ate->next) {
-    d_pages += ate->d_pages;
+    d_pages += VMM_TO_SYS(ate->page_size, ate->d_pages);
 
-    ret = sbma_mclear((void*)ate->base, ate->n_pages*_vmm_.page_size);
+    ret = sbma_mclear((void*)ate->base, ate->n_pages*ate->page_size);
     if (-1 == ret)
       goto CLEANUP;
 
@@ -180,7 +180,7 @@ sbma_mclearall(void)
   if (-1 == ret)
     goto CLEANUP;
 
-  ret = ipc_mdirty(&(_vmm_.ipc), -VMM_TO_SYS(d_pages));
+  ret = ipc_mdirty(&(_vmm_.ipc), -d_pages);
   if (-1 == ret)
     goto CLEANUP;
 
@@ -28,7 +28,9 @@ THE SOFTWARE.
 
 #include <stdint.h>    /* uint8_t, uintptr_t */
 #include <stddef.h>    /* NULL, size_t */
+#include <sys/mman.h>  /* mmap, munmap */
 #include <sys/types.h> /* ssize_t */
+#include <sys/uio.h>   /* struct iovec */
 #include <time.h>      /* struct timespec */
 #include "common.h"
 #include "ipc.h"
@@ -49,7 +51,7 @@ sbma_mevict_probe(struct ate * const __ate, void * const __addr,
   size_t ip, beg, end, page_size, c_pages, d_pages;
   volatile uint8_t * flags;
 
-  page_size = _vmm_.page_size;
+  page_size = __ate->page_size;
   flags     = __ate->flags;
 
   /* need to make sure that all bytes are captured, thus beg is a floor
@@ -58,14 +60,16 @@ sbma_mevict_probe(struct ate * const __ate, void * const __addr,
   end = 1+(((uintptr_t)__addr+__len-__ate->base-1)/page_size);
 
   for (c_pages=0,d_pages=0,ip=beg; ip<end; ++ip) {
+    if (MMU_PINND == (flags[ip]&MMU_PINND)) /* is pinned */
+      continue;
     if (MMU_CHRGD != (flags[ip]&MMU_CHRGD)) /* is charged */
       c_pages++;
     if (MMU_DIRTY == (flags[ip]&MMU_DIRTY)) /* is dirty */
       d_pages++;
   }
 
-  *__c_pages = VMM_TO_SYS(c_pages);
-  *__d_pages = VMM_TO_SYS(d_pages);
+  *__c_pages = VMM_TO_SYS(page_size, c_pages);
+  *__d_pages = VMM_TO_SYS(page_size, d_pages);
 
   return 0;
 }
@@ -81,7 +85,7 @@ sbma_mevict_int(struct ate * const __ate, void * const __addr,
   size_t beg, end, page_size;
   ssize_t numwr;
 
-  page_size = _vmm_.page_size;
+  page_size = __ate->page_size;
 
   /* need to make sure that all bytes are captured, thus beg is a floor
    * operation and end is a ceil operation. */
@@ -92,7 +96,7 @@ sbma_mevict_int(struct ate * const __ate, void * const __addr,
   if (-1 == numwr)
     return -1;
 
-  return VMM_TO_SYS(numwr);
+  return VMM_TO_SYS(page_size, numwr);
 }
 
 
@@ -144,10 +148,9 @@ sbma_mevict(void * const __addr, size_t const __len)
   SBMA_STATE_CHECK();
   /*========================================================================*/
 
-  VMM_INTRA_CRITICAL_SECTION_BEG(&_vmm_);
-  VMM_TRACK(&_vmm_, numwr, numwr);
-  VMM_TRACK(&_vmm_, tmrwr, (double)tmr.tv_sec+(double)tmr.tv_nsec/1000000000.0);
-  VMM_INTRA_CRITICAL_SECTION_END(&_vmm_);
+  VMM_TRACK(&_vmm_, bytwr, VMM_SYS_BYTES(numwr));
+  VMM_TRACK(&_vmm_, tmrwr, VMM_TO_NSEC(&(tmr)));
+  VMM_TRACK(&_vmm_, tmrev, VMM_TO_NSEC(&(tmr)));
 
   return c_pages;
 
@@ -159,6 +162,110 @@ sbma_mevict(void * const __addr, size_t const __len)
 }
 
 
+/****************************************************************************/
+/*! Evict the specified ranges. The ranges are sorted and merged per
+ *  allocation, and released with a single request. */
+/****************************************************************************/
+SBMA_EXTERN ssize_t
+sbma_mevictv(struct iovec const * const __iov, size_t const __num)
+{
+  int ret;
+  size_t i, num, c_pages=0, d_pages=0, _c_pages, _d_pages;
+  ssize_t _numwr, numwr=0, retval=-1;
+  struct timespec tmr;
+  struct mmu_run * run, stk[SBMA_ATOMIC_MAX];
+
+  if (0 == __num)
+    return 0;
+
+  /*========================================================================*/
+  SBMA_STATE_CHECK();
+  TIMER_START(&(tmr));
+  /*========================================================================*/
+
+  /* Small vectors are merged on the stack, larger ones in scratch memory
+   * which is not managed by the runtime. */
+  if (__num <= SBMA_ATOMIC_MAX) {
+    run = stk;
+  }
+  else {
+    run = mmap(NULL, __num*sizeof(*run), PROT_READ|PROT_WRITE,\
+      MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+    if (MAP_FAILED == run)
+      return -1;
+  }
+
+  for (i=0; i<__num; ++i) {
+    run[i].ate = NULL;
+    run[i].beg = (uintptr_t)__iov[i].iov_base;
+    run[i].end = (uintptr_t)__iov[i].iov_base+__iov[i].iov_len;
+  }
+
+  /* lock the allocations, in order of address, and merge the ranges */
+  _numwr = mmu_lookup_vec(&(_vmm_.mmu), run, __num);
+  if (-1 == _numwr)
+    goto RETURN;
+  num = (size_t)_numwr;
+
+  /* evict each of the ranges */
+  for (i=0; i<num; ++i) {
+    ret = sbma_mevict_probe(run[i].ate,\
+      (void*)(run[i].ate->base+run[i].beg*run[i].ate->page_size),\
+      (run[i].end-run[i].beg)*run[i].ate->page_size, &_c_pages, &_d_pages);
+    if (-1 == ret)
+      goto CLEANUP;
+    c_pages += _c_pages;
+    d_pages += _d_pages;
+
+    _numwr = sbma_mevict_int(run[i].ate,\
+      (void*)(run[i].ate->base+run[i].beg*run[i].ate->page_size),\
+      (run[i].end-run[i].beg)*run[i].ate->page_size);
+    if (-1 == _numwr)
+      goto CLEANUP;
+    numwr += _numwr;
+  }
+
+  /* update memory file */
+  for (;;) {
+    ret = ipc_mevict(&(_vmm_.ipc), c_pages, d_pages);
+    if (-1 == ret)
+      goto CLEANUP;
+    else if (-2 != ret)
+      break;
+  }
+
+  retval = c_pages;
+
+  CLEANUP:
+  /* release the lock of each allocation once */
+  for (i=0; i<num; ++i) {
+    if (i+1 == num || run[i].ate != run[i+1].ate) {
+      ret = lock_let(&(run[i].ate->lock));
+      ASSERT(-1 != ret);
+    }
+  }
+
+  if (-1 == retval)
+    goto RETURN;
+
+  /*========================================================================*/
+  TIMER_STOP(&(tmr));
+  SBMA_STATE_CHECK();
+  /*========================================================================*/
+
+  VMM_TRACK(&_vmm_, bytwr, VMM_SYS_BYTES(numwr));
+  VMM_TRACK(&_vmm_, tmrwr, VMM_TO_NSEC(&(tmr)));
+  VMM_TRACK(&_vmm_, tmrev, VMM_TO_NSEC(&(tmr)));
+
+  RETURN:
+  if (stk != run) {
+    ret = munmap(run, __num*sizeof(*run));
+    ASSERT(-1 != ret);
+  }
+  return retval;
+}
+
+
 /****************************************************************************/
 /*! Internal: Evict all allocations. */
 /****************************************************************************/
@@ -178,16 +285,18 @@ sbma_mevictall_int(size_t * const __c_pages, size_t * const __d_pages,
     ret = lock_get(&(ate->lock));
     if (-1 == ret)
       goto CLEANUP1;
-    c_pages += ate->c_pages;
-    d_pages += ate->d_pages;
+    c_pages += VMM_TO_SYS(ate->page_size, ate->c_pages);
+    d_pages += VMM_TO_SYS(ate->page_size, ate->d_pages);
     ret = sbma_mevict_int(ate, (void*)ate->base,\
-      ate->n_pages*_vmm_.page_size);
+      ate->n_pages*ate->page_size);
     if (-1 == ret)
       goto CLEANUP2;
     numwr += ret;
-    ASSERT(0 == ate->l_pages);
-    ASSERT(0 == ate->c_pages);
-    ASSERT(0 == ate->d_pages);
+    /* pinned pages remain resident and charged */
+    ASSERT(ate->l_pages == ate->p_pages);
+    ASSERT(ate->c_pages == ate->p_pages);
+    c_pages -= VMM_TO_SYS(ate->page_size, ate->c_pages);
+    d_pages -= VMM_TO_SYS(ate->page_size, ate->d_pages);
     ret = lock_let(&(ate->lock));
     if (-1 == ret)
       goto CLEANUP2;
@@ -197,9 +306,9 @@ sbma_mevictall_int(size_t * const __c_pages, size_t * const __d_pages,
   if (-1 == ret)
     goto CLEANUP1;
 
-  *__c_pages = VMM_TO_SYS(c_pages);
-  *__d_pages = VMM_TO_SYS(d_pages);
-  *__numwr   = VMM_TO_SYS(numwr);
+  *__c_pages = c_pages;
+  *__d_pages = d_pages;
+  *__numwr   = numwr;
 
   return 0;
 
@@ -247,10 +356,9 @@ sbma_mevictall(void)
   SBMA_STATE_CHECK();
   /*========================================================================*/
 
-  VMM_INTRA_CRITICAL_SECTION_BEG(&_vmm_);
-  VMM_TRACK(&_vmm_, numwr, numwr);
-  VMM_TRACK(&_vmm_, tmrwr, (double)tmr.tv_sec+(double)tmr.tv_nsec/1000000000.0);
-  VMM_INTRA_CRITICAL_SECTION_END(&_vmm_);
+  VMM_TRACK(&_vmm_, bytwr, VMM_SYS_BYTES(numwr));
+  VMM_TRACK(&_vmm_, tmrwr, VMM_TO_NSEC(&(tmr)));
+  VMM_TRACK(&_vmm_, tmrev, VMM_TO_NSEC(&(tmr)));
 
   return c_pages;
 
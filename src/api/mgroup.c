@@ -0,0 +1,172 @@
+/*
+Copyright (c) 2015,2016 Jeremy Iverson
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+
+#ifndef _GNU_SOURCE
+# define _GNU_SOURCE 1
+#endif
+
+
+#include <errno.h>     /* errno library */
+#include <stddef.h>    /* NULL, size_t */
+#include <sys/mman.h>  /* mmap, munmap */
+#include <sys/types.h> /* ssize_t */
+#include <sys/uio.h>   /* struct iovec */
+#include "common.h"
+#include "lock.h"
+#include "mmu.h"
+#include "sbma.h"
+#include "vmm.h"
+
+
+/****************************************************************************/
+/*! Create an allocation group. Allocations which are added to the group, see
+ *  SBMA_mgroup_add(), are loaded and evicted as a unit: a fault on any of
+ *  them admits and reads all of them with a single request, and evicting any
+ *  of them evicts all of them. A group which is larger than the memory of
+ *  the system is instead loaded as its allocations would be outside of the
+ *  group. Returns the positive id of the group. */
+/****************************************************************************/
+SBMA_EXTERN int
+sbma_mgroup_create(void)
+{
+  return __sync_add_and_fetch(&(_vmm_.groups), 1);
+}
+
+
+/****************************************************************************/
+/*! Add the allocation containing addr to a group, moving it out of the
+ *  group it was in, if any. A group of 0 removes the allocation from its
+ *  group. */
+/****************************************************************************/
+SBMA_EXTERN int
+sbma_mgroup_add(int const __group, void * const __addr)
+{
+  int ret;
+  struct ate * ate;
+
+  if (0 > __group || _vmm_.groups < __group) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  ate = mmu_lookup_ate(&(_vmm_.mmu), __addr);
+  if ((struct ate*)-1 == ate) {
+    return -1;
+  }
+  else if (NULL == ate) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  ate->group = __group;
+
+  ret = lock_let(&(ate->lock));
+  if (-1 == ret)
+    return -1;
+
+  return 0;
+}
+
+
+/****************************************************************************/
+/*! Internal: Touch all allocations of a group, as SBMA_mtouchv() does.
+ *  Returns -2, without touching any of them, if the group holds more pages
+ *  than the total memory of the system, since it could never be admitted as
+ *  a unit. */
+/****************************************************************************/
+SBMA_EXTERN ssize_t
+sbma_mgroup_touch(int const __group)
+{
+  int ret;
+  size_t i, num, s_pages;
+  ssize_t retval=-1;
+  struct iovec * iov, stk[SBMA_ATOMIC_MAX];
+  struct ate * ate;
+
+  iov = stk;
+
+  ret = lock_get(&(_vmm_.mmu.lock));
+  if (-1 == ret)
+    return -1;
+
+  for (num=0,s_pages=0,ate=_vmm_.mmu.a_tbl; NULL!=ate; ate=ate->next) {
+    if (__group == ate->group) {
+      s_pages += VMM_TO_SYS(ate->page_size, ate->n_pages);
+      num++;
+    }
+  }
+
+  if (s_pages > *_vmm_.ipc.t_mem) {
+    retval = -2;
+    goto CLEANUP;
+  }
+
+  /* Small groups are gathered on the stack, larger ones in scratch memory
+   * which is not managed by the runtime. */
+  if (num > SBMA_ATOMIC_MAX) {
+    iov = mmap(NULL, num*sizeof(*iov), PROT_READ|PROT_WRITE,\
+      MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+    if (MAP_FAILED == iov) {
+      iov = stk;
+      goto CLEANUP;
+    }
+  }
+
+  for (i=0,ate=_vmm_.mmu.a_tbl; NULL!=ate; ate=ate->next) {
+    if (__group == ate->group) {
+      iov[i].iov_base = (void*)ate->base;
+      iov[i].iov_len  = ate->n_pages*ate->page_size;
+      i++;
+    }
+  }
+
+  /* The mmu lock is released before the members are looked up and locked
+   * again, a member which is freed in between is skipped. */
+  ret = lock_let(&(_vmm_.mmu.lock));
+  if (-1 == ret)
+    goto RETURN;
+
+  retval = sbma_mtouchv(iov, num);
+  goto RETURN;
+
+  CLEANUP:
+  ret = lock_let(&(_vmm_.mmu.lock));
+  ASSERT(-1 != ret);
+  RETURN:
+  if (stk != iov) {
+    ret = munmap(iov, num*sizeof(*iov));
+    ASSERT(-1 != ret);
+  }
+  return retval;
+}
+
+
+#ifdef TEST
+int
+main(int argc, char * argv[])
+{
+  if (0 == argc || NULL == argv) {}
+
+  return 0;
+}
+#endif
@@ -0,0 +1,180 @@
+/*
+Copyright (c) 2015,2016 Jeremy Iverson
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+
+#ifndef _GNU_SOURCE
+# define _GNU_SOURCE 1
+#endif
+
+
+#include <errno.h>     /* errno library */
+#include <stdint.h>    /* uintptr_t */
+#include <stddef.h>    /* NULL, size_t */
+#include <sys/types.h> /* ssize_t */
+#include "common.h"
+#include "ipc.h"
+#include "lock.h"
+#include "mmu.h"
+#include "sbma.h"
+#include "vmm.h"
+
+
+/****************************************************************************/
+/*! Pin the specified range, i.e., make it resident and charged, and exempt
+ *  it from eviction until it is unpinned or freed. Pinned memory is
+ *  accounted for separately, so that other processes do not ask this
+ *  process to release it, and is reported in the mempn field of
+ *  SBMA_mstats(). */
+/****************************************************************************/
+SBMA_EXTERN int
+sbma_mpin(void * const __addr, size_t const __len)
+{
+  int ret;
+  size_t ip, beg, end, p_pages;
+  ssize_t numrd;
+  struct ate * ate;
+
+  SBMA_STATE_CHECK();
+
+  if (0 == __len)
+    return 0;
+
+  ate = mmu_lookup_ate(&(_vmm_.mmu), __addr);
+  if ((struct ate*)-1 == ate) {
+    return -1;
+  }
+  else if (NULL == ate) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  /* need to make sure that all bytes are captured, thus beg is a floor
+   * operation and end is a ceil operation. */
+  beg = ((uintptr_t)__addr-ate->base)/ate->page_size;
+  end = 1+(((uintptr_t)__addr+__len-ate->base-1)/ate->page_size);
+  if (end > ate->n_pages)
+    end = ate->n_pages;
+
+  /* load and charge the range, while holding on to the ate lock, so that
+   * the range cannot be evicted before it is pinned */
+  numrd = sbma_mtouch(ate, (void*)(ate->base+beg*ate->page_size),\
+    (end-beg)*ate->page_size);
+  if (-1 == numrd)
+    goto CLEANUP;
+
+  for (p_pages=0,ip=beg; ip<end; ++ip) {
+    if (MMU_PINND != (ate->flags[ip]&MMU_PINND)) {
+      ASSERT(MMU_RSDNT != (ate->flags[ip]&MMU_RSDNT)); /* is resident */
+      ASSERT(MMU_CHRGD != (ate->flags[ip]&MMU_CHRGD)); /* is charged */
+      ate->flags[ip] |= MMU_PINND;
+      p_pages++;
+    }
+  }
+  ate->p_pages += p_pages;
+
+  ret = ipc_mpin(&(_vmm_.ipc), VMM_TO_SYS(ate->page_size, p_pages));
+  if (-1 == ret)
+    goto CLEANUP;
+
+  ret = lock_let(&(ate->lock));
+  if (-1 == ret)
+    return -1;
+
+  SBMA_STATE_CHECK();
+
+  return 0;
+
+  CLEANUP:
+  ret = lock_let(&(ate->lock));
+  ASSERT(-1 != ret);
+  return -1;
+}
+
+
+/****************************************************************************/
+/*! Unpin the specified range, making it eligible for eviction again. */
+/****************************************************************************/
+SBMA_EXTERN int
+sbma_munpin(void * const __addr, size_t const __len)
+{
+  int ret;
+  size_t ip, beg, end, p_pages;
+  struct ate * ate;
+
+  SBMA_STATE_CHECK();
+
+  if (0 == __len)
+    return 0;
+
+  ate = mmu_lookup_ate(&(_vmm_.mmu), __addr);
+  if ((struct ate*)-1 == ate) {
+    return -1;
+  }
+  else if (NULL == ate) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  /* need to make sure that all bytes are captured, thus beg is a floor
+   * operation and end is a ceil operation. */
+  beg = ((uintptr_t)__addr-ate->base)/ate->page_size;
+  end = 1+(((uintptr_t)__addr+__len-ate->base-1)/ate->page_size);
+  if (end > ate->n_pages)
+    end = ate->n_pages;
+
+  for (p_pages=0,ip=beg; ip<end; ++ip) {
+    if (MMU_PINND == (ate->flags[ip]&MMU_PINND)) {
+      ate->flags[ip] &= ~MMU_PINND;
+      p_pages++;
+    }
+  }
+  ASSERT(ate->p_pages >= p_pages);
+  ate->p_pages -= p_pages;
+
+  ret = ipc_mpin(&(_vmm_.ipc), -VMM_TO_SYS(ate->page_size, p_pages));
+  if (-1 == ret)
+    goto CLEANUP;
+
+  ret = lock_let(&(ate->lock));
+  if (-1 == ret)
+    return -1;
+
+  SBMA_STATE_CHECK();
+
+  return 0;
+
+  CLEANUP:
+  ret = lock_let(&(ate->lock));
+  ASSERT(-1 != ret);
+  return -1;
+}
+
+
+#ifdef TEST
+int
+main(int argc, char * argv[])
+{
+  if (0 == argc || NULL == argv) {}
+
+  return 0;
+}
+#endif
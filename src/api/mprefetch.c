@@ -0,0 +1,79 @@
+/*
+Copyright (c) 2015,2016 Jeremy Iverson
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+
+#ifndef _GNU_SOURCE
+# define _GNU_SOURCE 1
+#endif
+
+
+#include <errno.h>  /* errno library */
+#include <stddef.h> /* NULL, size_t */
+#include "common.h"
+#include "ipc.h"
+#include "sbma.h"
+#include "vmm.h"
+
+
+/****************************************************************************/
+/*! Queue a swap-in of len bytes of memory at addr, as SBMA_mtouch() does,
+ *  on a pool of I/O threads. The call returns immediately, so that the next
+ *  block of a loop may be read while the current one is computed on. On
+ *  completion, ticket->status is set, ticket->efd, if not -1, is written to
+ *  as an eventfd, and ticket->cb, if not NULL, is called from the I/O
+ *  thread. The ticket is waited on or canceled with SBMA_madmit_wait() and
+ *  SBMA_madmit_cancel(). The memory may be accessed before the prefetch
+ *  completes, since each page is made accessible only once it has been read,
+ *  as for an allocation with ghost pages. SBMA_destroy() fails the
+ *  prefetches which have not been started and waits for the rest. */
+/****************************************************************************/
+SBMA_EXTERN int
+sbma_mprefetch(void * const __addr, size_t const __len,
+               struct sbma_ticket * const __tkt)
+{
+  if (NULL == __tkt) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  __tkt->addr = __addr;
+  __tkt->len  = __len;
+
+  /* Nothing to read if the memory is not managed by the runtime. */
+  if (1 != _vmm_.init || 0 == __len) {
+    IPC_TICKET_DONE(__tkt, 0);
+    return 0;
+  }
+
+  return vmm_prefetch_push(&_vmm_, __tkt);
+}
+
+
+#ifdef TEST
+int
+main(int argc, char * argv[])
+{
+  if (0 == argc || NULL == argv) {}
+
+  return 0;
+}
+#endif
@@ -0,0 +1,149 @@
+/*
+Copyright (c) 2015,2016 Jeremy Iverson
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+
+#ifndef _GNU_SOURCE
+# define _GNU_SOURCE 1
+#endif
+
+
+#include <stddef.h>    /* NULL */
+#include <sys/types.h> /* ssize_t */
+#include "common.h"
+#include "lock.h"
+#include "sbma.h"
+#include "vmm.h"
+
+
+/****************************************************************************/
+/*! Start or stop recording the faults which read memory. Starting discards
+ *  any earlier record, and should be done at the beginning of an iteration
+ *  of an iterative application, stopping at its end. Each fault is tagged
+ *  with the phase marker current at the time, see SBMA_mmark(). */
+/****************************************************************************/
+SBMA_EXTERN int
+sbma_mrecord(int const __on)
+{
+  int ret;
+
+  if (0 == __on) {
+    _vmm_.rec = 0;
+    return 0;
+  }
+
+  ret = vmm_record_reset(&_vmm_);
+  if (-1 == ret)
+    return -1;
+
+  _vmm_.rec = 1;
+
+  return 0;
+}
+
+
+/****************************************************************************/
+/*! Set the phase marker. While recording, the faults which follow are
+ *  tagged with mark. Otherwise, once a record exists, the memory read by the
+ *  faults tagged with mark, and by those which followed them, is prefetched
+ *  on the I/O threads, as SBMA_mprefetch() does, for as long as the free
+ *  memory suffices. An iterative application which marks its phases in the
+ *  same way in each iteration thus rarely faults after the first one.
+ *  Returns the number of system pages queued. */
+/****************************************************************************/
+SBMA_EXTERN ssize_t
+sbma_mmark(int const __mark)
+{
+  int ret;
+
+  ret = lock_get(&(_vmm_.rec_lock));
+  if (-1 == ret)
+    return -1;
+
+  _vmm_.rec_mark = __mark;
+
+  ret = lock_let(&(_vmm_.rec_lock));
+  if (-1 == ret)
+    return -1;
+
+  if (1 == _vmm_.rec || 0 == _vmm_.rec_num)
+    return 0;
+
+  return vmm_replay(&_vmm_, __mark);
+}
+
+
+#ifdef TEST
+#include <string.h> /* memset */
+#include <unistd.h> /* sysconf, usleep */
+
+/* An allocation without ghost pages is read while recording, then evicted.
+ * Replaying the record must prefetch it, so that it can be read again
+ * without faulting. */
+int
+main(int argc, char * argv[])
+{
+  int ret, i;
+  long sum;
+  size_t pg, numrf;
+  ssize_t queued;
+  char * a;
+
+  if (0 == argc || NULL == argv) {}
+
+  pg = (size_t)sysconf(_SC_PAGESIZE);
+
+  ret = SBMA_init("/tmp/", (int)getpid(), pg, 1, 400,\
+    SBMA_parse_optstr("evict,lzyrd,noghost,nometach,noosvmm"));
+  if (-1 == ret)
+    return 1;
+
+  a = sbma_malloc(100*pg);
+  memset(a, 1, 100*pg);
+  if (-1 == SBMA_mevictall())
+    return 1;
+
+  if (-1 == SBMA_mrecord(1) || -1 == SBMA_mmark(0))
+    return 1;
+  for (sum=0,i=0; i<100; ++i)
+    sum += a[i*pg];
+  if (-1 == SBMA_mrecord(0) || -1 == SBMA_mevictall())
+    return 1;
+
+  queued = SBMA_mmark(0);
+  if (100 != queued)
+    return 1;
+  for (i=0; i<10000 && 1==_vmm_.rec_log[0].tkt.status; ++i)
+    usleep(1000);
+  if (0 != _vmm_.rec_log[0].tkt.status)
+    return 1;
+
+  numrf = _vmm_.ipc.stat.numrf;
+  for (i=0; i<100; ++i)
+    sum += a[i*pg];
+  if (numrf != _vmm_.ipc.stat.numrf || 200 != sum)
+    return 1;
+
+  sbma_free(a);
+
+  return -1 == SBMA_destroy();
+}
+#endif
@@ -0,0 +1,122 @@
+/*
+Copyright (c) 2015,2016 Jeremy Iverson
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+
+#ifndef _GNU_SOURCE
+# define _GNU_SOURCE 1
+#endif
+
+
+#include <errno.h>     /* errno library */
+#include <stddef.h>    /* NULL, size_t, offsetof */
+#include <stdint.h>    /* uint64_t */
+#include <string.h>    /* memcpy */
+#include <unistd.h>    /* sysconf */
+#include "common.h"
+#include "ipc.h"
+#include "sbma.h"
+#include "vmm.h"
+
+
+/****************************************************************************/
+/*! Fill in the statistics of the calling process, or of the node, depending
+ *  on scope, see enum sbma_stats_scope. At most size bytes of stats are
+ *  filled in, so that a program built against an older struct sbma_stats
+ *  keeps working, and stats->version and stats->size tell which fields were
+ *  filled in. Fails with EINVAL if size does not cover the version and size
+ *  fields, if scope is invalid, or if the node scope is asked for outside of
+ *  SBMA_init() and SBMA_destroy(). */
+/****************************************************************************/
+SBMA_EXTERN int
+sbma_mstats(struct sbma_stats * const __stats, size_t const __size,
+            int const __scope)
+{
+  int i;
+  uint64_t sys_size;
+  struct sbma_stats stats;
+  struct ipc * ipc;
+
+  ipc = &(_vmm_.ipc);
+
+  if (NULL == __stats || offsetof(struct sbma_stats, numrf) > __size ||\
+      (SBMA_STATS_PROC != __scope && SBMA_STATS_NODE != __scope) ||\
+      (SBMA_STATS_NODE == __scope && NULL == ipc->n_stat))
+  {
+    errno = EINVAL;
+    return -1;
+  }
+
+  sys_size = (uint64_t)sysconf(_SC_PAGESIZE);
+
+  if (SBMA_STATS_PROC == __scope) {
+    memcpy(&stats, (void*)&(ipc->stat), sizeof(stats));
+
+    /* Once the process has left the node, only its memory on leaving is
+     * known. */
+    if (1 == ipc->init) {
+      stats.memrs = ipc->slot[ipc->id].c_mem*sys_size;
+      stats.mempn = ipc->slot[ipc->id].p_mem*sys_size;
+      stats.memdt = ipc->slot[ipc->id].d_mem*sys_size;
+    }
+    else {
+      stats.memrs = ipc->curpages*sys_size;
+    }
+    stats.memhw = ipc->maxpages*sys_size;
+  }
+  else {
+    /*=======================================================================*/
+    IPC_INTER_CRITICAL_SECTION_BEG(ipc);
+    /*=======================================================================*/
+
+    memcpy(&stats, (void*)ipc->n_stat, sizeof(stats));
+
+    stats.memrs = (*ipc->t_mem-*ipc->s_mem)*sys_size;
+    for (i=0; i<ipc->n_procs; ++i) {
+      if (0 == ipc->slot[i].pid)
+        continue;
+      stats.mempn += ipc->slot[i].p_mem*sys_size;
+      stats.memdt += ipc->slot[i].d_mem*sys_size;
+    }
+
+    /*=======================================================================*/
+    IPC_INTER_CRITICAL_SECTION_END(ipc);
+    /*=======================================================================*/
+  }
+
+  stats.version = SBMA_STATS_VERSION;
+  stats.size    = (__size < sizeof(stats)) ? __size : sizeof(stats);
+
+  memcpy(__stats, &stats, stats.size);
+
+  return 0;
+}
+
+
+#ifdef TEST
+int
+main(int argc, char * argv[])
+{
+  if (0 == argc || NULL == argv) {}
+
+  return 0;
+}
+#endif
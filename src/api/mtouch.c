@@ -29,7 +29,9 @@ THE SOFTWARE.
 #include <stdarg.h>    /* stdarg library */
 #include <stdint.h>    /* uint8_t, uintptr_t */
 #include <stddef.h>    /* NULL, size_t */
+#include <sys/mman.h>  /* mmap, munmap */
 #include <sys/types.h> /* ssize_t */
+#include <sys/uio.h>   /* struct iovec */
 #include <time.h>      /* struct timespec */
 #include "common.h"
 #include "ipc.h"
@@ -49,13 +51,13 @@ sbma_mtouch_probe(struct ate * const __ate, void * const __addr,
   size_t ip, beg, end, page_size, c_pages;
   volatile uint8_t * flags;
 
-  if (((VMM_AGGCH|VMM_LZYRD) == (_vmm_.opts&(VMM_AGGCH|VMM_LZYRD))) &&\
+  if (((VMM_AGGCH|VMM_LZYRD) == (__ate->opts&(VMM_AGGCH|VMM_LZYRD))) &&\
       (0 == __ate->c_pages))
   {
-    return VMM_TO_SYS(__ate->n_pages);
+    return VMM_TO_SYS(__ate->page_size, __ate->n_pages);
   }
 
-  page_size = _vmm_.page_size;
+  page_size = __ate->page_size;
   flags     = __ate->flags;
 
   /* need to make sure that all bytes are captured, thus beg is a floor
@@ -70,21 +72,22 @@ sbma_mtouch_probe(struct ate * const __ate, void * const __addr,
     }
   }
 
-  return VMM_TO_SYS(c_pages);
+  return VMM_TO_SYS(page_size, c_pages);
 }
 
 
 /****************************************************************************/
-/*! Internal: Touch the specified range. */
+/*! Internal: Touch the specified range. If ghost is VMM_GHOST, the pages
+ *  are read as for an allocation with ghost pages. */
 /****************************************************************************/
 SBMA_STATIC ssize_t
 sbma_mtouch_int(struct ate * const __ate, void * const __addr,
-                size_t const __len)
+                size_t const __len, int const __ghost)
 {
   size_t i, beg, end, page_size;
   ssize_t numrd;
 
-  if (((VMM_AGGCH|VMM_LZYRD) == (_vmm_.opts&(VMM_AGGCH|VMM_LZYRD))) &&\
+  if (((VMM_AGGCH|VMM_LZYRD) == (__ate->opts&(VMM_AGGCH|VMM_LZYRD))) &&\
       (0 == __ate->c_pages))
   {
     for (i=0; i<__ate->n_pages; ++i) {
@@ -94,25 +97,28 @@ sbma_mtouch_int(struct ate * const __ate, void * const __addr,
     __ate->c_pages = __ate->n_pages;
   }
 
-  page_size = _vmm_.page_size;
+  page_size = __ate->page_size;
 
   /* need to make sure that all bytes are captured, thus beg is a floor
    * operation and end is a ceil operation. */
   beg = ((uintptr_t)__addr-__ate->base)/page_size;
   end = 1+(((uintptr_t)__addr+__len-__ate->base-1)/page_size);
 
-  numrd = vmm_swap_i(__ate, beg, end-beg, _vmm_.opts&VMM_GHOST);
+  numrd = vmm_swap_i(__ate, beg, end-beg, (__ate->opts|__ghost)&VMM_GHOST);
   if (-1 == numrd)
     return -1;
-  return VMM_TO_SYS(numrd);
+  return VMM_TO_SYS(page_size, numrd);
 }
 
 
 /****************************************************************************/
-/*! Touch the specified range. */
+/*! Touch the specified range. If ghost is VMM_GHOST, the pages are read as
+ *  for an allocation with ghost pages, so that the memory may be accessed
+ *  while it is being read. */
 /****************************************************************************/
 SBMA_EXTERN ssize_t
-sbma_mtouch(void * const __ate, void * const __addr, size_t const __len)
+sbma_mtouch_ex(void * const __ate, void * const __addr, size_t const __len,
+               int const __ghost)
 {
   int ret;
   ssize_t c_pages, numrd=0;
@@ -143,14 +149,15 @@ sbma_mtouch(void * const __ate, void * const __addr, size_t const __len)
     if (0 == c_pages)
       break;
 
-    ret = ipc_madmit(&(_vmm_.ipc), c_pages, _vmm_.opts&VMM_ADMITD);
+    ret = ipc_madmit(&(_vmm_.ipc), c_pages,\
+      _vmm_.opts&(VMM_ADMITD|VMM_ADMITF));
     if (-1 == ret)
       goto CLEANUP;
     else if (-2 != ret)
       break;
   }
 
-  numrd = sbma_mtouch_int(ate, __addr, __len);
+  numrd = sbma_mtouch_int(ate, __addr, __len, __ghost);
   if (-1 == numrd)
     goto CLEANUP;
 
@@ -165,10 +172,8 @@ sbma_mtouch(void * const __ate, void * const __addr, size_t const __len)
   SBMA_STATE_CHECK();
   /*========================================================================*/
 
-  VMM_INTRA_CRITICAL_SECTION_BEG(&_vmm_);
-  VMM_TRACK(&_vmm_, numrd, numrd);
-  VMM_TRACK(&_vmm_, tmrrd, (double)tmr.tv_sec+(double)tmr.tv_nsec/1000000000.0);
-  VMM_INTRA_CRITICAL_SECTION_END(&_vmm_);
+  VMM_TRACK(&_vmm_, bytrd, VMM_SYS_BYTES(numrd));
+  VMM_TRACK(&_vmm_, tmrrd, VMM_TO_NSEC(&(tmr)));
 
   return c_pages;
 
@@ -182,6 +187,16 @@ sbma_mtouch(void * const __ate, void * const __addr, size_t const __len)
 }
 
 
+/****************************************************************************/
+/*! Touch the specified range. */
+/****************************************************************************/
+SBMA_EXTERN ssize_t
+sbma_mtouch(void * const __ate, void * const __addr, size_t const __len)
+{
+  return sbma_mtouch_ex(__ate, __addr, __len, 0);
+}
+
+
 /****************************************************************************/
 /*! Touch the specified ranges. */
 /****************************************************************************/
@@ -231,8 +246,8 @@ sbma_mtouch_atomic(void * const __addr, size_t const __len, ...)
         mxlen_ = (uintptr_t)_addr == max_ ? _len : len[i];
         mnate_ = (uintptr_t)_addr == min_ ? _ate : ate[i];
         mxate_ = (uintptr_t)_addr == max_ ? _ate : ate[i];
-        mnend_ = 1+((min_+mnlen_-mnate_->base-1)/_vmm_.page_size);
-        mxbeg_ = (max_-mxate_->base)/_vmm_.page_size;
+        mnend_ = 1+((min_+mnlen_-mnate_->base-1)/mnate_->page_size);
+        mxbeg_ = (max_-mxate_->base)/mxate_->page_size;
 
         /* overlapping page ranges of _ate */
         if (mnend_ >= mxbeg_) {
@@ -292,7 +307,7 @@ sbma_mtouch_atomic(void * const __addr, size_t const __len, ...)
        *  3) mprobe actually computes the number of pages to be charged,
        *     doesn't just shortcut and return ate->n_pages. It is sufficient
        *     to check if 0 != ate[i]->c_pages to satisfy this. */
-      if (((VMM_AGGCH|VMM_LZYRD) != (_vmm_.opts&(VMM_AGGCH|VMM_LZYRD))) ||\
+      if (((VMM_AGGCH|VMM_LZYRD) != (ate[i]->opts&(VMM_AGGCH|VMM_LZYRD))) ||\
           (0 == dup[i]) || (0 != ate[i]->c_pages))
       {
         _c_pages = sbma_mtouch_probe(ate[i], addr[i], len[i]);
@@ -309,7 +324,8 @@ sbma_mtouch_atomic(void * const __addr, size_t const __len, ...)
     if (0 == c_pages)
       break;
 
-    ret = ipc_madmit(&(_vmm_.ipc), c_pages, _vmm_.opts&VMM_ADMITD);
+    ret = ipc_madmit(&(_vmm_.ipc), c_pages,\
+      _vmm_.opts&(VMM_ADMITD|VMM_ADMITF));
     if (-1 == ret)
       goto CLEANUP;
     else if (-2 != ret)
@@ -318,7 +334,7 @@ sbma_mtouch_atomic(void * const __addr, size_t const __len, ...)
 
   /* touch each of the pointers */
   for (numrd=0,i=0; i<num; ++i) {
-    _numrd = sbma_mtouch_int(ate[i], addr[i], len[i]);
+    _numrd = sbma_mtouch_int(ate[i], addr[i], len[i], 0);
     if (-1 == _numrd)
       goto CLEANUP;
     numrd += _numrd;
@@ -335,10 +351,8 @@ sbma_mtouch_atomic(void * const __addr, size_t const __len, ...)
   SBMA_STATE_CHECK();
   /*========================================================================*/
 
-  VMM_INTRA_CRITICAL_SECTION_BEG(&_vmm_);
-  VMM_TRACK(&_vmm_, numrd, numrd);
-  VMM_TRACK(&_vmm_, tmrrd, (double)tmr.tv_sec+(double)tmr.tv_nsec/1000000000.0);
-  VMM_INTRA_CRITICAL_SECTION_END(&_vmm_);
+  VMM_TRACK(&_vmm_, bytrd, VMM_SYS_BYTES(numrd));
+  VMM_TRACK(&_vmm_, tmrrd, VMM_TO_NSEC(&(tmr)));
 
   return c_pages;
 
@@ -353,6 +367,128 @@ sbma_mtouch_atomic(void * const __addr, size_t const __len, ...)
 }
 
 
+/****************************************************************************/
+/*! Touch the specified ranges. Unlike sbma_mtouch_atomic(), the number of
+ *  ranges is not limited. The ranges are sorted and merged per allocation,
+ *  admitted with a single request, and read one contiguous run of pages at a
+ *  time. */
+/****************************************************************************/
+SBMA_EXTERN ssize_t
+sbma_mtouchv(struct iovec const * const __iov, size_t const __num)
+{
+  int ret;
+  size_t i, num, c_pages;
+  ssize_t _c_pages, _numrd, numrd=0, retval=-1;
+  struct timespec tmr;
+  struct mmu_run * run, stk[SBMA_ATOMIC_MAX];
+
+  if (0 == __num)
+    return 0;
+
+  /*========================================================================*/
+  SBMA_STATE_CHECK();
+  TIMER_START(&(tmr));
+  /*========================================================================*/
+
+  /* Small vectors are merged on the stack, larger ones in scratch memory
+   * which is not managed by the runtime. */
+  if (__num <= SBMA_ATOMIC_MAX) {
+    run = stk;
+  }
+  else {
+    run = mmap(NULL, __num*sizeof(*run), PROT_READ|PROT_WRITE,\
+      MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+    if (MAP_FAILED == run)
+      return -1;
+  }
+
+  for (i=0; i<__num; ++i) {
+    run[i].ate = NULL;
+    run[i].beg = (uintptr_t)__iov[i].iov_base;
+    run[i].end = (uintptr_t)__iov[i].iov_base+__iov[i].iov_len;
+  }
+
+  /* lock the allocations, in order of address, and merge the ranges */
+  _c_pages = mmu_lookup_vec(&(_vmm_.mmu), run, __num);
+  if (-1 == _c_pages)
+    goto RETURN;
+  num = (size_t)_c_pages;
+
+  /* check memory file to see if there is enough free memory to admit the
+   * required amount of memory. */
+  for (;;) {
+    for (c_pages=0,i=0; i<num; ++i) {
+      /* With aggressive charging, the first probe of an uncharged ate
+       * counts all of its pages, so its other ranges are not counted. */
+      if (((VMM_AGGCH|VMM_LZYRD) ==\
+           (run[i].ate->opts&(VMM_AGGCH|VMM_LZYRD))) &&\
+          (0 == run[i].ate->c_pages) && (0 != i) &&\
+          (run[i].ate == run[i-1].ate))
+      {
+        continue;
+      }
+
+      _c_pages = sbma_mtouch_probe(run[i].ate,\
+        (void*)(run[i].ate->base+run[i].beg*run[i].ate->page_size),\
+        (run[i].end-run[i].beg)*run[i].ate->page_size);
+      if (-1 == _c_pages)
+        goto CLEANUP;
+
+      c_pages += _c_pages;
+    }
+
+    if (0 == c_pages)
+      break;
+
+    ret = ipc_madmit(&(_vmm_.ipc), c_pages,\
+      _vmm_.opts&(VMM_ADMITD|VMM_ADMITF));
+    if (-1 == ret)
+      goto CLEANUP;
+    else if (-2 != ret)
+      break;
+  }
+
+  /* touch each of the ranges */
+  for (numrd=0,i=0; i<num; ++i) {
+    _numrd = sbma_mtouch_int(run[i].ate,\
+      (void*)(run[i].ate->base+run[i].beg*run[i].ate->page_size),\
+      (run[i].end-run[i].beg)*run[i].ate->page_size, 0);
+    if (-1 == _numrd)
+      goto CLEANUP;
+    numrd += _numrd;
+  }
+
+  retval = c_pages;
+
+  CLEANUP:
+  /* release the lock of each allocation once */
+  for (i=0; i<num; ++i) {
+    if (i+1 == num || run[i].ate != run[i+1].ate) {
+      ret = lock_let(&(run[i].ate->lock));
+      ASSERT(-1 != ret);
+    }
+  }
+
+  if (-1 == retval)
+    goto RETURN;
+
+  /*========================================================================*/
+  TIMER_STOP(&(tmr));
+  SBMA_STATE_CHECK();
+  /*========================================================================*/
+
+  VMM_TRACK(&_vmm_, bytrd, VMM_SYS_BYTES(numrd));
+  VMM_TRACK(&_vmm_, tmrrd, VMM_TO_NSEC(&(tmr)));
+
+  RETURN:
+  if (stk != run) {
+    ret = munmap(run, __num*sizeof(*run));
+    ASSERT(-1 != ret);
+  }
+  return retval;
+}
+
+
 /****************************************************************************/
 /*! Touch all allocations. */
 /****************************************************************************/
@@ -391,7 +527,7 @@ sbma_mtouchall(void)
   for (;;) {
     for (c_pages=0,ate=_vmm_.mmu.a_tbl; NULL!=ate; ate=ate->next) {
       retval = sbma_mtouch_probe(ate, (void*)ate->base,\
-        ate->n_pages*_vmm_.page_size);
+        ate->n_pages*ate->page_size);
       if (-1 == retval)
         goto CLEANUP;
       c_pages += retval;
@@ -400,7 +536,8 @@ sbma_mtouchall(void)
     if (0 == c_pages)
       break;
 
-    ret = ipc_madmit(&(_vmm_.ipc), c_pages, _vmm_.opts&VMM_ADMITD);
+    ret = ipc_madmit(&(_vmm_.ipc), c_pages,\
+      _vmm_.opts&(VMM_ADMITD|VMM_ADMITF));
     if (-1 == ret)
       goto CLEANUP;
     else if (-2 != ret)
@@ -410,7 +547,7 @@ sbma_mtouchall(void)
   /* touch the memory */
   for (numrd=0,ate=_vmm_.mmu.a_tbl; NULL!=ate; ate=ate->next) {
     retval = sbma_mtouch_int(ate, (void*)ate->base,\
-      ate->n_pages*_vmm_.page_size);
+      ate->n_pages*ate->page_size, 0);
     if (-1 == retval)
       goto CLEANUP;
     ASSERT(ate->l_pages == ate->n_pages);
@@ -433,10 +570,8 @@ sbma_mtouchall(void)
   SBMA_STATE_CHECK();
   /*========================================================================*/
 
-  VMM_INTRA_CRITICAL_SECTION_BEG(&_vmm_);
-  VMM_TRACK(&_vmm_, numrd, numrd);
-  VMM_TRACK(&_vmm_, tmrrd, (double)tmr.tv_sec+(double)tmr.tv_nsec/1000000000.0);
-  VMM_INTRA_CRITICAL_SECTION_END(&_vmm_);
+  VMM_TRACK(&_vmm_, bytrd, VMM_SYS_BYTES(numrd));
+  VMM_TRACK(&_vmm_, tmrrd, VMM_TO_NSEC(&(tmr)));
 
   return c_pages;
 
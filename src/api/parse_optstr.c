@@ -47,7 +47,8 @@ sbma_parse_optstr(char const * const __opt_str)
 {
   int opts=0, seen=0;
   int all=(VMM_RSDNT|VMM_LZYRD|VMM_AGGCH|VMM_GHOST|VMM_MERGE|VMM_METACH|\
-    VMM_MLOCK|VMM_CHECK|VMM_EXTRA|VMM_OSVMM);
+    VMM_MLOCK|VMM_CHECK|VMM_EXTRA|VMM_OSVMM|VMM_ADAPT|VMM_AUTOSIG|VMM_LEARN|\
+    VMM_SITES|VMM_PROF);
   char * tok;
   char str[512];
 
@@ -68,11 +69,14 @@ sbma_parse_optstr(char const * const __opt_str)
     else if (SBMA_OPTCMP(VMM_LZYRD, seen, tok, "lzyrd", 5)) {
       opts |= VMM_LZYRD;
     }
-    else if (SBMA_OPTCMP(VMM_ADMITD, seen, tok, "admitr", 6)) {
+    else if (SBMA_OPTCMP((VMM_ADMITD|VMM_ADMITF), seen, tok, "admitr", 6)) {
     }
-    else if (SBMA_OPTCMP(VMM_ADMITD, seen, tok, "admitd", 6)) {
+    else if (SBMA_OPTCMP((VMM_ADMITD|VMM_ADMITF), seen, tok, "admitd", 6)) {
       opts |= VMM_ADMITD;
     }
+    else if (SBMA_OPTCMP((VMM_ADMITD|VMM_ADMITF), seen, tok, "admitf", 6)) {
+      opts |= VMM_ADMITF;
+    }
     else if (SBMA_OPTCMP(VMM_AGGCH, seen, tok, "noaggch", 7)) {
     }
     else if (SBMA_OPTCMP(VMM_AGGCH, seen, tok, "aggch", 5)) {
@@ -106,6 +110,31 @@ sbma_parse_optstr(char const * const __opt_str)
     else if (SBMA_OPTCMP((VMM_CHECK|VMM_EXTRA), seen, tok, "extra", 5)) {
       opts |= (VMM_CHECK|VMM_EXTRA);
     }
+    else if (SBMA_OPTCMP(VMM_ADAPT, seen, tok, "noadapt", 7)) {
+    }
+    else if (SBMA_OPTCMP(VMM_ADAPT, seen, tok, "adapt", 5)) {
+      opts |= VMM_ADAPT;
+    }
+    else if (SBMA_OPTCMP(VMM_AUTOSIG, seen, tok, "noautosig", 9)) {
+    }
+    else if (SBMA_OPTCMP(VMM_AUTOSIG, seen, tok, "autosig", 7)) {
+      opts |= VMM_AUTOSIG;
+    }
+    else if (SBMA_OPTCMP(VMM_LEARN, seen, tok, "nolearn", 7)) {
+    }
+    else if (SBMA_OPTCMP(VMM_LEARN, seen, tok, "learn", 5)) {
+      opts |= VMM_LEARN;
+    }
+    else if (SBMA_OPTCMP(VMM_SITES, seen, tok, "nosites", 7)) {
+    }
+    else if (SBMA_OPTCMP(VMM_SITES, seen, tok, "sites", 5)) {
+      opts |= VMM_SITES;
+    }
+    else if (SBMA_OPTCMP(VMM_PROF, seen, tok, "noprof", 6)) {
+    }
+    else if (SBMA_OPTCMP(VMM_PROF, seen, tok, "prof", 4)) {
+      opts |= VMM_PROF;
+    }
     else if (SBMA_OPTCMP(VMM_OSVMM, seen, tok, "noosvmm", 7)) {
     }
     else if (SBMA_OPTCMP(VMM_OSVMM, seen, tok, "osvmm", 5)) {
@@ -0,0 +1,288 @@
+/*
+Copyright (c) 2015,2016 Jeremy Iverson
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+
+#ifndef _GNU_SOURCE
+# define _GNU_SOURCE 1
+#endif
+
+
+#include <errno.h>     /* EBUSY */
+#include <stddef.h>    /* NULL, size_t */
+#include <stdint.h>    /* uint8_t, uintptr_t */
+#include <sys/mman.h>  /* mmap, munmap */
+#include <sys/types.h> /* ssize_t */
+#include <sys/uio.h>   /* struct iovec */
+#include <time.h>      /* struct timespec */
+#include "common.h"
+#include "ipc.h"
+#include "lock.h"
+#include "mmu.h"
+#include "sbma.h"
+#include "vmm.h"
+
+
+/****************************************************************************/
+/*! Internal: Evict the pages [beg..end) of an allocation, or only its runs
+ *  of clean pages if dirty is zero, from the start, until max system pages
+ *  have been released. The system pages released, of which dirty, and
+ *  written, and the nanoseconds spent writing, are added to c_pages,
+ *  d_pages, numwr and tmrwr. */
+/****************************************************************************/
+SBMA_STATIC int
+sbma_phase_evict(struct ate * const __ate, size_t const __beg,
+                 size_t const __end, int const __dirty, size_t const __max,
+                 size_t * const __c_pages, size_t * const __d_pages,
+                 size_t * const __numwr, uint64_t * const __tmrwr)
+{
+  size_t ip, jp, kp, n_pages, c_pages, d_pages;
+  ssize_t numwr;
+  struct timespec tmr;
+  volatile uint8_t * flags;
+
+  flags = __ate->flags;
+
+  for (ip=__beg; ip<__end && *__c_pages<__max; ip=jp) {
+    if (0 == __dirty) {
+      for (; ip<__end && MMU_DIRTY==(flags[ip]&MMU_DIRTY); ++ip);
+      for (jp=ip; jp<__end && MMU_DIRTY!=(flags[jp]&MMU_DIRTY); ++jp);
+      if (ip == jp)
+        break;
+    }
+    else {
+      jp = __end;
+    }
+
+    /* evict no more of the run than the memory which is still lacking */
+    for (n_pages=0,kp=ip; kp<jp; ++kp) {
+      if (VMM_TO_SYS(__ate->page_size, n_pages) >= __max-*__c_pages)
+        break;
+      if (MMU_CHRGD != (flags[kp]&MMU_CHRGD)) /* is charged */
+        n_pages++;
+    }
+    jp = kp;
+
+    c_pages = __ate->c_pages;
+    d_pages = __ate->d_pages;
+
+    TIMER_START(&(tmr));
+    numwr = vmm_swap_o(__ate, ip, jp-ip);
+    if (-1 == numwr)
+      return -1;
+    TIMER_STOP(&(tmr));
+
+    *__c_pages += VMM_TO_SYS(__ate->page_size, c_pages-__ate->c_pages);
+    *__d_pages += VMM_TO_SYS(__ate->page_size, d_pages-__ate->d_pages);
+    *__numwr   += VMM_TO_SYS(__ate->page_size, numwr);
+    if (0 != numwr)
+      *__tmrwr += VMM_TO_NSEC(&(tmr));
+  }
+
+  return 0;
+}
+
+
+/****************************************************************************/
+/*! Begin a phase whose working set is the specified ranges. The previous
+ *  phase, if any, ends. Memory outside of the working set is evicted, clean
+ *  pages first, until the working set fits into the free memory, then the
+ *  whole working set is admitted with a single request and read, as
+ *  SBMA_mtouchv() does. While the phase lasts, the allocations of the
+ *  working set are evicted and cleaned after all others. Returns the number
+ *  of system pages read. */
+/****************************************************************************/
+SBMA_EXTERN ssize_t
+sbma_phase_begin(struct iovec const * const __iov, size_t const __num)
+{
+  int ret, dirty;
+  size_t i, ip, num, beg, end, n_pages, need, avail, max;
+  size_t c_pages=0, d_pages=0, numwr=0;
+  uint64_t tmrwr=0;
+  ssize_t _num, retval=-1;
+  struct timespec tmr;
+  struct ate * ate;
+  struct mmu_run * run, stk[SBMA_ATOMIC_MAX];
+
+  /*========================================================================*/
+  SBMA_STATE_CHECK();
+  /*========================================================================*/
+
+  /* Small vectors are merged on the stack, larger ones in scratch memory
+   * which is not managed by the runtime. */
+  if (__num <= SBMA_ATOMIC_MAX) {
+    run = stk;
+  }
+  else {
+    run = mmap(NULL, __num*sizeof(*run), PROT_READ|PROT_WRITE,\
+      MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+    if (MAP_FAILED == run)
+      return -1;
+  }
+
+  for (i=0; i<__num; ++i) {
+    run[i].ate = NULL;
+    run[i].beg = (uintptr_t)__iov[i].iov_base;
+    run[i].end = (uintptr_t)__iov[i].iov_base+__iov[i].iov_len;
+  }
+
+  /* Hold the mmu lock while walking the allocation table, it is acquired
+   * before the ate locks, as mmu_lookup_vec() does. */
+  ret = lock_get(&(_vmm_.mmu.lock));
+  if (-1 == ret)
+    goto RETURN;
+
+  /* lock the allocations of the working set, in order of address, and merge
+   * the ranges */
+  _num = mmu_lookup_vec(&(_vmm_.mmu), run, __num);
+  if (-1 == _num) {
+    ret = lock_let(&(_vmm_.mmu.lock));
+    ASSERT(-1 != ret);
+    goto RETURN;
+  }
+  num = (size_t)_num;
+
+  /* mark the allocations of the working set, and count the memory which must
+   * be charged to read it */
+  for (ate=_vmm_.mmu.a_tbl; NULL!=ate; ate=ate->next)
+    ate->phase = 0;
+  for (need=0,i=0; i<num; ++i) {
+    run[i].ate->phase = 1;
+    for (n_pages=0,ip=run[i].beg; ip<run[i].end; ++ip) {
+      if (MMU_CHRGD == (run[i].ate->flags[ip]&MMU_CHRGD)) /* not charged */
+        n_pages++;
+    }
+    need += VMM_TO_SYS(run[i].ate->page_size, n_pages);
+  }
+
+  /* evict the gaps between the runs of each allocation, clean pages in a
+   * first pass, so that nothing is written if they suffice, and allocations
+   * which are in use by the application are skipped */
+  TIMER_START(&(tmr));
+  avail = *_vmm_.ipc.s_mem+_vmm_.ipc.credit+\
+    _vmm_.ipc.slot[_vmm_.ipc.id].r_mem;
+  max   = (need > avail) ? need-avail : 0;
+  for (dirty=0; dirty<2 && c_pages<max; ++dirty) {
+    for (ate=_vmm_.mmu.a_tbl; NULL!=ate && c_pages<max; ate=ate->next) {
+      ret = lock_try(&(ate->lock));
+      if (EBUSY == ret)
+        continue;
+      ERRCHK(CLEANUP2, 0 != ret);
+
+      for (i=0; i<num && ate!=run[i].ate; ++i);
+      for (beg=0; ; ++i) {
+        end = (i < num && ate == run[i].ate) ? run[i].beg : ate->n_pages;
+        ret = sbma_phase_evict(ate, beg, end, dirty, max, &c_pages, &d_pages,\
+          &numwr, &tmrwr);
+        ERRCHK(CLEANUP3, -1 == ret);
+        if (i == num || ate != run[i].ate)
+          break;
+        beg = run[i].end;
+      }
+
+      ret = lock_let(&(ate->lock));
+      ERRCHK(CLEANUP2, 0 != ret);
+    }
+  }
+
+  retval = 0;
+  goto CLEANUP2;
+
+  CLEANUP3:
+  ret = lock_let(&(ate->lock));
+  ASSERT(-1 != ret);
+  CLEANUP2:
+  /* release the lock of each allocation once */
+  for (i=0; i<num; ++i) {
+    if (i+1 == num || run[i].ate != run[i+1].ate) {
+      ret = lock_let(&(run[i].ate->lock));
+      ASSERT(-1 != ret);
+    }
+  }
+  ret = lock_let(&(_vmm_.mmu.lock));
+  ASSERT(-1 != ret);
+
+  /* update memory file */
+  for (;;) {
+    ret = ipc_mevict(&(_vmm_.ipc), c_pages, d_pages);
+    if (-1 == ret)
+      retval = -1;
+    if (-2 != ret)
+      break;
+  }
+
+  /*========================================================================*/
+  TIMER_STOP(&(tmr));
+  /*========================================================================*/
+
+  VMM_TRACK(&_vmm_, bytwr, VMM_SYS_BYTES(numwr));
+  VMM_TRACK(&_vmm_, tmrwr, tmrwr);
+  VMM_TRACK(&_vmm_, tmrev, VMM_TO_NSEC(&(tmr)));
+
+  if (-1 == retval)
+    goto RETURN;
+
+  /* admit and read the working set */
+  retval = sbma_mtouchv(__iov, __num);
+
+  RETURN:
+  if (stk != run) {
+    ret = munmap(run, __num*sizeof(*run));
+    ASSERT(-1 != ret);
+  }
+  return retval;
+}
+
+
+/****************************************************************************/
+/*! End the current phase, after which the allocations of its working set
+ *  are evicted and cleaned according to their priority again. */
+/****************************************************************************/
+SBMA_EXTERN int
+sbma_phase_end(void)
+{
+  int ret;
+  struct ate * ate;
+
+  ret = lock_get(&(_vmm_.mmu.lock));
+  if (-1 == ret)
+    return -1;
+
+  for (ate=_vmm_.mmu.a_tbl; NULL!=ate; ate=ate->next)
+    ate->phase = 0;
+
+  ret = lock_let(&(_vmm_.mmu.lock));
+  if (-1 == ret)
+    return -1;
+
+  return 0;
+}
+
+
+#ifdef TEST
+int
+main(int argc, char * argv[])
+{
+  if (0 == argc || NULL == argv) {}
+
+  return 0;
+}
+#endif
@@ -35,6 +35,7 @@ THE SOFTWARE.
 #include <unistd.h>    /* truncate */
 #include "common.h"
 #include "ipc.h"
+#include "lock.h"
 #include "mmu.h"
 #include "sbma.h"
 #include "vmm.h"
@@ -47,8 +48,9 @@ SBMA_EXTERN void *
 sbma_realloc(void * const __ptr, size_t const __size)
 {
   int ret;
-  size_t i, ifirst, page_size, s_pages, on_pages, of_pages, ol_pages, oc_pages;
-  size_t od_pages, nn_pages, nf_pages;
+  size_t i, ifirst, page_size, meta_size, s_size, o_size, n_size, s_pages;
+  size_t on_pages, of_pages, ol_pages, oc_pages, od_pages, op_pages, nn_pages;
+  size_t nf_pages;
   uint8_t oflag;
   uintptr_t oaddr, naddr;
   void * retval;
@@ -70,21 +72,37 @@ sbma_realloc(void * const __ptr, size_t const __size)
   /* Default return value. */
   retval = NULL;
 
-  page_size = _vmm_.page_size;
-  s_pages   = 1+((sizeof(struct ate)-1)/page_size);
-  ate       = (struct ate*)((uintptr_t)__ptr-(s_pages*page_size));
+  /* The allocation keeps the page size of its app pages, struct and flag
+   * pages use the page size of the vmm. */
+  meta_size = _vmm_.page_size;
+  s_pages   = 1+((sizeof(struct ate)-1)/meta_size);
+  s_size    = s_pages*meta_size;
+  ate       = (struct ate*)((uintptr_t)__ptr-s_size);
+  page_size = ate->page_size;
   oaddr     = (uintptr_t)ate;
   oflags    = ate->flags;
   on_pages  = ate->n_pages;
-  of_pages  = 1+((on_pages*sizeof(uint8_t)-1)/page_size);
+  of_pages  = 1+((on_pages*sizeof(uint8_t)-1)/meta_size);
   nn_pages  = 1+((__size-1)/page_size);
-  nf_pages  = 1+((nn_pages*sizeof(uint8_t)-1)/page_size);
+  nf_pages  = 1+((nn_pages*sizeof(uint8_t)-1)/meta_size);
+  o_size    = s_size+on_pages*page_size+of_pages*meta_size;
+  n_size    = s_size+nn_pages*page_size+nf_pages*meta_size;
 
   if (nn_pages == on_pages) {
     /* do nothing */
     retval = (void*)ate->base;
   }
   else if (nn_pages < on_pages) {
+    /* hold the ate lock so that the eviction thread does not operate on the
+     * allocation while it is being resized */
+    ret = lock_get(&(ate->lock));
+    if (-1 == ret)
+      return NULL;
+
+    oc_pages = ate->c_pages;
+    od_pages = ate->d_pages;
+    op_pages = ate->p_pages;
+
     /* adjust c_pages for the pages which will be unmapped */
     ate->n_pages = nn_pages;
     for (i=nn_pages; i<on_pages; ++i) {
@@ -100,71 +118,83 @@ sbma_realloc(void * const __ptr, size_t const __size)
         ASSERT(ate->d_pages > 0);
         ate->d_pages--;
       }
+      if (MMU_PINND == (oflags[i]&MMU_PINND)) {
+        ASSERT(ate->p_pages > 0);
+        ate->p_pages--;
+      }
     }
 
     /* update protection for new page flags area of allocation */
-    ret = mprotect((void*)(oaddr+((s_pages+nn_pages)*page_size)),\
-      nf_pages*page_size, PROT_READ|PROT_WRITE);
+    ret = mprotect((void*)(oaddr+(s_size+nn_pages*page_size)),\
+      nf_pages*meta_size, PROT_READ|PROT_WRITE);
     if (-1 == ret)
-      return NULL;
+      goto UNLOCK;
 
     if (VMM_MLOCK == (_vmm_.opts&VMM_MLOCK)) {
       /* lock new page flags area of allocation into RAM */
-      ret = libc_mlock((void*)(oaddr+((s_pages+nn_pages)*page_size)),\
-        nf_pages*page_size);
+      ret = libc_mlock((void*)(oaddr+(s_size+nn_pages*page_size)),\
+        nf_pages*meta_size);
       if (-1 == ret)
-        return NULL;
+        goto UNLOCK;
     }
 
     /* copy page flags to new location */
-    libc_memmove((void*)(oaddr+((s_pages+nn_pages)*page_size)),\
-      (void*)(oaddr+((s_pages+on_pages)*page_size)), nf_pages*page_size);
+    libc_memmove((void*)(oaddr+(s_size+nn_pages*page_size)),\
+      (void*)(oaddr+(s_size+on_pages*page_size)), nf_pages*meta_size);
+    ate->flags = (uint8_t*)(oaddr+(s_size+nn_pages*page_size));
 
     /* unmap unused section of memory */
-    ret = munmap((void*)(oaddr+((s_pages+nn_pages+nf_pages)*page_size)),\
-      ((on_pages-nn_pages)+(of_pages-nf_pages))*page_size);
+    ret = munmap((void*)(oaddr+n_size),\
+      (on_pages-nn_pages)*page_size+(of_pages-nf_pages)*meta_size);
     if (-1 == ret)
-      return NULL;
+      goto UNLOCK;
+    VMM_TRACK(&_vmm_, memal, -(uint64_t)((on_pages-nn_pages)*page_size));
 
     /* update memory file */
+    ret = ipc_mpin(&(_vmm_.ipc),\
+      -VMM_TO_SYS(page_size, op_pages-ate->p_pages));
+    if (-1 == ret)
+      goto UNLOCK;
     for (;;) {
-      ol_pages = ate->l_pages;
-      oc_pages = ate->c_pages;
-      od_pages = ate->d_pages;
-
       ret = ipc_mevict(&(_vmm_.ipc),\
-        VMM_TO_SYS((oc_pages-ate->c_pages)+(of_pages-nf_pages)),\
-        VMM_TO_SYS(od_pages));
+        VMM_TO_SYS(page_size, oc_pages-ate->c_pages)+\
+        VMM_TO_SYS(meta_size, of_pages-nf_pages),\
+        VMM_TO_SYS(page_size, od_pages-ate->d_pages));
       if (-1 == ret)
-        return NULL;
+        goto UNLOCK;
       else if (-2 != ret)
         break;
     }
 
     retval = (void*)ate->base;
+
+    UNLOCK:
+    ret = lock_let(&(ate->lock));
+    if (-1 == ret)
+      retval = NULL;
   }
   else {
     /* check memory file to see if there is enough free memory to complete
      * this allocation. */
     for (;;) {
-      ol_pages = ate->l_pages;
-      oc_pages = ate->c_pages;
-
       if (VMM_METACH == (_vmm_.opts&VMM_METACH)) {
         if (VMM_RSDNT == (_vmm_.opts&VMM_RSDNT)) {
           ret = ipc_madmit(&(_vmm_.ipc),\
-            VMM_TO_SYS((nn_pages-on_pages)+(nf_pages-of_pages)),\
-            _vmm_.opts&VMM_ADMITD);
+            VMM_TO_SYS(page_size, nn_pages-on_pages)+\
+            VMM_TO_SYS(meta_size, nf_pages-of_pages),\
+            _vmm_.opts&(VMM_ADMITD|VMM_ADMITF));
         }
         else {
-          ret = ipc_madmit(&(_vmm_.ipc), VMM_TO_SYS(nf_pages-of_pages),\
-            _vmm_.opts&VMM_ADMITD);
+          ret = ipc_madmit(&(_vmm_.ipc),\
+            VMM_TO_SYS(meta_size, nf_pages-of_pages),\
+            _vmm_.opts&(VMM_ADMITD|VMM_ADMITF));
         }
       }
       else {
         if (VMM_RSDNT == (_vmm_.opts&VMM_RSDNT)) {
-          ret = ipc_madmit(&(_vmm_.ipc), VMM_TO_SYS(nn_pages-on_pages),\
-            _vmm_.opts&VMM_ADMITD);
+          ret = ipc_madmit(&(_vmm_.ipc),\
+            VMM_TO_SYS(page_size, nn_pages-on_pages),\
+            _vmm_.opts&(VMM_ADMITD|VMM_ADMITF));
         }
         else
           ret = 0;
@@ -175,43 +205,45 @@ sbma_realloc(void * const __ptr, size_t const __size)
         break;
     }
 
-    /* remove old ate from mmu */
+    /* remove old ate from mmu -- this waits for the eviction thread to
+     * finish walking the allocation table, if it is, so the counts read below
+     * are final */
     ret = mmu_invalidate_ate(&(_vmm_.mmu), ate);
     if (-1 == ret)
       goto CLEANUP;
 
+    ol_pages = ate->l_pages;
+    oc_pages = ate->c_pages;
+
     if (VMM_MERGE == (_vmm_.opts&VMM_MERGE)) {
       /* TODO: I think the reason that mremap fails so frequently is due to the
        * fact that oaddr is not seen as a single vma in the kernel, but rather
        * as several vmas, due to the use of mprotect to manage access to the
        * memory region. */
       /* Make sure the kernel sees the entire range as a single vma. */
-      ret = mprotect((void*)oaddr, (s_pages+on_pages+of_pages)*page_size,\
-        PROT_READ|PROT_WRITE);
+      ret = mprotect((void*)oaddr, o_size, PROT_READ|PROT_WRITE);
       if (-1 == ret)
         goto CLEANUP1;
     }
 
     /* resize allocation */
-    naddr = (uintptr_t)mremap((void*)oaddr,\
-      (s_pages+on_pages+of_pages)*page_size,\
-      (s_pages+nn_pages+nf_pages)*page_size, MREMAP_MAYMOVE);
+    naddr = (uintptr_t)mremap((void*)oaddr, o_size, n_size, MREMAP_MAYMOVE);
     if ((uintptr_t)MAP_FAILED == naddr)
       goto CLEANUP2;
 
     /* copy page flags to new location */
-    libc_memmove((void*)(naddr+((s_pages+nn_pages)*page_size)),\
-      (void*)(naddr+((s_pages+on_pages)*page_size)), of_pages*page_size);
+    libc_memmove((void*)(naddr+(s_size+nn_pages*page_size)),\
+      (void*)(naddr+(s_size+on_pages*page_size)), of_pages*meta_size);
 
     if (VMM_MERGE == (_vmm_.opts&VMM_MERGE)) {
       if (VMM_RSDNT == (_vmm_.opts&VMM_RSDNT)) {
         /* grant read-only permission application memory */
-        ret = mprotect((void*)(naddr+(s_pages*page_size)),\
+        ret = mprotect((void*)(naddr+s_size),\
           nn_pages*page_size, PROT_READ);
       }
       else {
         /* grant no permission to application memory */
-        ret = mprotect((void*)(naddr+(s_pages*page_size)),\
+        ret = mprotect((void*)(naddr+s_size),\
           nn_pages*page_size, PROT_NONE);
       }
     }
@@ -219,12 +251,12 @@ sbma_realloc(void * const __ptr, size_t const __size)
       if (VMM_RSDNT == (_vmm_.opts&VMM_RSDNT)) {
         /* grant read-only permission to extended area of application memory
          * */
-        ret = mprotect((void*)(naddr+((s_pages+on_pages)*page_size)),\
+        ret = mprotect((void*)(naddr+(s_size+on_pages*page_size)),\
           (nn_pages-on_pages)*page_size, PROT_READ);
       }
       else {
         /* grant no permission to extended area of application memory */
-        ret = mprotect((void*)(naddr+((s_pages+on_pages)*page_size)),\
+        ret = mprotect((void*)(naddr+(s_size+on_pages*page_size)),\
           (nn_pages-on_pages)*page_size, PROT_NONE);
       }
     }
@@ -233,36 +265,36 @@ sbma_realloc(void * const __ptr, size_t const __size)
     if (VMM_MERGE == (_vmm_.opts&VMM_MERGE)) {
 #if 1
       /* Update memory protection according to the existing page flags. */
-      nflags = (uint8_t*)(naddr+((s_pages+nn_pages)*page_size));
+      nflags = (uint8_t*)(naddr+(s_size+nn_pages*page_size));
       ifirst = 0;
-      oflag  = nflags[0];
+      oflag  = nflags[0]&(MMU_RSDNT|MMU_DIRTY);
       for (i=0; i<=on_pages; ++i) {
         if (i == on_pages || oflag != (nflags[i]&(MMU_RSDNT|MMU_DIRTY))) {
           if (MMU_DIRTY == (oflag&MMU_DIRTY)) {
-            ret = mprotect((void*)(naddr+(s_pages+ifirst)*page_size),\
+            ret = mprotect((void*)(naddr+s_size+ifirst*page_size),\
               (i-ifirst)*page_size, PROT_READ|PROT_WRITE);
           }
           else if (MMU_RSDNT != (oflag&MMU_RSDNT)) {
-            ret = mprotect((void*)(naddr+(s_pages+i)*page_size),\
+            ret = mprotect((void*)(naddr+s_size+i*page_size),\
               (i-ifirst)*page_size, PROT_READ);
           }
           ERRCHK(FATAL, -1 == ret);
 
           if (i != on_pages) {
             ifirst = i;
-            oflag  = nflags[i];
+            oflag  = nflags[i]&(MMU_RSDNT|MMU_DIRTY);
           }
         }
       }
 #else
-      nflags = (uint8_t*)(naddr+((s_pages+nn_pages)*page_size));
+      nflags = (uint8_t*)(naddr+(s_size+nn_pages*page_size));
       for (i=0; i<on_pages; ++i) {
         if (MMU_DIRTY == (nflags[i]&MMU_DIRTY)) {
-          ret = mprotect((void*)(naddr+(s_pages+i)*page_size), page_size,\
+          ret = mprotect((void*)(naddr+s_size+i*page_size), page_size,\
             PROT_READ|PROT_WRITE);
         }
         else if (MMU_RSDNT != (nflags[i]&MMU_RSDNT)) {
-          ret = mprotect((void*)(naddr+(s_pages+i)*page_size), page_size,\
+          ret = mprotect((void*)(naddr+s_size+i*page_size), page_size,\
             PROT_READ);
         }
         ERRCHK(FATAL, -1 == ret);
@@ -274,19 +306,19 @@ sbma_realloc(void * const __ptr, size_t const __size)
       if (VMM_RSDNT == (_vmm_.opts&VMM_RSDNT)) {
         if (VMM_MERGE == (_vmm_.opts&VMM_MERGE)) {
           /* lock application memory into RAM */
-          ret = libc_mlock((void*)(naddr+s_pages*page_size),\
+          ret = libc_mlock((void*)(naddr+s_size),\
             nn_pages*page_size);
         }
         else {
           /* lock application memory into RAM */
-          ret = libc_mlock((void*)(naddr+(s_pages+on_pages)*page_size),\
+          ret = libc_mlock((void*)(naddr+s_size+on_pages*page_size),\
             (nn_pages-on_pages)*page_size);
         }
         ERRCHK(FATAL, -1 == ret);
       }
       /* lock book-keeping memory into RAM */
-      ret = libc_mlock((void*)(naddr+(s_pages+nn_pages)*page_size),\
-        nf_pages*page_size);
+      ret = libc_mlock((void*)(naddr+s_size+nn_pages*page_size),\
+        nf_pages*meta_size);
       ERRCHK(FATAL, -1 == ret);
     }
 
@@ -313,6 +345,7 @@ sbma_realloc(void * const __ptr, size_t const __size)
     /* insert new ate into mmu */
     ret = mmu_insert_ate(&(_vmm_.mmu), ate);
     ERRCHK(FATAL, -1 == ret);
+    VMM_TRACK(&_vmm_, memal, (nn_pages-on_pages)*page_size);
 
     /* populate ate structure */
     ate->n_pages = nn_pages;
@@ -324,8 +357,8 @@ sbma_realloc(void * const __ptr, size_t const __size)
       ate->l_pages = ol_pages;
       ate->c_pages = oc_pages;
     }
-    ate->base  = naddr+(s_pages*page_size);
-    ate->flags = (uint8_t*)(naddr+((s_pages+nn_pages)*page_size));
+    ate->base  = naddr+s_size;
+    ate->flags = (uint8_t*)(naddr+(s_size+nn_pages*page_size));
 
     if (VMM_RSDNT != (_vmm_.opts&VMM_RSDNT)) {
       for (i=on_pages; i<nn_pages; ++i)
@@ -345,19 +378,18 @@ sbma_realloc(void * const __ptr, size_t const __size)
     CLEANUP2:
     if (VMM_MERGE == (_vmm_.opts&VMM_MERGE)) {
       /* grant no permission to application memory */
-      ret = mprotect((void*)(oaddr+(s_pages*page_size)), on_pages*page_size,\
-        PROT_NONE);
+      ret = mprotect((void*)(oaddr+s_size), on_pages*page_size, PROT_NONE);
       ASSERT(-1 != ret);
 
       /* revert memory protection according to existing flags */
-      oflags = (uint8_t*)(oaddr+((s_pages+on_pages)*page_size));
+      oflags = (uint8_t*)(oaddr+(s_size+on_pages*page_size));
       for (i=0; i<on_pages; ++i) {
         if (MMU_DIRTY == (oflags[i]&MMU_DIRTY)) {
-          ret = mprotect((void*)(oaddr+(s_pages+i)*page_size), page_size,\
+          ret = mprotect((void*)(oaddr+s_size+i*page_size), page_size,\
             PROT_READ|PROT_WRITE);
         }
         else if (MMU_RSDNT != (oflags[i]&MMU_RSDNT)) {
-          ret = mprotect((void*)(oaddr+(s_pages+i)*page_size), page_size,\
+          ret = mprotect((void*)(oaddr+s_size+i*page_size), page_size,\
             PROT_READ);
         }
         ASSERT(-1 != ret);
@@ -372,15 +404,18 @@ sbma_realloc(void * const __ptr, size_t const __size)
       if (VMM_METACH == (_vmm_.opts&VMM_METACH)) {
         if (VMM_RSDNT == (_vmm_.opts&VMM_RSDNT)) {
           ret = ipc_mevict(&(_vmm_.ipc),\
-            VMM_TO_SYS((nn_pages-on_pages)+(nf_pages-of_pages)), 0);
+            VMM_TO_SYS(page_size, nn_pages-on_pages)+\
+            VMM_TO_SYS(meta_size, nf_pages-of_pages), 0);
         }
         else {
-          ret = ipc_mevict(&(_vmm_.ipc), VMM_TO_SYS(nf_pages-of_pages), 0);
+          ret = ipc_mevict(&(_vmm_.ipc),\
+            VMM_TO_SYS(meta_size, nf_pages-of_pages), 0);
         }
       }
       else {
         if (VMM_RSDNT == (_vmm_.opts&VMM_RSDNT))
-          ret = ipc_mevict(&(_vmm_.ipc), VMM_TO_SYS((nn_pages-on_pages)), 0);
+          ret = ipc_mevict(&(_vmm_.ipc),\
+            VMM_TO_SYS(page_size, nn_pages-on_pages), 0);
         else
           ret = 0;
       }
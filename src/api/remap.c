@@ -62,19 +62,31 @@ sbma_remap(void * const __nbase, void * const __obase, size_t const __size)
 
   ASSERT((uintptr_t)__obase == oate->base);
   ASSERT((uintptr_t)__nbase == nate->base);
-  ASSERT(oate->n_pages <= nate->n_pages);
+  ASSERT(oate->n_pages*oate->page_size <= nate->n_pages*nate->page_size);
 
+  /* The page flags and the file can only be carried over to an allocation
+   * with the same page size, otherwise the memory is copied. */
+  if (oate->page_size != nate->page_size) {
+    libc_memcpy(__nbase, __obase, __size);
+    return 0;
+  }
+
+  /* Pins are not carried over to the new memory, so that all of the old
+   * memory can be stored in file */
+  ret = sbma_munpin((void*)oate->base, oate->n_pages*oate->page_size);
+  if (-1 == ret)
+    return -1;
   /* Make sure that old memory is stored in file */
-  ret = sbma_mevict((void*)oate->base, oate->n_pages*page_size);
+  ret = sbma_mevict((void*)oate->base, oate->n_pages*oate->page_size);
   if (-1 == ret)
     return -1;
   /* Make sure that new memory is uninitialized */
-  ret = sbma_mclear((void*)nate->base, nate->n_pages*page_size);
+  ret = sbma_mclear((void*)nate->base, nate->n_pages*nate->page_size);
   if (-1 == ret)
     return -1;
   /* Make sure that new memory has no read permissions so that it will load
    * from disk any necessary pages. */
-  ret = sbma_mevict((void*)nate->base, nate->n_pages*page_size);
+  ret = sbma_mevict((void*)nate->base, nate->n_pages*nate->page_size);
   if (-1 == ret)
     return -1;
 
@@ -38,6 +38,11 @@ SBMA_EXTERN int
 sbma_sigon(void)
 {
   ipc_sigon(&(_vmm_.ipc));
+
+  /* Wake the eviction thread, so that it starts cleaning dirty memory. */
+  if (0 != _vmm_.flush)
+    IPC_MBOX_POST(&(_vmm_.ipc.mbox[_vmm_.ipc.id]));
+
   return 0;
 }
 
@@ -42,10 +42,10 @@ sbma_timeinfo(void)
 
   memset(&ti, 0, sizeof(struct sbma_timeinfo));
 
-  ti.tv_rd = _vmm_.tmrrd;
-  ti.tv_wr = _vmm_.tmrwr;
-  //ti.tv_ad = _vmm_.tmrad;
-  //ti.tv_ev = _vmm_.tmrev;
+  ti.tv_rd = (double)_vmm_.ipc.stat.tmrrd/1000000000.0;
+  ti.tv_wr = (double)_vmm_.ipc.stat.tmrwr/1000000000.0;
+  ti.tv_ad = (double)_vmm_.ipc.stat.tmrad/1000000000.0;
+  ti.tv_ev = (double)_vmm_.ipc.stat.tmrev/1000000000.0;
 
   return ti;
 }
@@ -173,6 +173,10 @@ SBMA_EXPORT(internal, int
 SBMA_EXPORT(internal, int libc_mlockall(int flags));
 SBMA_EXPORT(internal, int
   libc_msync(void * const addr, size_t const len, int const flags));
+SBMA_EXPORT(internal, int libc_sem_wait(sem_t * const sem));
+SBMA_EXPORT(internal, int
+  libc_nanosleep(struct timespec const * const req,
+                 struct timespec * const rem));
 
 
 #ifdef __cplusplus
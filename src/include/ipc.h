@@ -30,10 +30,16 @@ THE SOFTWARE.
 #endif
 
 
-#include <pthread.h>   /* pthread library */
-#include <semaphore.h> /* semaphore library */
-#include <stdint.h>    /* uint8_t */
-#include <stddef.h>    /* size_t */
+#include <limits.h>      /* INT_MAX */
+#include <linux/futex.h> /* FUTEX_WAIT, FUTEX_WAKE */
+#include <pthread.h>     /* pthread library */
+#include <semaphore.h>   /* semaphore library */
+#include <stdint.h>      /* uint8_t, uint64_t */
+#include <stddef.h>      /* size_t */
+#include <sys/syscall.h> /* SYS_futex */
+#include <sys/types.h>   /* ssize_t */
+#include <time.h>        /* struct timespec */
+#include <unistd.h>      /* syscall */
 #include "common.h"
 #include "sbma.h"
 
@@ -42,17 +48,109 @@ THE SOFTWARE.
 
 
 /*****************************************************************************/
-/*  Signal used to tell other processes to release memory. */
+/*  Capacity of the eviction request ring of each process. */
 /*****************************************************************************/
-#define SIGIPC (SIGRTMIN+0)
+#define IPC_MBOX_LEN 64
 
 
 /*****************************************************************************/
-/* Length of the IPC shared memory region. */
+/*  Nanoseconds a process waiting for memory sleeps before re-checking the
+ *  system state. */
 /*****************************************************************************/
+#define IPC_WAIT_NSEC 1000000
+
+
+/*****************************************************************************/
+/*  Nanoseconds a process holds its place in the gang before a process which
+ *  has waited as long may take it over, see ipc_mgang(). */
+/*****************************************************************************/
+#define IPC_GANG_NSEC 1000000000
+
+
+/*****************************************************************************/
+/*  Size of a cache line. Data in the shared memory region which is written
+ *  by different processes is kept on separate cache lines, so that updates
+ *  by one process do not invalidate the data of others. */
+/*****************************************************************************/
+#define IPC_LINE 64
+
+
+/*****************************************************************************/
+/*  Per-process slot, stored in the shared memory region. A slot is free when
+ *  its pid is zero. */
+/*****************************************************************************/
+struct ipc_slot
+{
+  size_t c_mem;  /*!< current resident memory */
+  size_t d_mem;  /*!< dirty memory */
+  size_t quota;  /*!< guaranteed resident memory */
+  size_t p_mem;  /*!< pinned memory, which is never released */
+  size_t r_mem;  /*!< memory held for admission tickets until used */
+  int pid;       /*!< process id, zero if the slot is free */
+  int prio;      /*!< weight in fair share victim selection */
+  uint8_t flags; /*!< process status bits */
+  int gang;      /*!< gang state of the process */
+  size_t ticket; /*!< position of the process in the gang queue */
+  size_t w_mem;  /*!< working set, i.e., resident memory high water mark */
+  uint64_t g_ns; /*!< time at which the process started to wait or hold */
+} __attribute__((aligned(IPC_LINE)));
+
+
+/*****************************************************************************/
+/*  Memory of a process which cannot be released, i.e., the larger of its
+ *  quota and its pinned memory, and the memory held for its admission
+ *  tickets. */
+/*****************************************************************************/
+#define IPC_FLOOR(SLOT)\
+  (((SLOT).quota > (SLOT).p_mem ? (SLOT).quota : (SLOT).p_mem)+(SLOT).r_mem)
+
+
+/*****************************************************************************/
+/*  Per-process eviction request ring, stored in the shared memory region.
+ *  Requests are enqueued and dequeued inside an IPC_INTER_CRITICAL_SECTION.
+ *  The event counter is incremented whenever a request is added to the ring
+ *  or a request made by the process has been served, and is the futex word
+ *  which the eviction thread and any waiting threads of the process sleep
+ *  on. */
+/*****************************************************************************/
+struct ipc_mbox
+{
+  int event;             /*!< event counter and futex word */
+  int head;              /*!< index of oldest pending request */
+  int count;             /*!< number of pending requests */
+  int req[IPC_MBOX_LEN]; /*!< ipc ids of requesting processes */
+} __attribute__((aligned(IPC_LINE)));
+
+
+/*****************************************************************************/
+/* Length of the IPC shared memory region. The system memory scalar, which
+ * every admission updates, is alone on the first cache line. The total and
+ * limit memory scalars, the member count and the gang size and ticket
+ * counter share the second, and are followed by the per-process slots and
+ * request rings, and by the statistics of the node. */
+/*****************************************************************************/
+#define IPC_SMEM_OFF(N_PROCS) 0
+
+#define IPC_TMEM_OFF(N_PROCS) (IPC_LINE)
+
+#define IPC_LMEM_OFF(N_PROCS) (IPC_LINE+sizeof(size_t))
+
+#define IPC_MEMB_OFF(N_PROCS) (IPC_LINE+sizeof(size_t)+sizeof(size_t))
+
+#define IPC_GANG_OFF(N_PROCS) (IPC_MEMB_OFF(N_PROCS)+sizeof(int))
+
+#define IPC_GTKT_OFF(N_PROCS) (IPC_GANG_OFF(N_PROCS)+sizeof(int))
+
+#define IPC_SLOT_OFF(N_PROCS) (IPC_LINE+IPC_LINE)
+
+#define IPC_MBOX_OFF(N_PROCS)\
+  (IPC_SLOT_OFF(N_PROCS)+(N_PROCS)*sizeof(struct ipc_slot))
+
+#define IPC_STAT_OFF(N_PROCS)\
+  (IPC_MBOX_OFF(N_PROCS)+(N_PROCS)*sizeof(struct ipc_mbox))
+
 #define IPC_LEN(N_PROCS)\
-  (sizeof(size_t)+(N_PROCS)*(sizeof(int)+sizeof(size_t)+sizeof(size_t)+\
-    sizeof(uint8_t))+sizeof(int))
+  (IPC_STAT_OFF(N_PROCS)+sizeof(struct sbma_stats))
 
 
 /*****************************************************************************/
@@ -61,7 +159,6 @@ THE SOFTWARE.
 #define LIST_OF_SEMAPHORES \
 do {\
   X(inter_mtx, 1)\
-  X(done, 0)\
   X(sid, 1)\
   X(sig, 0)\
 } while (0);
@@ -73,7 +170,7 @@ do {\
 #define IPC_INTER_CRITICAL_SECTION_BEG(IPC)\
 do {\
   int _ret;\
-  _ret = sem_wait((IPC)->inter_mtx);\
+  _ret = libc_sem_wait((IPC)->inter_mtx);\
   ASSERT(0 == _ret);\
 } while (0)
 
@@ -90,16 +187,55 @@ do {\
 /*****************************************************************************/
 #define IPC_INTRA_CRITICAL_SECTION_BEG(IPC)\
 do {\
-  int ret;\
-  ret = pthread_mutex_lock(&((IPC)->intra_mtx));\
-  ASSERT(0 == ret);\
+  int _ret;\
+  _ret = pthread_mutex_lock(&((IPC)->intra_mtx));\
+  ASSERT(0 == _ret);\
 } while (0)
 
 #define IPC_INTRA_CRITICAL_SECTION_END(IPC)\
 do {\
-  int ret;\
-  ret = pthread_mutex_unlock(&((IPC)->intra_mtx));\
-  ASSERT(0 == ret);\
+  int _ret;\
+  _ret = pthread_mutex_unlock(&((IPC)->intra_mtx));\
+  ASSERT(0 == _ret);\
+} while (0)
+
+
+/*****************************************************************************/
+/* Constructs which signal and wait for events on a request ring. */
+/*****************************************************************************/
+#define IPC_MBOX_POST(MBOX)\
+do {\
+  (void)__sync_fetch_and_add(&((MBOX)->event), 1);\
+  (void)syscall(SYS_futex, &((MBOX)->event), FUTEX_WAKE, INT_MAX, NULL,\
+    NULL, 0);\
+} while (0)
+
+#define IPC_MBOX_WAIT(MBOX, EVENT, TS)\
+do {\
+  (void)syscall(SYS_futex, &((MBOX)->event), FUTEX_WAIT, (EVENT), (TS),\
+    NULL, 0);\
+} while (0)
+
+
+/*****************************************************************************/
+/* Construct which completes an asynchronous admission ticket. The fields of
+ * the ticket are read before its status is set, since the owner may reuse
+ * the ticket as soon as it sees the new status. */
+/*****************************************************************************/
+#define IPC_TICKET_DONE(TKT, STATUS)\
+do {\
+  int _efd;\
+  uint64_t _one=1;\
+  void (*_cb)(struct sbma_ticket * const);\
+  _efd = (TKT)->efd;\
+  _cb  = (TKT)->cb;\
+  (TKT)->status = (STATUS);\
+  (void)syscall(SYS_futex, &((TKT)->status), FUTEX_WAKE, INT_MAX, NULL,\
+    NULL, 0);\
+  if (-1 != _efd)\
+    (void)libc_write(_efd, &_one, sizeof(_one));\
+  if (NULL != _cb)\
+    _cb(TKT);\
 } while (0)
 
 
@@ -116,6 +252,37 @@ enum ipc_code
 };
 
 
+/*****************************************************************************/
+/*
+ *  Gang states of a process:
+ *
+ *    IPC_GANG_NONE: neither waiting for nor holding a place in the gang
+ *    IPC_GANG_WAIT: waiting in the gang queue
+ *    IPC_GANG_HOLD: holding a place in the gang
+ */
+/*****************************************************************************/
+enum ipc_gang
+{
+  IPC_GANG_NONE = 0,
+  IPC_GANG_WAIT = 1,
+  IPC_GANG_HOLD = 2
+};
+
+
+/*****************************************************************************/
+/*  Memory admitted for an asynchronous admission ticket, which is held for
+ *  the ticket until it is used or the ticket is canceled, see ipc_mgrant().
+ *  Reservations are kept apart from the ticket, since the owner may reuse a
+ *  ticket as soon as it is completed. */
+/*****************************************************************************/
+struct ipc_rsv
+{
+  size_t pages;               /*!< system pages still held */
+  struct sbma_ticket * tkt;   /*!< ticket the memory was admitted for */
+  struct ipc_rsv * next;      /*!< next reservation, in order of admission */
+};
+
+
 /*****************************************************************************/
 /*  Interprocess environment. */
 /*****************************************************************************/
@@ -124,28 +291,70 @@ struct ipc
   int init;        /*!< initialized indicator */
 
   int id;          /*!< ipc id of process amoung the n_procs */
-  int n_procs;     /*!< number of processes in coordination */
+  int n_procs;     /*!< number of process slots in coordination */
 
   int uniq;        /*!< unique identifier for shared mem and semaphores */
 
   size_t curpages; /*!< current pages loaded */
   size_t maxpages; /*!< maximum number of pages loaded */
 
+  size_t credit;   /*!< admission credits held in the local pool */
+  size_t chunk;    /*!< granularity at which credits are reserved */
+
+  /*! callback which evicts process memory, as many pages as its second
+   *  argument, if possible, but never more */
+  int (*evict)(int const, size_t const, size_t * const, size_t * const);
+
   sem_t * inter_mtx;         /*!< inter-process critical section mutex */
-  sem_t * done;              /*!< indicator that signal handler is completed */
   sem_t * sid;               /*!< unique id among processes within a node */
   sem_t * sig;               /*!< counter of threads with signaling enabled */
   pthread_mutex_t intra_mtx; /*!< intra-process critical section mutex */
+  pthread_mutex_t mbox_mtx;  /*!< serializes serving of eviction requests */
+  pthread_mutex_t tkt_mtx;   /*!< guards the admission ticket queue */
+
+  struct sbma_ticket * tkt_head; /*!< oldest pending admission ticket */
+  struct sbma_ticket * tkt_tail; /*!< newest pending admission ticket */
+
+  struct ipc_rsv * rsv_head; /*!< oldest reservation of an admitted ticket */
+  struct ipc_rsv * rsv_tail; /*!< newest reservation of an admitted ticket */
+  struct ipc_rsv * rsv_free; /*!< unused reservations */
+  struct ipc_rsv * rsv_pool; /*!< pages of reservations, see ipc_mgrant() */
 
   void * shm;               /*!< shared memory region */
-  int * pid;                /*!< pointer into shm for pid array */
+  int * memb;               /*!< pointer into shm for member count */
+  volatile int * gang;      /*!< pointer into shm for gang size */
+  size_t * g_tkt;           /*!< pointer into shm for gang ticket counter */
   volatile size_t  * s_mem; /*!< pointer into shm for system mem scalar */
-  volatile size_t  * c_mem; /*!< pointer into shm for current resident mem array */
-  volatile size_t  * d_mem; /*!< pointer into shm for dirty mem array */
-  volatile uint8_t * flags; /*!< pointer into shm for flags array */
+  volatile size_t  * t_mem; /*!< pointer into shm for total mem scalar */
+  volatile size_t  * l_mem; /*!< pointer into shm for limit mem scalar */
+  volatile struct ipc_slot * slot; /*!< pointer into shm for process slots */
+  volatile struct ipc_mbox * mbox; /*!< pointer into shm for request rings */
+
+  struct sbma_stats volatile stat;    /*!< statistics of the process */
+  struct sbma_stats volatile * n_stat; /*!< pointer into shm for statistics
+                                            of the node */
 };
 
 
+/*****************************************************************************/
+/*  Converts a timer, see TIMER_STOP(), to nanoseconds. */
+/*****************************************************************************/
+#define IPC_TO_NSEC(TMR)\
+  ((uint64_t)(TMR)->tv_sec*1000000000+(uint64_t)(TMR)->tv_nsec)
+
+
+/*****************************************************************************/
+/*  Add to a counter of the statistics of the process, and to that of the
+ *  node, if the process has joined it. */
+/*****************************************************************************/
+#define IPC_TRACK(IPC, FIELD, VAL)\
+do {\
+  (void)__sync_fetch_and_add(&((IPC)->stat.FIELD), (uint64_t)(VAL));\
+  if (NULL != (IPC)->n_stat)\
+    (void)__sync_fetch_and_add(&((IPC)->n_stat->FIELD), (uint64_t)(VAL));\
+} while (0)
+
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -202,12 +411,73 @@ ipc_atomic_dec(struct ipc * const ipc, size_t const c_pages,
                size_t const d_pages));
 
 
+/*****************************************************************************/
+/*  Return all admission credits held by process to the system. */
+/*****************************************************************************/
+SBMA_EXPORT(internal, size_t
+ipc_atomic_flush(struct ipc * const ipc));
+
+
 /*****************************************************************************/
 /*  Account for resident memory before admission. Check to see if the system
  *  can support the addition of value bytes of memory. */
 /*****************************************************************************/
 SBMA_EXPORT(internal, int
-ipc_madmit(struct ipc * const ipc, size_t const value, int const admitd));
+ipc_madmit(struct ipc * const ipc, size_t const value, int const admit));
+
+
+/*****************************************************************************/
+/*  Take or wait for a place in the gang of processes allowed to compete for
+ *  memory. */
+/*****************************************************************************/
+SBMA_EXPORT(internal, int
+ipc_mgang(struct ipc * const ipc));
+
+
+/*****************************************************************************/
+/*  Ask a set of processes to release deficit pages of memory. */
+/*****************************************************************************/
+SBMA_EXPORT(internal, int
+ipc_mplan(struct ipc * const ipc, size_t const deficit, size_t const need,
+          int const admit, int const any));
+
+
+/*****************************************************************************/
+/*  Resize the memory shared by all processes to value pages, evicting memory
+ *  as needed. */
+/*****************************************************************************/
+SBMA_EXPORT(internal, int
+ipc_mresize(struct ipc * const ipc, size_t const value, int const admit));
+
+
+/*****************************************************************************/
+/*  Serve pending eviction requests made to process. If block is zero, return
+ *  immediately when another thread is already serving them. */
+/*****************************************************************************/
+SBMA_EXPORT(internal, ssize_t
+ipc_mserve(struct ipc * const ipc, int const block));
+
+
+/*****************************************************************************/
+/*  Return the memory of process ii to the system and free its slot. */
+/*****************************************************************************/
+SBMA_EXPORT(internal, void
+ipc_mrelease(struct ipc * const ipc, int const ii));
+
+
+/*****************************************************************************/
+/*  Reclaim the slots of processes which died without leaving. Returns the
+ *  number of slots reclaimed. */
+/*****************************************************************************/
+SBMA_EXPORT(internal, int
+ipc_mreap(struct ipc * const ipc));
+
+
+/*****************************************************************************/
+/*  Set the resident memory quota and the priority of process. */
+/*****************************************************************************/
+SBMA_EXPORT(internal, int
+ipc_mpolicy(struct ipc * const ipc, size_t const quota, int const prio));
 
 
 /*****************************************************************************/
@@ -225,6 +495,45 @@ SBMA_EXPORT(internal, int
 ipc_mdirty(struct ipc * const ipc, ssize_t const value));
 
 
+/*****************************************************************************/
+/*  Account for pinned memory. */
+/*****************************************************************************/
+SBMA_EXPORT(internal, int
+ipc_mpin(struct ipc * const ipc, ssize_t const value));
+
+
+/*****************************************************************************/
+/*  Queue an asynchronous admission ticket. */
+/*****************************************************************************/
+SBMA_EXPORT(internal, int
+ipc_mqueue(struct ipc * const ipc, struct sbma_ticket * const tkt));
+
+
+/*****************************************************************************/
+/*  Remove a pending admission ticket from the queue. Returns -1 if the
+ *  ticket is not pending. */
+/*****************************************************************************/
+SBMA_EXPORT(internal, int
+ipc_mcancel(struct ipc * const ipc, struct sbma_ticket * const tkt));
+
+
+/*****************************************************************************/
+/*  Admit memory for the pending admission tickets, in order, asking other
+ *  processes to release memory for the oldest one which cannot be admitted.
+ *  Returns 1 if some ticket is still pending. */
+/*****************************************************************************/
+SBMA_EXPORT(internal, int
+ipc_mgrant(struct ipc * const ipc, int const admit));
+
+
+/*****************************************************************************/
+/*  Return the memory still held for an admitted ticket to the system.
+ *  Returns -1 if no memory is held for the ticket. */
+/*****************************************************************************/
+SBMA_EXPORT(internal, int
+ipc_mrevoke(struct ipc * const ipc, struct sbma_ticket * const tkt));
+
+
 #ifdef __cplusplus
 }
 #endif
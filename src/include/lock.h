@@ -31,29 +31,33 @@ THE SOFTWARE.
 
 
 /*****************************************************************************/
-/*  Pthread configurations. */
+/*  Pthread configurations.
+ *
+ *  The locks are always real pthread mutexes, since the eviction thread (see
+ *  vmm_init()) accesses the allocation table concurrently with the
+ *  application. */
 /*****************************************************************************/
-#ifdef USE_THREAD
-# include <pthread.h> /* pthread library */
-# include "common.h"
+#include <pthread.h> /* pthread library */
+#include "common.h"
 
-# define DEADLOCK 0   /* 0: no deadlock diagnostics, */
-                      /* 1: deadlock diagnostics */
+#define DEADLOCK 0   /* 0: no deadlock diagnostics, */
+                     /* 1: deadlock diagnostics */
 
-# define lock_get(LOCK) lock_get_int(__func__, __LINE__, #LOCK, LOCK)
-# define lock_let(LOCK) lock_let_int(__func__, __LINE__, #LOCK, LOCK)
+#define lock_get(LOCK) lock_get_int(__func__, __LINE__, #LOCK, LOCK)
+#define lock_let(LOCK) lock_let_int(__func__, __LINE__, #LOCK, LOCK)
+#define lock_try(LOCK) lock_try_int(__func__, __LINE__, #LOCK, LOCK)
 
-# if defined(DEADLOCK) && DEADLOCK > 0
-#   include <stdio.h> /* printf */
-#   define DL_PRINTF(...) do { printf(__VA_ARGS__); fflush(stdout); } while (0)
-# else
-#   define DL_PRINTF(...) (void)0
-# endif
+#if defined(DEADLOCK) && DEADLOCK > 0
+# include <stdio.h> /* printf */
+# define DL_PRINTF(...) do { printf(__VA_ARGS__); fflush(stdout); } while (0)
+#else
+# define DL_PRINTF(...) (void)0
+#endif
 
 
-# ifdef __cplusplus
+#ifdef __cplusplus
 extern "C" {
-# endif
+#endif
 
 /*****************************************************************************/
 /*  Initialize pthread lock. */
@@ -77,6 +81,15 @@ lock_get_int(char const * const func, int const line,
              char const * const lock_str, pthread_mutex_t * const lock));
 
 
+/*****************************************************************************/
+/*  Lock pthread lock if it is not held by another thread. Returns EBUSY if
+ *  it is. */
+/*****************************************************************************/
+SBMA_EXPORT(internal, int
+lock_try_int(char const * const func, int const line,
+             char const * const lock_str, pthread_mutex_t * const lock));
+
+
 /*****************************************************************************/
 /*  Unlock pthread lock. */
 /*****************************************************************************/
@@ -84,14 +97,8 @@ SBMA_EXPORT(internal, int
 lock_let_int(char const * const func, int const line,
              char const * const lock_str, pthread_mutex_t * const lock));
 
-# ifdef __cplusplus
+#ifdef __cplusplus
 }
-# endif
-#else
-# define lock_init(...) 0
-# define lock_free(...) 0
-# define lock_get(...)  0
-# define lock_let(...)  0
 #endif
 
 
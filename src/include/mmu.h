@@ -30,7 +30,10 @@ THE SOFTWARE.
 #endif
 
 
-#include <stdint.h> /* uint8_t, uintptr_t */
+#include <pthread.h>   /* pthread_mutex_t */
+#include <stddef.h>    /* size_t */
+#include <stdint.h>    /* uint8_t, uintptr_t */
+#include <sys/types.h> /* ssize_t */
 
 
 /*****************************************************************************/
@@ -41,6 +44,15 @@ THE SOFTWARE.
  *    bit 1 ==    0: page is resident        1: page is not resident
  *    bit 2 ==    0: page is unmodified      1: page is dirty
  *    bit 3 ==    0: page has been charged   1: page is uncharged
+ *    bit 4 ==    0: no advice               1: page is read sequentially
+ *    bit 5 ==    0: no advice               1: page is read randomly
+ *    bit 6 ==    0: page may be evicted     1: page is pinned
+ *    bit 7 ==    0: page is loaded on use   1: page was read ahead and
+ *                                              has not been written since
+ *
+ *  Bits 4 and 5 hold the advice given with SBMA_madvise() and bit 6 is set
+ *  by SBMA_mpin(). These attribute bits are kept as the page changes state.
+ *  Bit 7 is only used to count readahead hits, see struct sbma_stats.
  */
 /*****************************************************************************/
 /*#define MMU_ZFILL ((uint8_t)(1<<0))
@@ -52,26 +64,79 @@ enum mmu_status_code
   MMU_ZFILL = 1 << 0,
   MMU_RSDNT = 1 << 1,
   MMU_DIRTY = 1 << 2,
-  MMU_CHRGD = 1 << 3
+  MMU_CHRGD = 1 << 3,
+  MMU_ADVSQ = 1 << 4,
+  MMU_ADVRN = 1 << 5,
+  MMU_PINND = 1 << 6,
+  MMU_RDAHD = 1 << 7,
+  MMU_ADVICE = MMU_ADVSQ|MMU_ADVRN,
+  MMU_ATTRS = MMU_ADVICE|MMU_PINND
+};
+
+
+/*****************************************************************************/
+/*  Allocation table entry priorities, in the order in which allocations are
+ *  evicted and cleaned. Allocations in the working set of the current phase,
+ *  see sbma_phase_begin(), are evicted and cleaned last. */
+/*****************************************************************************/
+enum mmu_priority
+{
+  MMU_COLD  = -1,
+  MMU_WARM  = 0,
+  MMU_HOT   = 1,
+  MMU_PHASE = 2
 };
 
 
+/*****************************************************************************/
+/*  Effective priority of an allocation table entry. */
+/*****************************************************************************/
+#define MMU_PRIO(ATE) (0 != (ATE)->phase ? MMU_PHASE : (ATE)->prio)
+
+
+/*****************************************************************************/
+/*  Allocation site, defined in vmm.h. */
+/*****************************************************************************/
+struct vmm_site;
+
+
 /*****************************************************************************/
 /*  Allocation table entry. */
 /*****************************************************************************/
 struct ate
 {
+  size_t page_size;         /*!< bytes per page */
   size_t n_pages;           /*!< number of pages allocated */
   volatile size_t l_pages;  /*!< number of pages loaded */
   volatile size_t c_pages;  /*!< number of pages charged */
   volatile size_t d_pages;  /*!< number of pages dirty */
+  volatile size_t p_pages;  /*!< number of pages pinned */
+  volatile int prio;        /*!< eviction priority, see enum mmu_priority */
+  volatile int phase;       /*!< in the working set of the current phase */
+  volatile int group;       /*!< allocation group, 0 if none, see
+                                 sbma_mgroup_add() */
+  int opts;                 /*!< residency policy, see VMM_POLICY */
+  volatile unsigned r_frac; /*!< average fraction of pages loaded, see
+                                 VMM_LEARN_ONE */
+  volatile unsigned r_cnt;  /*!< number of times evicted whole */
+  volatile int r_bulk;      /*!< read in bulk since last evicted */
+  struct vmm_site * site;   /*!< allocation site, NULL unless VMM_SITES */
   uintptr_t base;           /*!< starting address fro the allocation */
   volatile uint8_t * flags; /*!< status flags for pages */
   struct ate * prev;        /*!< doubly linked list pointer */
   struct ate * next;        /*!< doubly linked list pointer */
-#ifdef USE_THREAD
   pthread_mutex_t lock;     /*!< mutex guarding struct */
-#endif
+};
+
+
+/*****************************************************************************/
+/*  Range of pages [beg..end) of an ate, see mmu_lookup_vec(). */
+/*****************************************************************************/
+struct mmu_run
+{
+  struct ate * ate; /*!< ate containing the range */
+  size_t beg;       /*!< first page of the range */
+  size_t end;       /*!< one past the last page of the range */
 };
 
 
@@ -82,9 +147,7 @@ struct mmu
 {
   size_t page_size;     /*!< page size */
   struct ate * a_tbl;   /*!< mmu allocation table */
-#ifdef USE_THREAD
   pthread_mutex_t lock; /*!< mutex guarding struct */
-#endif
 };
 
 
@@ -128,6 +191,16 @@ SBMA_EXPORT(internal, struct ate *
 mmu_lookup_ate(struct mmu * const mmu, void const * const addr));
 
 
+/*****************************************************************************/
+/*  Find the ates that contain the byte ranges [beg..end) given in run, and
+ *  replace them with the sorted and merged page ranges of those ates. Returns
+ *  the number of page ranges. */
+/*****************************************************************************/
+SBMA_EXPORT(internal, ssize_t
+mmu_lookup_vec(struct mmu * const mmu, struct mmu_run * const run,
+               size_t const num));
+
+
 #ifdef __cplusplus
 }
 #endif
@@ -31,7 +31,10 @@ THE SOFTWARE.
 
 
 #include <stdarg.h>    /* va_list */
+#include <stdint.h>    /* uint32_t, uint64_t */
 #include <sys/types.h> /* ssize_t */
+#include <sys/uio.h>   /* struct iovec */
+#include <time.h>      /* struct timespec */
 
 
 #define SBMA_MAJOR   0
@@ -66,7 +69,42 @@ THE SOFTWARE.
 /*****************************************************************************/
 enum sbma_mallopt_params
 {
-  M_VMMOPTS = 0 /*!< vmm option parameter for mallopt */
+  M_VMMOPTS  = 0, /*!< vmm option parameter for mallopt */
+  M_CHUNK    = 1, /*!< number of system pages reserved per admission credit
+                       refill, 0 disables the per-process credit pool */
+  M_QUOTA    = 2, /*!< number of system pages the process is guaranteed to
+                       keep resident, 0 by default */
+  M_PRIORITY = 3, /*!< positive weight of the process in fair share victim
+                       selection, 1 by default */
+  M_MAXMEM   = 4, /*!< number of system pages shared by all processes, which
+                       may be changed at any time by any process; if it
+                       cannot be shrunk to the value, since no process can
+                       release more memory, -1 is returned with errno set
+                       to EAGAIN and the budget is left partly shrunk */
+  M_GANG     = 5, /*!< number of processes allowed to compete for memory at
+                       once, -1 to size the gang from the observed working
+                       sets, 0 by default to disable the gang co-scheduler */
+  M_FLUSH    = 6, /*!< percent of its resident memory the process keeps clean,
+                       by writing dirty pages in the background, while it has
+                       signaling enabled, 0 by default to write only on
+                       eviction, 100 to write every dirty page */
+  M_BIGPAGE  = 7  /*!< number of pages per page of large allocations, 1 by
+                       default to use one page size for all allocations */
+};
+
+
+/*****************************************************************************/
+/*  Madvise advice. */
+/*****************************************************************************/
+enum sbma_madvise_advice
+{
+  SBMA_MADV_NORMAL     = 0, /*!< clear the advice given for the range */
+  SBMA_MADV_SEQUENTIAL = 1, /*!< read ahead of a fault in the range */
+  SBMA_MADV_RANDOM     = 2, /*!< read only the faulting page of the range */
+  SBMA_MADV_WILLNEED   = 3, /*!< read the range now, as SBMA_mtouch() */
+  SBMA_MADV_DONTNEED   = 4, /*!< write the range out now, as SBMA_mevict() */
+  SBMA_MADV_COLD       = 5, /*!< evict and clean the allocation first */
+  SBMA_MADV_HOT        = 6  /*!< evict and clean the allocation last */
 };
 
 
@@ -85,7 +123,13 @@ enum sbma_mallopt_params
  *    bit  8 ==    0:                      1: runtime state consistency check
  *    bit  9 ==    0:                      1: enhanced runtime state consistency check
  *    bit 10 ==    0:                      1: use standard c library malloc, etc.
- *    bit 11 ==    0:                      1: invalid options
+ *    bit 11 ==    0:                      1: admit fair share test (overrides bit 2)
+ *    bit 12 ==    0:                      1: adaptive memory budget (from PSI and cgroup v2)
+ *    bit 13 ==    0:                      1: automatic signaling around blocking calls
+ *    bit 14 ==    0:                      1: learned read granularity
+ *    bit 15 ==    0:                      1: allocation site attribution
+ *    bit 16 ==    0:                      1: per-site policy from a saved profile
+ *    bit 17 ==    0:                      1: invalid options
  *
  *  evict|rsdnt
  *    Determines the state of memory pages when the are allocated. If evict is
@@ -113,14 +157,22 @@ enum sbma_mallopt_params
  *    of allocations are accessed between successive evictions. Default is
  *    aggrd.
  *
- *  admitr|admitd
+ *  admitr|admitd|admitf
  *    Determines the heuristic used in SBMA_madmit() to choose which process to
- *    send SIGIPC to. In both cases, if no eligible processes have enough
- *    memory to satisfy the request, then the process with the most resident
- *    memory is chosen. If admitr is selected, then among the processes with
- *    more memory than the request, the process with the least resident memory
- *    is chosen. If admitd is selected, then among the same processes, the
- *    process with the least dirty memory is chosen.
+ *    ask to release memory. Processes which have enabled signaling, see
+ *    SBMA_sigon(), are always preferred, and no process is ever asked to
+ *    release memory below its quota, see M_QUOTA. For admitr and admitd, if
+ *    no eligible processes have enough memory to satisfy the request, then the
+ *    process with the most resident memory is chosen. If admitr is selected,
+ *    then among the processes with more memory than the request, the process
+ *    with the least resident memory is chosen. If admitd is selected, then
+ *    among the same processes, the process with the least dirty memory is
+ *    chosen. If admitf is selected, then memory is shared by weighted max-min
+ *    fairness, using the priorities of the processes as weights, see
+ *    M_PRIORITY. The process with the most resident memory relative to its
+ *    priority is chosen, but only if it holds more, relative to its priority,
+ *    than the requesting process will. Otherwise, the requesting process
+ *    releases its own memory. Default is admitr.
  *
  *  noaggch|aggch
  *    Enables aggressive charging of allocations. This is only valid with lraw
@@ -167,32 +219,93 @@ enum sbma_mallopt_params
  *    for by the allocation table entries. If extra is specified, then a more
  *    thorough check of the structures will be performed. Default is nocheck.
  *
+ *  noadapt|adapt
+ *    Enables the adaptive memory budget. With it enabled, the first process
+ *    to join runs a thread which periodically reads the memory pressure stall
+ *    information, /proc/pressure/memory, and the memory headroom of its cgroup
+ *    v2, memory.max less memory.current, or of the system if the cgroup has no
+ *    limit. The memory shared by all processes, initially max_mem, grows into
+ *    the headroom while there is no pressure, and shrinks when there is,
+ *    evicting memory as needed. Default is noadapt.
+ *
+ *  noautosig|autosig
+ *    Enables automatic signaling. With it enabled, signaling, see
+ *    SBMA_sigon(), is enabled while every thread of the application is
+ *    blocked in one of pthread_cond_wait, pthread_cond_timedwait,
+ *    pthread_barrier_wait, sem_wait, sem_timedwait, poll, epoll_wait,
+ *    nanosleep or waitpid, so that a process waiting on a peer is asked to
+ *    release memory before one that is computing. The threads started by the
+ *    runtime are not counted. It is not enabled when the object waited on, or the buffer
+ *    the call returns results in, is itself dynamic memory allocated by SBMA.
+ *    Default is noautosig.
+ *
+ *  nolearn|learn
+ *    Enables learning the read granularity of each allocation. With it
+ *    enabled, the fraction of the pages of an allocation which were loaded
+ *    when it is evicted whole is kept as a moving average, and at each
+ *    reload, the allocation is read whole if it is usually accessed in full,
+ *    a page at a time if it is accessed sparsely, and in clusters of pages
+ *    otherwise, regardless of aggrd or lzyrd. Default is nolearn.
+ *
+ *  nosites|sites
+ *    Enables attributing faults and I/O to the site at which memory was
+ *    allocated, i.e., to the backtrace of the call to SBMA_malloc(). With it
+ *    enabled, the faults, pages read and written, evictions and time spent
+ *    reading and writing are counted per site, and a report of the sites,
+ *    ranked by time, is written to stderr by SBMA_destroy(), or to any file
+ *    by SBMA_mreport(). Default is nosites.
+ *
+ *  noprof|prof
+ *    Enables learning the residency policy of each allocation site, as for
+ *    sites but without the report. At SBMA_destroy(), a site whose
+ *    allocations were usually loaded in full when evicted is given
+ *    aggressive reads, one whose allocations were loaded sparsely lazy reads
+ *    with a learned granularity, see learn, and one whose memory was rarely
+ *    read back once written is evicted and cleaned first. The policies are
+ *    kept in a profile file of the program under the file stem, and are
+ *    applied to the allocations which later runs make at the same sites with
+ *    the policy of the runtime options. Default is noprof.
+ *
  *  noosvmm|osvmm
  *    Enables the use of the standard C library dynamic memory allocation
  *    functions. When this is enabled, all other options are disabled. Default
  *    is noosvmm.
  *
  *  default
- *    evict,lzyrd,admitr,noaggch,noghost,merge,nometach,nomlock,nocheck,noosvmm
+ *    evict,lzyrd,admitr,noaggch,noghost,merge,nometach,nomlock,nocheck,
+ *    noadapt,noautosig,nolearn,nosites,noprof,noosvmm
  */
 /*****************************************************************************/
 enum sbma_vmm_opt_code
 {
-  VMM_RSDNT  = 1 << 0,
-  VMM_LZYRD  = 1 << 1,
-  VMM_ADMITD = 1 << 2,
-  VMM_AGGCH  = 1 << 3,
-  VMM_GHOST  = 1 << 4,
-  VMM_MERGE  = 1 << 5,
-  VMM_METACH = 1 << 6,
-  VMM_MLOCK  = 1 << 7,
-  VMM_CHECK  = 1 << 8,
-  VMM_EXTRA  = 1 << 9,
-  VMM_OSVMM  = 1 << 10,
-  VMM_INVLD  = 1 << 11
+  VMM_RSDNT   = 1 << 0,
+  VMM_LZYRD   = 1 << 1,
+  VMM_ADMITD  = 1 << 2,
+  VMM_AGGCH   = 1 << 3,
+  VMM_GHOST   = 1 << 4,
+  VMM_MERGE   = 1 << 5,
+  VMM_METACH  = 1 << 6,
+  VMM_MLOCK   = 1 << 7,
+  VMM_CHECK   = 1 << 8,
+  VMM_EXTRA   = 1 << 9,
+  VMM_OSVMM   = 1 << 10,
+  VMM_ADMITF  = 1 << 11,
+  VMM_ADAPT   = 1 << 12,
+  VMM_AUTOSIG = 1 << 13,
+  VMM_LEARN   = 1 << 14,
+  VMM_SITES   = 1 << 15,
+  VMM_PROF    = 1 << 16,
+  VMM_INVLD   = 1 << 17
 };
 
 
+/*****************************************************************************/
+/*  Option bits which may be chosen per allocation with SBMA_malloc_ex(),
+ *  instead of for the whole process. */
+/*****************************************************************************/
+#define VMM_POLICY (VMM_LZYRD|VMM_AGGCH|VMM_GHOST|VMM_LEARN)
+
+
 /*****************************************************************************/
 /*  Struct to return timer values. */
 /*****************************************************************************/
@@ -205,6 +318,83 @@ struct sbma_timeinfo
 };
 
 
+/*****************************************************************************/
+/*  Version of struct sbma_stats. Fields are only ever appended to the struct,
+ *  and the version is incremented whenever they are. */
+/*****************************************************************************/
+#define SBMA_STATS_VERSION 1
+
+
+/*****************************************************************************/
+/*  Scope of the statistics returned by SBMA_mstats(). */
+/*****************************************************************************/
+enum sbma_stats_scope
+{
+  SBMA_STATS_PROC = 0, /*!< the calling process */
+  SBMA_STATS_NODE = 1  /*!< every process which shared the node with it, since
+                            the first of them started */
+};
+
+
+/*****************************************************************************/
+/*  Struct to return statistics, see SBMA_mstats(). Counters, times and sizes
+ *  are never truncated. Readahead hits count the pages which were read ahead
+ *  of a fault and then written, and so are a lower bound, since pages which
+ *  are only read never fault again. */
+/*****************************************************************************/
+struct sbma_stats
+{
+  uint32_t version; /*!< SBMA_STATS_VERSION of the library */
+  uint32_t size;    /*!< bytes of the struct which were filled in */
+
+  uint64_t numrf;   /*!< read faults */
+  uint64_t numrfio; /*!< read faults which read from disk */
+  uint64_t numwf;   /*!< write faults */
+
+  uint64_t bytrd;   /*!< bytes read from disk */
+  uint64_t bytwr;   /*!< bytes written to disk */
+  uint64_t bytra;   /*!< bytes read ahead of faults */
+  uint64_t bytrh;   /*!< bytes read ahead of faults and then written */
+
+  uint64_t tmrrd;   /*!< nanoseconds spent reading */
+  uint64_t tmrwr;   /*!< nanoseconds spent writing */
+  uint64_t tmrad;   /*!< nanoseconds spent waiting for admission */
+  uint64_t tmrev;   /*!< nanoseconds spent evicting */
+
+  uint64_t numreq;  /*!< eviction requests made */
+  uint64_t numipc;  /*!< eviction requests received */
+  uint64_t numhipc; /*!< eviction requests honored */
+
+  uint64_t memal;   /*!< bytes allocated */
+  uint64_t memrs;   /*!< bytes resident */
+  uint64_t memhw;   /*!< high water mark of bytes resident */
+  uint64_t mempn;   /*!< bytes pinned */
+  uint64_t memdt;   /*!< bytes dirty */
+};
+
+
+/*****************************************************************************/
+/*  Asynchronous operation ticket, see SBMA_madmit_async() and
+ *  SBMA_mprefetch(). The ticket is owned by the caller, must not be stored in
+ *  memory allocated by SBMA, and must not be modified while it is pending.
+ *  Once status is no longer 1, the ticket may be reused, unless cb is set, in
+ *  which case it is handed to cb as the last access made to it by the
+ *  runtime. */
+/*****************************************************************************/
+struct sbma_ticket
+{
+  void * addr;                /*!< start of memory to prefetch */
+  size_t len;                 /*!< bytes of memory to admit or prefetch */
+  int efd;                    /*!< eventfd written on completion, or -1 */
+  void (*cb)(struct sbma_ticket * const); /*!< called on completion, or NULL */
+  void * arg;                 /*!< argument for cb */
+  volatile int status;        /*!< 1 pending, 0 admitted, -1 failed */
+
+  size_t pages;               /*!< internal: system pages to admit */
+  struct sbma_ticket * next;  /*!< internal: next ticket in queue */
+};
+
+
 /*****************************************************************************/
 /*  Function prototypes. */
 /*****************************************************************************/
@@ -243,6 +433,9 @@ KL_free(void * const));
 SBMA_EXPORT(internal, void *
 sbma_malloc(size_t const));
 
+SBMA_EXPORT(internal, void *
+sbma_malloc_ex(size_t const, int const, size_t const));
+
 SBMA_EXPORT(internal, void *
 sbma_calloc(size_t const, size_t const));
 
@@ -281,6 +474,9 @@ sbma_mallinfo(void));
 SBMA_EXPORT(default, struct sbma_timeinfo
 sbma_timeinfo(void));
 
+SBMA_EXPORT(default, int
+sbma_mstats(struct sbma_stats * const, size_t const, int const));
+
 SBMA_EXPORT(default, int
 sbma_sigon(void));
 
@@ -292,12 +488,18 @@ sbma_sigoff(void));
 SBMA_EXPORT(internal, int
 sbma_mcheck(char const * const, int const));
 
+SBMA_EXPORT(internal, ssize_t
+sbma_mtouch_ex(void * const, void * const, size_t const, int const));
+
 SBMA_EXPORT(internal, ssize_t
 sbma_mtouch(void * const, void * const, size_t const));
 
 SBMA_EXPORT(internal, ssize_t
 sbma_mtouch_atomic(void * const, size_t const, ...));
 
+SBMA_EXPORT(internal, ssize_t
+sbma_mtouchv(struct iovec const * const, size_t const));
+
 SBMA_EXPORT(internal, ssize_t
 sbma_mtouchall(void));
 
@@ -310,6 +512,9 @@ sbma_mclearall(void));
 SBMA_EXPORT(internal, ssize_t
 sbma_mevict(void * const, size_t const));
 
+SBMA_EXPORT(internal, ssize_t
+sbma_mevictv(struct iovec const * const, size_t const));
+
 SBMA_EXPORT(internal, int
 sbma_mevictall_int(size_t * const, size_t * const, size_t * const));
 
@@ -319,6 +524,63 @@ sbma_mevictall(void));
 SBMA_EXPORT(internal, int
 sbma_mexist(void const * const));
 
+SBMA_EXPORT(internal, int
+sbma_madvise(void * const, size_t const, int const));
+
+SBMA_EXPORT(internal, int
+sbma_mpin(void * const, size_t const));
+
+SBMA_EXPORT(internal, int
+sbma_munpin(void * const, size_t const));
+
+
+/* madmit.c */
+SBMA_EXPORT(default, int
+sbma_madmit_async(struct sbma_ticket * const));
+
+SBMA_EXPORT(default, int
+sbma_madmit_wait(struct sbma_ticket * const, struct timespec const * const));
+
+SBMA_EXPORT(default, int
+sbma_madmit_cancel(struct sbma_ticket * const));
+
+
+/* mprefetch.c */
+SBMA_EXPORT(default, int
+sbma_mprefetch(void * const, size_t const, struct sbma_ticket * const));
+
+
+/* mgroup.c */
+SBMA_EXPORT(internal, int
+sbma_mgroup_create(void));
+
+SBMA_EXPORT(internal, int
+sbma_mgroup_add(int const, void * const));
+
+SBMA_EXPORT(internal, ssize_t
+sbma_mgroup_touch(int const));
+
+
+/* mrecord.c */
+SBMA_EXPORT(default, int
+sbma_mrecord(int const));
+
+SBMA_EXPORT(default, ssize_t
+sbma_mmark(int const));
+
+
+/* mreport.c */
+SBMA_EXPORT(default, int
+sbma_mreport(int const));
+
+
+/* phase.c */
+SBMA_EXPORT(internal, ssize_t
+sbma_phase_begin(struct iovec const * const, size_t const));
+
+SBMA_EXPORT(internal, int
+sbma_phase_end(void));
+
 
 #ifdef __cplusplus
 }
@@ -333,6 +595,11 @@ sbma_mexist(void const * const));
 #define SBMA_realloc            KL_realloc
 #define SBMA_free               KL_free
 
+/* malloc.c */
+#define SBMA_malloc_ex          sbma_malloc_ex
+#define SBMA_realloc_ex         sbma_realloc
+#define SBMA_free_ex            sbma_free
+
 /* mextra.c */
 #define SBMA_mallopt            sbma_mallopt
 #define SBMA_parse_optstr       sbma_parse_optstr
@@ -340,16 +607,45 @@ sbma_mexist(void const * const));
 #define SBMA_sigon              sbma_sigon
 #define SBMA_sigoff             sbma_sigoff
 #define SBMA_timeinfo           sbma_timeinfo
+#define SBMA_mstats             sbma_mstats
 
 /* mstate.c */
 #define SBMA_mtouch(...)        sbma_mtouch(NULL, __VA_ARGS__)
 #define SBMA_mtouch_atomic(...) sbma_mtouch_atomic(__VA_ARGS__, SBMA_ATOMIC_END)
+#define SBMA_mtouchv            sbma_mtouchv
 #define SBMA_mtouchall          sbma_mtouchall
 #define SBMA_mclear             sbma_mclear
 #define SBMA_mclearall          sbma_mclearall
 #define SBMA_mevict             sbma_mevict
+#define SBMA_mevictv            sbma_mevictv
 #define SBMA_mevictall          sbma_mevictall
 #define SBMA_mexist             sbma_mexist
+#define SBMA_madvise            sbma_madvise
+#define SBMA_mpin               sbma_mpin
+#define SBMA_munpin             sbma_munpin
+
+/* madmit.c */
+#define SBMA_madmit_async       sbma_madmit_async
+#define SBMA_madmit_wait        sbma_madmit_wait
+#define SBMA_madmit_cancel      sbma_madmit_cancel
+
+/* mprefetch.c */
+#define SBMA_mprefetch          sbma_mprefetch
+
+/* mgroup.c */
+#define SBMA_mgroup_create      sbma_mgroup_create
+#define SBMA_mgroup_add         sbma_mgroup_add
+
+/* mrecord.c */
+#define SBMA_mrecord            sbma_mrecord
+#define SBMA_mmark              sbma_mmark
+
+/* mreport.c */
+#define SBMA_mreport            sbma_mreport
+
+/* phase.c */
+#define SBMA_phase_begin        sbma_phase_begin
+#define SBMA_phase_end          sbma_phase_end
 
 
 #endif /* SBMA_H */
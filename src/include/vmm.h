@@ -30,14 +30,158 @@ THE SOFTWARE.
 #endif
 
 
+#include <pthread.h>   /* pthread_t, pthread_mutex_t */
 #include <signal.h>    /* struct sigaction, siginfo_t, sigemptyset, sigaction */
 #include <stddef.h>    /* size_t */
 #include <stdio.h>     /* FILENAME_MAX */
+#include <stdint.h>    /* uintptr_t */
 #include <sys/types.h> /* ssize_t */
 #include "ipc.h"
 #include "mmu.h"
 
 
+/*****************************************************************************/
+/*  Number of pages read on a fault in memory advised as sequential, see
+ *  SBMA_madvise(). */
+/*****************************************************************************/
+#define VMM_READAHEAD 64
+
+
+/*****************************************************************************/
+/*  Learned read granularity, see VMM_LEARN. Below VMM_LEARN_LO, an
+ *  allocation is read a page at a time on a fault, at or above VMM_LEARN_HI
+ *  whole, and in between in aligned clusters of VMM_READAHEAD pages. The
+ *  fraction, in units of 1/VMM_LEARN_ONE, is that of the pages which were
+ *  loaded when the allocation was evicted whole. Those are the pages accessed
+ *  only if it was read a page at a time, so only then is a sample taken, each
+ *  weighing 1/VMM_LEARN_DECAY. An allocation read in bulk is read a page at
+ *  a time on every VMM_LEARN_PROBE-th reload instead, and the sample then
+ *  taken replaces the average. Allocations start out read a page at a time. */
+/*****************************************************************************/
+#define VMM_LEARN_ONE   256
+#define VMM_LEARN_DECAY 2
+#define VMM_LEARN_HI    (VMM_LEARN_ONE*3/4)
+#define VMM_LEARN_LO    (VMM_LEARN_ONE/8)
+#define VMM_LEARN_PROBE 8
+
+
+/*****************************************************************************/
+/*  Number of I/O threads which serve prefetches, see SBMA_mprefetch(). */
+/*****************************************************************************/
+#define VMM_IO_THREADS 2
+
+
+/*****************************************************************************/
+/*  Number of allocation sites which are told apart, and number of frames of
+ *  the backtrace which identifies a site, see VMM_SITES. */
+/*****************************************************************************/
+#define VMM_SITE_MAX   256
+#define VMM_SITE_DEPTH 8
+
+
+/*****************************************************************************/
+/*  Allocation site, i.e., the backtrace of the calls to SBMA_malloc() which
+ *  made an allocation, with the counters of the allocations made there. The
+ *  counters are updated atomically, since the allocations of a site are
+ *  locked separately. */
+/*****************************************************************************/
+struct vmm_site
+{
+  volatile uintptr_t key;       /*!< hash of the backtrace, 0 if unused */
+  int depth;                    /*!< number of frames of the backtrace */
+  void * frames[VMM_SITE_DEPTH]; /*!< backtrace */
+
+  uint64_t pkey;                /*!< hash of the backtrace which is the same
+                                     in every run, 0 if unknown */
+  int opts;                     /*!< learned residency policy, -1 if none */
+  int prio;                     /*!< learned eviction priority */
+
+  volatile size_t numal;        /*!< number of allocations made */
+  volatile size_t numrf;        /*!< number of read segfaults */
+  volatile size_t numwf;        /*!< number of write segfaults */
+  volatile size_t numrd;        /*!< number of syspages read */
+  volatile size_t numwr;        /*!< number of syspages written */
+  volatile size_t numev;        /*!< number of times pages were evicted */
+  volatile size_t tmrio;        /*!< nanoseconds spent reading and writing */
+  volatile size_t numld;        /*!< syspages loaded when evicted whole */
+  volatile size_t numsz;        /*!< syspages allocated when evicted whole */
+};
+
+
+/*****************************************************************************/
+/*  Policy learned for an allocation site, as stored in the profile, see
+ *  VMM_PROF. */
+/*****************************************************************************/
+struct vmm_prof
+{
+  uint64_t pkey;                /*!< hash of the backtrace of the site */
+  int opts;                     /*!< residency policy */
+  int prio;                     /*!< eviction priority */
+};
+
+
+/*****************************************************************************/
+/*  Identifies a profile file, and the version of its format. */
+/*****************************************************************************/
+#define VMM_PROF_MAGIC   0x53424d50u
+#define VMM_PROF_VERSION 1
+
+
+/*****************************************************************************/
+/*  Header of a profile file, which is followed by num struct vmm_prof. */
+/*****************************************************************************/
+struct vmm_prof_hdr
+{
+  uint32_t magic;               /*!< VMM_PROF_MAGIC */
+  uint32_t version;             /*!< VMM_PROF_VERSION */
+  uint64_t num;                 /*!< number of sites */
+};
+
+
+/*****************************************************************************/
+/*  A site whose memory is read back from disk less than once in this many
+ *  pages written is written back early, i.e., its allocations are evicted and
+ *  cleaned first. */
+/*****************************************************************************/
+#define VMM_PROF_RARE 4
+
+
+/*****************************************************************************/
+/*  Increments a particular counter of the allocation site of an ate, if it
+ *  has one. */
+/*****************************************************************************/
+#define VMM_SITE_TRACK(ATE, FIELD, VAL)\
+do {\
+  if (NULL != (ATE)->site)\
+    (void)__sync_fetch_and_add(&((ATE)->site->FIELD), (VAL));\
+} while (0)
+
+
+/*****************************************************************************/
+/*  Converts a timer value of TIMER_STOP() to nanoseconds. */
+/*****************************************************************************/
+#define VMM_TO_NSEC(TMR) IPC_TO_NSEC(TMR)
+
+
+/*****************************************************************************/
+/*  Number of faults the fault log has room for initially, see
+ *  SBMA_mrecord(). */
+/*****************************************************************************/
+#define VMM_REC_INIT 1024
+
+
+/*****************************************************************************/
+/*  Fault recorded by SBMA_mrecord(). */
+/*****************************************************************************/
+struct vmm_rec
+{
+  int mark;                     /*!< phase marker current at the fault */
+  uintptr_t addr;               /*!< start of memory read */
+  size_t len;                   /*!< bytes of memory read */
+  struct sbma_ticket tkt;       /*!< ticket of the replayed prefetch */
+};
+
+
 /*****************************************************************************/
 /*  Virtual memory manager. */
 /*****************************************************************************/
@@ -47,32 +191,45 @@ struct vmm
   int opts;                     /*!< runtime options */
 
   size_t page_size;             /*!< bytes per page */
+  size_t big_size;              /*!< bytes per page of large allocations */
 
-  volatile size_t numipc;       /*!< total number of SIGIPC received */
-  volatile size_t numhipc;      /*!< total number of SIGIPC honored */
-
-  volatile size_t numrf;        /*!< total number of read segfaults */
-  volatile size_t numwf;        /*!< total number of write segfaults */
-  volatile size_t numrd;        /*!< total number of pages read */
-  volatile size_t numwr;        /*!< total number of pages written */
-  volatile double tmrrd;        /*!< read timer */
-  volatile double tmrwr;        /*!< write timer */
-
-  size_t numpages;              /*!< current pages allocated */
+  volatile int groups;          /*!< number of allocation groups created */
 
   char fstem[FILENAME_MAX];     /*!< the file stem where the data is stored */
 
   struct sigaction act_segv;    /*!< for the SIGSEGV signal handler */
   struct sigaction oldact_segv; /*!< ... */
-  struct sigaction act_ipc;     /*!< for the SIGIPC signal handler */
-  struct sigaction oldact_ipc;  /*!< ... */
+
+  volatile int flush;           /*!< percent of memory kept clean when idle */
+  volatile int evict;           /*!< eviction thread running indicator */
+  pthread_t evictor;            /*!< eviction thread */
+
+  volatile int adapt;           /*!< budget thread running indicator */
+  pthread_t adaptor;            /*!< budget thread */
+
+  volatile int io;              /*!< I/O threads running indicator */
+  volatile int io_event;        /*!< prefetch event counter and futex word */
+  pthread_t io_thread[VMM_IO_THREADS]; /*!< I/O threads */
+  struct sbma_ticket * io_head; /*!< oldest pending prefetch */
+  struct sbma_ticket * io_tail; /*!< newest pending prefetch */
+  pthread_mutex_t io_lock;      /*!< mutex guarding prefetch queue */
+
+  volatile int rec;             /*!< fault recording indicator */
+  int rec_mark;                 /*!< current phase marker */
+  size_t rec_num;               /*!< number of faults recorded */
+  size_t rec_max;               /*!< number of faults with room in the log */
+  struct vmm_rec * rec_log;     /*!< fault log, see SBMA_mrecord() */
+  pthread_mutex_t rec_lock;     /*!< mutex guarding fault log */
+
+  struct vmm_site * volatile sites; /*!< allocation sites, see VMM_SITES */
+  struct vmm_prof * prof;       /*!< profile loaded, see VMM_PROF */
+  size_t prof_num;              /*!< number of sites in profile */
 
   struct mmu mmu;               /*!< memory management unit */
   struct ipc ipc;               /*!< interprocess communicator */
 
-#ifdef USE_THREAD
   pthread_mutex_t lock;         /*!< mutex guarding struct */
-#endif
+  pthread_mutex_t stat_lock;    /*!< mutex guarding statistics */
 };
 
 
@@ -83,37 +240,74 @@ extern struct vmm _vmm_;
 
 
 /*****************************************************************************/
-/*  Converts pages to system pages. */
+/*  Converts pages of PAGE_SIZE bytes to system pages. Application pages are
+ *  converted with the page size of their ate, struct and flag pages with
+ *  _vmm_.page_size. */
+/*****************************************************************************/
+#define VMM_TO_SYS(PAGE_SIZE, N_PAGES)\
+  ((size_t)(N_PAGES)*(PAGE_SIZE)/(size_t)sysconf(_SC_PAGESIZE))
+
+
+/*****************************************************************************/
+/*  Converts system pages to bytes. */
+/*****************************************************************************/
+#define VMM_SYS_BYTES(N_SYS)\
+  ((uint64_t)(N_SYS)*(uint64_t)sysconf(_SC_PAGESIZE))
+
+
+/*****************************************************************************/
+/*  Minimum number of pages of _vmm_.big_size bytes spanned by an allocation
+ *  which uses them, see sbma_malloc_ex(). */
+/*****************************************************************************/
+#define VMM_BIG_PAGES 64
+
+
+/*****************************************************************************/
+/*  Parameters of the adaptive memory budget, see vmm_adapt(). The budget is
+ *  re-evaluated every VMM_ADAPT_TICKS*VMM_ADAPT_NSEC nanoseconds, shrunk when
+ *  the 10 second average of the memory pressure stall information exceeds
+ *  VMM_ADAPT_PSI percent, and only changed when it differs from its current
+ *  value by more than 1/VMM_ADAPT_HYST. */
+/*****************************************************************************/
+#define VMM_ADAPT_NSEC  100000000
+#define VMM_ADAPT_TICKS 10
+#define VMM_ADAPT_PSI   10.0
+#define VMM_ADAPT_HYST  16
+
+
+/*****************************************************************************/
+/*  Nanoseconds the eviction thread waits before retrying to clean dirty
+ *  pages which were in use by the application, see M_FLUSH. */
 /*****************************************************************************/
-#define VMM_TO_SYS(N_PAGES)\
-  ((size_t)(N_PAGES)*_vmm_.page_size/(size_t)sysconf(_SC_PAGESIZE))
+#define VMM_FLUSH_NSEC 10000000
 
 
 /*****************************************************************************/
-/*  Constructs which implement a intra-process critical section. */
+/*  Constructs which implement a intra-process critical section. These guard
+ *  only the statistics, using their own lock, so that the eviction thread
+ *  never has to wait for a thread holding the allocation table lock. */
 /*****************************************************************************/
 #define VMM_INTRA_CRITICAL_SECTION_BEG(VMM)\
 do {\
   int _ret;\
-  _ret = lock_get(&((VMM)->lock));\
+  _ret = lock_get(&((VMM)->stat_lock));\
   ASSERT(0 == _ret);\
 } while (0)
 
 #define VMM_INTRA_CRITICAL_SECTION_END(VMM)\
 do {\
   int _ret;\
-  _ret = lock_let(&((VMM)->lock));\
+  _ret = lock_let(&((VMM)->stat_lock));\
   ASSERT(0 == _ret);\
 } while (0)
 
 
 /*****************************************************************************/
-/*  Increments a particular field in the info struct. */
+/*  Adds to a particular field of the statistics of the process and of the
+ *  node, see struct sbma_stats. */
 /*****************************************************************************/
 #define VMM_TRACK(VMM, FIELD, VAL)\
-do {\
-  (VMM)->FIELD += (VAL);\
-} while (0)
+  IPC_TRACK(&((VMM)->ipc), FIELD, VAL)
 
 
 #ifdef __cplusplus
@@ -132,12 +326,20 @@ vmm_swap_i(struct ate * const ate, size_t const beg, size_t const num,
 
 /*****************************************************************************/
 /*  Swaps the supplied range of pages out, writing any dirty pages to
- *  disk. */
+ *  disk. Pinned pages are left resident. */
 /*****************************************************************************/
 SBMA_EXPORT(internal, ssize_t
 vmm_swap_o(struct ate * const ate, size_t const beg, size_t const num));
 
 
+/*****************************************************************************/
+/*  Writes the dirty pages in the supplied range to disk, keeping them
+ *  resident. */
+/*****************************************************************************/
+SBMA_EXPORT(internal, ssize_t
+vmm_swap_c(struct ate * const ate, size_t const beg, size_t const num));
+
+
 /*****************************************************************************/
 /*  Clear the MMU_DIRTY and set the MMU_ZFILL flags for the supplied range of
  *  pages */
@@ -146,6 +348,118 @@ SBMA_EXPORT(internal, ssize_t
 vmm_swap_x(struct ate * const ate, size_t const beg, size_t const num));
 
 
+/*****************************************************************************/
+/*  Write len bytes of buf to file descriptor fd at offset off. Used by
+ *  vmm_swap_o() and vmm_swap_c(). */
+/*****************************************************************************/
+SBMA_EXPORT(internal, int
+vmm_write(int const fd, void const * const buf, size_t len, size_t off));
+
+
+/*****************************************************************************/
+/*  Budget thread. Adapts the memory shared by all processes to the memory
+ *  pressure of the system. */
+/*****************************************************************************/
+SBMA_EXPORT(internal, void *
+vmm_adapt(void * const arg));
+
+
+/*****************************************************************************/
+/*  I/O thread. Serves the prefetches queued by vmm_prefetch_push(). */
+/*****************************************************************************/
+SBMA_EXPORT(internal, void *
+vmm_prefetch(void * const arg));
+
+
+/*****************************************************************************/
+/*  Queue a prefetch, starting the I/O threads if necessary. */
+/*****************************************************************************/
+SBMA_EXPORT(internal, int
+vmm_prefetch_push(struct vmm * const vmm, struct sbma_ticket * const tkt));
+
+
+/*****************************************************************************/
+/*  Remove a pending prefetch from the queue. Returns -1 if the prefetch is
+ *  not pending. */
+/*****************************************************************************/
+SBMA_EXPORT(internal, int
+vmm_prefetch_cancel(struct vmm * const vmm, struct sbma_ticket * const tkt));
+
+
+/*****************************************************************************/
+/*  Append a fault which read len bytes of memory at addr, of the allocation
+ *  at base, to the fault log, merging it with the last one if they are
+ *  adjacent. */
+/*****************************************************************************/
+SBMA_EXPORT(internal, int
+vmm_record(struct vmm * const vmm, uintptr_t const base, void * const addr,
+           size_t const len));
+
+
+/*****************************************************************************/
+/*  Queue prefetches for the faults recorded with phase marker mark and those
+ *  which followed them, as long as free memory suffices. Returns the number
+ *  of system pages queued. */
+/*****************************************************************************/
+SBMA_EXPORT(internal, ssize_t
+vmm_replay(struct vmm * const vmm, int const mark));
+
+
+/*****************************************************************************/
+/*  Cancel or wait for the prefetches queued by vmm_replay() and empty the
+ *  fault log. */
+/*****************************************************************************/
+SBMA_EXPORT(internal, int
+vmm_record_reset(struct vmm * const vmm));
+
+
+/*****************************************************************************/
+/*  Create the table of allocation sites, if it does not exist yet, and load
+ *  the profile of the program first if prof is non-zero. */
+/*****************************************************************************/
+SBMA_EXPORT(internal, int
+vmm_site_init(struct vmm * const vmm, int const prof));
+
+
+/*****************************************************************************/
+/*  Returns the allocation site of the caller, or NULL if the table of
+ *  allocation sites does not exist or is full. */
+/*****************************************************************************/
+SBMA_EXPORT(internal, struct vmm_site *
+vmm_site(struct vmm * const vmm));
+
+
+/*****************************************************************************/
+/*  Write a report of the allocation sites to fd, ranked by the time spent
+ *  reading and writing their memory. */
+/*****************************************************************************/
+SBMA_EXPORT(internal, int
+vmm_site_report(struct vmm * const vmm, int const fd));
+
+
+/*****************************************************************************/
+/*  Load the profile of the program, if there is one. */
+/*****************************************************************************/
+SBMA_EXPORT(internal, int
+vmm_prof_load(struct vmm * const vmm));
+
+
+/*****************************************************************************/
+/*  Set the policy of a new allocation site from the profile. */
+/*****************************************************************************/
+SBMA_EXPORT(internal, void
+vmm_prof_find(struct vmm * const vmm, struct vmm_site * const site));
+
+
+/*****************************************************************************/
+/*  Learn the policy of each allocation site from its counters and store it
+ *  in the profile of the program, together with the policies of the sites
+ *  of earlier runs which were not seen in this one. */
+/*****************************************************************************/
+SBMA_EXPORT(internal, int
+vmm_prof_save(struct vmm * const vmm));
+
+
 /*****************************************************************************/
 /*  Initializes the sbmalloc subsystem. */
 /*****************************************************************************/
@@ -33,20 +33,20 @@ THE SOFTWARE.
 
 
 /*****************************************************************************/
-/*  MP-Unsafe race:rw(ipc->s_mem,ipc->c_mem[ipc->id])                        */
-/*            race:wr(ipc->d_mem[ipc->id])                                   */
-/*  MT-Unsafe race:rw(ipc->s_mem,ipc->c_mem[ipc->id])                        */
+/*  MP-Unsafe race:rw(ipc->s_mem,ipc->slot[ipc->id].c_mem)                   */
+/*            race:wr(ipc->slot[ipc->id].d_mem)                              */
+/*  MT-Unsafe race:rw(ipc->s_mem,ipc->slot[ipc->id].c_mem)                   */
 /*                                                                           */
 /*  Note:                                                                    */ 
 /*    1)  Only other threads from this process will ever modify              */
-/*        ipc->d_mem[ipc->id], so the IPC_INTRA_CRICITAL_SECTION is          */
+/*        ipc->slot[ipc->id].d_mem, so the IPC_INTRA_CRICITAL_SECTION is     */
 /*        sufficient to make that variable MT-Safe.                          */
 /*                                                                           */
 /*  Mitigation:                                                              */
-/*    1)  Call from within an IPC_INTER_CRITICAL_SECTION or call after       */
-/*        receiving SIGIPC from a process in an IPC_INTER_CRITICAL_SECTION.  */
-/*    2)  Functions that READ ipc->d_mem[ipc->id] from a different process   */
-/*        SHOULD be aware of the possibility of reading a stale value.       */
+/*    1)  Call from within an IPC_INTER_CRITICAL_SECTION.                    */
+/*    2)  Functions that READ ipc->slot[ipc->id].d_mem from a different      */
+/*        process SHOULD be aware of the possibility of reading a stale      */
+/*        value.                                                             */
 /*****************************************************************************/
 SBMA_EXTERN void
 ipc_atomic_dec(struct ipc * const ipc, size_t const c_pages,
@@ -56,12 +56,12 @@ ipc_atomic_dec(struct ipc * const ipc, size_t const c_pages,
   IPC_INTRA_CRITICAL_SECTION_BEG(ipc);
   /*=========================================================================*/
 
-  ASSERT(ipc->c_mem[ipc->id] >= c_pages);
-  ASSERT(ipc->d_mem[ipc->id] >= d_pages);
+  ASSERT(ipc->slot[ipc->id].c_mem >= c_pages);
+  ASSERT(ipc->slot[ipc->id].d_mem >= d_pages);
 
   *ipc->s_mem += c_pages;
-  ipc->c_mem[ipc->id] -= c_pages;
-  ipc->d_mem[ipc->id] -= d_pages;
+  ipc->slot[ipc->id].c_mem -= c_pages;
+  ipc->slot[ipc->id].d_mem -= d_pages;
 
   /*=========================================================================*/
   IPC_INTRA_CRITICAL_SECTION_END(ipc);
@@ -0,0 +1,79 @@
+/*
+Copyright (c) 2015,2016 Jeremy Iverson
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+
+#ifndef _GNU_SOURCE
+# define _GNU_SOURCE 1
+#endif
+
+
+#include <stddef.h> /* size_t */
+#include "common.h"
+#include "ipc.h"
+#include "sbma.h"
+
+
+/*****************************************************************************/
+/*  MP-Unsafe race:rw(ipc->s_mem,ipc->slot[ipc->id].c_mem)                   */
+/*  MT-Safe                                                                  */
+/*                                                                           */
+/*  Note:                                                                    */
+/*    1)  Credits are already accounted for in ipc->slot[ipc->id].c_mem, so  */
+/*        returning them only moves memory from the process to the system.   */
+/*                                                                           */
+/*  Mitigation:                                                              */
+/*    1)  Call from within an IPC_INTER_CRITICAL_SECTION.                    */
+/*****************************************************************************/
+SBMA_EXTERN size_t
+ipc_atomic_flush(struct ipc * const ipc)
+{
+  size_t credit;
+
+  /*=========================================================================*/
+  IPC_INTRA_CRITICAL_SECTION_BEG(ipc);
+  /*=========================================================================*/
+
+  credit = ipc->credit;
+
+  ASSERT(ipc->slot[ipc->id].c_mem >= credit);
+
+  *ipc->s_mem += credit;
+  ipc->slot[ipc->id].c_mem -= credit;
+  ipc->credit = 0;
+
+  /*=========================================================================*/
+  IPC_INTRA_CRITICAL_SECTION_END(ipc);
+  /*=========================================================================*/
+
+  return credit;
+}
+
+
+#ifdef TEST
+int
+main(int argc, char * argv[])
+{
+  if (0 == argc || NULL == argv) {}
+
+  return 0;
+}
+#endif
@@ -26,30 +26,40 @@ THE SOFTWARE.
 #endif
 
 
-#include <stddef.h> /* size_t */
+#include <stddef.h> /* NULL, size_t */
+#include <stdint.h> /* uint64_t */
+#include <unistd.h> /* sysconf */
 #include "common.h"
 #include "ipc.h"
 #include "sbma.h"
 
 
 /*****************************************************************************/
-/*  MP-Unsafe race:rw(ipc->s_mem,ipc->c_mem[ipc->id])                        */
-/*  MT-Unsafe race:rw(ipc->c_mem[ipc->id],ipc->maxpages)                     */
+/*  MP-Unsafe race:rw(ipc->s_mem,ipc->slot[ipc->id].c_mem,ipc->n_stat->memhw)*/
+/*  MT-Unsafe race:rw(ipc->slot[ipc->id].c_mem,ipc->maxpages)                */
 /*                                                                           */
 /*  Mitigation:                                                              */
-/*    1)  Call from within an IPC_INTER_CRITICAL_SECTION or call after       */
-/*        receiving SIGIPC from a process in an IPC_INTER_CRITICAL_SECTION.  */
+/*    1)  Call from within an IPC_INTER_CRITICAL_SECTION.                    */
 /*****************************************************************************/
 SBMA_EXTERN void
 ipc_atomic_inc(struct ipc * const ipc, size_t const value)
 {
+  uint64_t mem;
+
   ASSERT(*ipc->s_mem >= value);
 
   *ipc->s_mem -= value;
-  ipc->c_mem[ipc->id] += value;
+  ipc->slot[ipc->id].c_mem += value;
+
+  if (ipc->slot[ipc->id].c_mem > ipc->maxpages)
+    ipc->maxpages = ipc->slot[ipc->id].c_mem;
+  if (ipc->slot[ipc->id].c_mem > ipc->slot[ipc->id].w_mem)
+    ipc->slot[ipc->id].w_mem = ipc->slot[ipc->id].c_mem;
 
-  if (ipc->c_mem[ipc->id] > ipc->maxpages)
-    ipc->maxpages = ipc->c_mem[ipc->id];
+  /* The memory resident on the node is that which is not free. */
+  mem = (uint64_t)(*ipc->t_mem-*ipc->s_mem)*(uint64_t)sysconf(_SC_PAGESIZE);
+  if (NULL != ipc->n_stat && mem > ipc->n_stat->memhw)
+    ipc->n_stat->memhw = mem;
 }
 
 
@@ -48,38 +48,105 @@ ipc_destroy(struct ipc * const ipc)
   /* No need for intra critical section here because this should only be called
    * from the ``main'' process, never from threads. */
 
-  int ret;
+  int ret, last;
   char fname[FILENAME_MAX];
+  struct sbma_ticket * tkt;
+  struct ipc_rsv * rsv;
+
+  /* Fail any admission tickets which are still pending. */
+  while (NULL != (tkt=ipc->tkt_head)) {
+    ipc->tkt_head = tkt->next;
+    IPC_TICKET_DONE(tkt, -1);
+  }
+  ipc->tkt_tail = NULL;
+
+  /* Serialize joining and leaving. */
+  ret = libc_sem_wait(ipc->sid);
+  if (-1 == ret)
+    return -1;
+
+  /*=========================================================================*/
+  IPC_INTER_CRITICAL_SECTION_BEG(ipc);
+  /*=========================================================================*/
+
+  /* Return any credits still held in the local pool. */
+  (void)ipc_atomic_flush(ipc);
+
+  ipc->curpages = ipc->slot[ipc->id].c_mem;
 
-  ipc->curpages = ipc->c_mem[ipc->id];
+  /* Leave, returning any memory still charged to the process. */
+  ipc_mrelease(ipc, ipc->id);
+  last = (0 == *ipc->memb);
+
+  /*=========================================================================*/
+  IPC_INTER_CRITICAL_SECTION_END(ipc);
+  /*=========================================================================*/
+
+  /* The memory held for admitted tickets was returned with the rest of the
+   * memory of the process, so only the reservations remain to be freed. */
+  ipc->rsv_head = NULL;
+  ipc->rsv_tail = NULL;
+  ipc->rsv_free = NULL;
+  while (NULL != (rsv=ipc->rsv_pool)) {
+    ipc->rsv_pool = rsv->next;
+    ret = munmap(rsv, rsv->pages*sizeof(struct ipc_rsv));
+    if (-1 == ret)
+      goto ERRPOST;
+  }
 
   ret = pthread_mutex_destroy(&(ipc->intra_mtx));
   if (-1 == ret)
-    return -1;
+    goto ERRPOST;
 
-  ret = munmap((void*)ipc->shm, IPC_LEN(ipc->n_procs));
+  ret = pthread_mutex_destroy(&(ipc->mbox_mtx));
   if (-1 == ret)
-    return -1;
+    goto ERRPOST;
 
-  if (0 > snprintf(fname, FILENAME_MAX, "/ipc-shm-%d", ipc->uniq))
-    return -1;
-  ret = shm_unlink(fname);
-  if (-1 == ret && ENOENT != errno)
+  ret = pthread_mutex_destroy(&(ipc->tkt_mtx));
+  if (-1 == ret)
+    goto ERRPOST;
+
+  ipc->init   = 0;
+  ipc->n_stat = NULL;
+  ret = munmap((void*)ipc->shm, IPC_LEN(ipc->n_procs));
+  if (-1 == ret)
+    goto ERRPOST;
+
+  /* The last process to leave removes the shared state, before allowing any
+   * other process to join. */
+  if (1 == last) {
+    if (0 > snprintf(fname, FILENAME_MAX, "/ipc-shm-%d", ipc->uniq))
+      goto ERRPOST;
+    ret = shm_unlink(fname);
+    if (-1 == ret && ENOENT != errno)
+      goto ERRPOST;
+
+    #define X(NAME, ...)\
+      if (0 > snprintf(fname, FILENAME_MAX, "/ipc-" #NAME "-%d", ipc->uniq))\
+        goto ERRPOST;\
+      ret = sem_unlink(fname);\
+      if (-1 == ret && ENOENT != errno)\
+        goto ERRPOST;
+    LIST_OF_SEMAPHORES
+    #undef X
+  }
+
+  ret = sem_post(ipc->sid);
+  if (-1 == ret)
     return -1;
 
   #define X(NAME, ...)\
-    if (0 > snprintf(fname, FILENAME_MAX, "/ipc-" #NAME "-%d", ipc->uniq))\
-      return -1;\
     ret = sem_close(ipc->NAME);\
     if (-1 == ret)\
-      return -1;\
-    ret = sem_unlink(fname);\
-    if (-1 == ret && ENOENT != errno)\
       return -1;
   LIST_OF_SEMAPHORES
   #undef X
 
   return 0;
+
+  ERRPOST:
+  (void)sem_post(ipc->sid);
+  return -1;
 }
 
 
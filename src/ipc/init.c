@@ -31,10 +31,11 @@ THE SOFTWARE.
 #include <stdint.h>    /* uint8_t, uintptr_t */
 #include <stddef.h>    /* NULL, size_t, SIZE_MAX */
 #include <stdio.h>     /* FILENAME_MAX */
+#include <string.h>    /* memset */
 #include <sys/mman.h>  /* mmap */
 #include <sys/stat.h>  /* S_IRUSR, S_IWUSR */
 #include <sys/types.h> /* ftruncate */
-#include <unistd.h>    /* ftruncate */
+#include <unistd.h>    /* ftruncate, pwrite */
 #include "common.h"
 #include "ipc.h"
 #include "sbma.h"
@@ -44,6 +45,12 @@ THE SOFTWARE.
 /*  MP-Safe                                                                  */
 /*  MT-Invalid                                                               */
 /*                                                                           */
+/*  Note:                                                                    */
+/*    1)  The process joins by taking the first free one of n_procs slots,   */
+/*        after reclaiming the slots of any processes which died without     */
+/*        leaving. If every slot is held by a live process, -1 is returned   */
+/*        and errno is set to EAGAIN.                                        */
+/*                                                                           */
 /*  Mitigation:                                                              */
 /*    1)  This function MUST be called EXACTLY ONCE BEFORE any other ipc_*   */
 /*        function is called.                                                */
@@ -54,8 +61,7 @@ ipc_init(struct ipc * const ipc, int const uniq, int const n_procs,
 {
   int ret, shm_fd, id;
   void * shm;
-  sem_t * inter_mtx, * done, * sid, * sig;
-  int * idp;
+  sem_t * inter_mtx, * sid, * sig;
   char fname[FILENAME_MAX];
 
   /* initialize semaphores */
@@ -68,14 +74,26 @@ ipc_init(struct ipc * const ipc, int const uniq, int const n_procs,
   LIST_OF_SEMAPHORES
   #undef X
 
-  /* set up thread mutex */
+  /* set up thread mutexes */
   ret = pthread_mutex_init(&(ipc->intra_mtx), NULL);
   if (-1 == ret)
     return -1;
+  ret = pthread_mutex_init(&(ipc->mbox_mtx), NULL);
+  if (-1 == ret)
+    return -1;
+  ret = pthread_mutex_init(&(ipc->tkt_mtx), NULL);
+  if (-1 == ret)
+    return -1;
+  /* Serialize joining and leaving, so that the shared memory region is never
+   * initialized twice, nor removed while a process is joining. */
+  ret = libc_sem_wait(sid);
+  if (-1 == ret)
+    return -1;
+
   /* try to create a new shared memory region -- if i create, then i should
    * also truncate it, if i dont create, then try and just open it. */
   if (0 > snprintf(fname, FILENAME_MAX, "/ipc-shm-%d", uniq))
-    return -1;
+    goto ERRPOST;
 
   /* Set up shared memory region. */
   shm_fd = shm_open(fname, O_RDWR|O_CREAT|O_EXCL, S_IRUSR|S_IWUSR);
@@ -83,73 +101,114 @@ ipc_init(struct ipc * const ipc, int const uniq, int const n_procs,
     if (EEXIST == errno) {
       shm_fd = shm_open(fname, O_RDWR, S_IRUSR|S_IWUSR);
       if (-1 == shm_fd)
-        return -1;
+        goto ERRPOST;
     }
     else {
-      return -1;
+      goto ERRPOST;
     }
   }
   else {
     ret = ftruncate(shm_fd, IPC_LEN(n_procs));
     if (-1 == ret)
-      return -1;
+      goto ERRPOST;
 
     /* initialize system memory counter */
-    ret = write(shm_fd, &max_mem, sizeof(size_t));
+    ret = pwrite(shm_fd, &max_mem, sizeof(size_t), IPC_SMEM_OFF(n_procs));
     if (-1 == ret)
-      return -1;
+      goto ERRPOST;
+
+    /* initialize total memory counter */
+    ret = pwrite(shm_fd, &max_mem, sizeof(size_t), IPC_TMEM_OFF(n_procs));
+    if (-1 == ret)
+      goto ERRPOST;
   }
 
   /* Map the shared memory region into my address space. */
   shm = mmap(NULL, IPC_LEN(n_procs), PROT_READ|PROT_WRITE, MAP_SHARED,\
     shm_fd, 0);
   if (MAP_FAILED == shm)
-    return -1;
+    goto ERRPOST;
 
   /* Close the file descriptor. */
   ret = close(shm_fd);
   if (-1 == ret)
-    return -1;
-
-  /* Begin critical section. */
-  ret = sem_wait(sid);
-  if (-1 == ret)
-    return -1;
-
-  /* id pointer is last sizeof(int) bytes of shm */
-  idp = (int*)((uintptr_t)shm+sizeof(size_t)+\
-    (n_procs*(sizeof(int)+sizeof(size_t)+sizeof(size_t))));
-  id = (*idp)++;
-
-  /* End critical section. */
-  ret = sem_post(sid);
-  if (-1 == ret)
-    return -1;
-
-  /* Sanity check. */
-  ASSERT(id < n_procs);
+    goto ERRPOST;
 
   /* Setup ipc struct. */
-  ipc->id        = id;
+  ipc->id        = -1;
   ipc->n_procs   = n_procs;
   ipc->uniq      = uniq;
   ipc->curpages  = 0;
   ipc->maxpages  = 0;
+  ipc->credit    = 0;
+  ipc->chunk     = 0;
+  ipc->evict     = NULL;
+  ipc->tkt_head  = NULL;
+  ipc->tkt_tail  = NULL;
+  ipc->rsv_head  = NULL;
+  ipc->rsv_tail  = NULL;
+  ipc->rsv_free  = NULL;
+  ipc->rsv_pool  = NULL;
   ipc->shm       = shm;
   ipc->inter_mtx = inter_mtx;
-  ipc->done      = done;
   ipc->sid       = sid;
   ipc->sig       = sig;
-  ipc->s_mem     = (size_t*)shm;
-  ipc->c_mem     = (size_t*)((uintptr_t)ipc->s_mem+sizeof(size_t));
-  ipc->d_mem     = (size_t*)((uintptr_t)ipc->c_mem+(n_procs*sizeof(size_t)));
-  ipc->pid       = (int*)((uintptr_t)ipc->d_mem+(n_procs*sizeof(size_t)));
-  ipc->flags     = (uint8_t*)((uintptr_t)idp+sizeof(int));
+  ipc->memb      = (int*)((uintptr_t)shm+IPC_MEMB_OFF(n_procs));
+  ipc->gang      = (int*)((uintptr_t)shm+IPC_GANG_OFF(n_procs));
+  ipc->g_tkt     = (size_t*)((uintptr_t)shm+IPC_GTKT_OFF(n_procs));
+  ipc->s_mem     = (size_t*)((uintptr_t)shm+IPC_SMEM_OFF(n_procs));
+  ipc->t_mem     = (size_t*)((uintptr_t)shm+IPC_TMEM_OFF(n_procs));
+  ipc->l_mem     = (size_t*)((uintptr_t)shm+IPC_LMEM_OFF(n_procs));
+  ipc->slot      = (struct ipc_slot*)((uintptr_t)shm+IPC_SLOT_OFF(n_procs));
+  ipc->mbox      = (struct ipc_mbox*)((uintptr_t)shm+IPC_MBOX_OFF(n_procs));
+  ipc->n_stat    = (struct sbma_stats*)((uintptr_t)shm+IPC_STAT_OFF(n_procs));
+  memset((void*)&(ipc->stat), 0, sizeof(ipc->stat));
+
+  /*=========================================================================*/
+  IPC_INTER_CRITICAL_SECTION_BEG(ipc);
+  /*=========================================================================*/
+
+  /* Reclaim the slots of processes which died without leaving, then take
+   * the first free slot. */
+  (void)ipc_mreap(ipc);
+  for (id=0; id<n_procs && 0!=ipc->slot[id].pid; ++id);
+
+  if (id < n_procs) {
+    /* Set my process id and my default policy -- no guaranteed resident
+     * memory and unit priority. */
+    ipc->slot[id].pid   = (int)getpid();
+    ipc->slot[id].quota = 0;
+    ipc->slot[id].p_mem = 0;
+    ipc->slot[id].r_mem = 0;
+    ipc->slot[id].prio  = 1;
+    (*ipc->memb)++;
+  }
+
+  /*=========================================================================*/
+  IPC_INTER_CRITICAL_SECTION_END(ipc);
+  /*=========================================================================*/
 
-  /* Set my process id. */
-  ipc->pid[id] = (int)getpid();
+  /* End critical section. */
+  ret = sem_post(sid);
+  if (-1 == ret)
+    return -1;
+
+  /* All slots are taken by live processes. */
+  if (id == n_procs) {
+    ipc->n_stat = NULL;
+    (void)munmap(shm, IPC_LEN(n_procs));
+    errno = EAGAIN;
+    return -1;
+  }
+
+  ipc->id   = id;
+  ipc->init = 1;
 
   return 0;
+
+  ERRPOST:
+  (void)sem_post(sid);
+  return -1;
 }
 
 
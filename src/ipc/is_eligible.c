@@ -31,28 +31,20 @@ THE SOFTWARE.
 
 
 /*****************************************************************************/
-/*  MP-Unsafe race:rd(ipc->c_mem[id],ipc->flags[id])                         */
-/*  MT-Unsafe race:rd(ipc->c_mem[id],ipc->flags[id])                         */
+/*  MP-Unsafe race:rd(ipc->slot[id].c_mem,ipc->slot[id].quota,...)           */
+/*  MT-Unsafe race:rd(ipc->slot[id].c_mem,ipc->slot[id].quota,...)           */
 /*                                                                           */
 /*  Mitigation:                                                              */
-/*    1)  Call from within an IPC_INTER_CRITICAL_SECTION or call after       */
-/*        receiving SIGIPC from a process in an IPC_INTER_CRITICAL_SECTION.  */
+/*    1)  Call from within an IPC_INTER_CRITICAL_SECTION.                    */
 /*****************************************************************************/
 SBMA_EXTERN int
 ipc_is_eligible(struct ipc * const ipc, int const id)
 {
-  int eligible;
-
-  /* Default to ineligible. */
-  eligible = 0;
-
-  /* Check if anything memory is resident. */
-  eligible |= ipc->c_mem[id];
-
-  /* Check if process has enabled signaling. */
-  eligible |= (ipc->flags[id]&IPC_SIGON);
-
-  return eligible;
+  /* Only a process with resident memory beyond its quota and its pinned
+   * memory can release any.
+   * Every process has an eviction thread to serve requests, so whether or not
+   * it has enabled signaling is only a preference, see ipc_mvictim(). */
+  return (ipc->slot[id].c_mem > IPC_FLOOR(ipc->slot[id]));
 }
 
 
@@ -26,29 +26,86 @@ THE SOFTWARE.
 #endif
 
 
-#include <signal.h> /* kill */
-#include <stddef.h> /* size_t, SIZE_MAX */
+#include <stddef.h>    /* size_t */
+#include <sys/types.h> /* ssize_t */
+#include <time.h>      /* struct timespec */
 #include "common.h"
 #include "ipc.h"
 #include "sbma.h"
 
 
 /*****************************************************************************/
-/*  MP-Unsafe race:rd(ipc->d_mem[ipc->id])                                   */
-/*  MT-Unsafe race:rd(ipc->d_mem[ipc->id])                                   */
+/*  Return the memory held for admitted tickets, up to max pages, and if     */
+/*  take is non-zero, use it, oldest reservation first.                      */
+/*                                                                           */
+/*  MT-Unsafe race:rw(ipc->rsv_head,ipc->rsv_tail,ipc->rsv_free)             */
+/*                                                                           */
+/*  Mitigation:                                                              */
+/*    1)  Call only from within an intra-process critical section.           */
+/*****************************************************************************/
+SBMA_STATIC size_t
+ipc_rsv_use(struct ipc * const ipc, size_t const max, int const take)
+{
+  size_t held, pages;
+  struct ipc_rsv * rsv;
+
+  held = 0;
+  rsv  = ipc->rsv_head;
+  while (held < max && NULL != rsv) {
+    pages = (rsv->pages < max-held) ? rsv->pages : max-held;
+    held += pages;
+
+    if (0 == take) {
+      rsv = rsv->next;
+      continue;
+    }
+
+    rsv->pages -= pages;
+    (void)__sync_fetch_and_sub(&(ipc->slot[ipc->id].r_mem), pages);
+
+    if (0 == rsv->pages) {
+      ipc->rsv_head = rsv->next;
+      if (NULL == ipc->rsv_head)
+        ipc->rsv_tail = NULL;
+      rsv->next     = ipc->rsv_free;
+      ipc->rsv_free = rsv;
+    }
+    rsv = ipc->rsv_head;
+  }
+
+  return held;
+}
+
+
+/*****************************************************************************/
+/*  MP-Unsafe race:rd(ipc->slot[ipc->id].d_mem)                              */
+/*  MT-Unsafe race:rd(ipc->slot[ipc->id].d_mem)                              */
+/*                                                                           */
+/*  Note:                                                                    */
+/*    1)  When ipc->chunk is non-zero, the request is first served from the  */
+/*        process's credit pool. Only the remainder is admitted from the     */
+/*        system, and the pool is then topped up by up to ipc->chunk pages   */
+/*        of memory which is already free -- no process is ever evicted to   */
+/*        fill the pool. Memory held for admitted asynchronous admission     */
+/*        tickets, see ipc_mgrant(), is used first, whatever ipc->chunk is,  */
+/*        but only once the remainder has been admitted, so that it is never */
+/*        moved to the pool, and thus flushed, when the request fails.       */
+/*    2)  While waiting for memory, the process serves the eviction requests */
+/*        made to it. If doing so releases any of its memory, -2 is returned */
+/*        so that the caller can re-compute the size of its request.         */
 /*                                                                           */
 /*  Mitigation:                                                              */
-/*    1)  Function is designed such that if a stale ipc->d_mem[ipc->id]      */
+/*    1)  Function is designed such that if a stale ipc->slot[ipc->id].d_mem */
 /*        value is read, then resulting execution will still be correct.     */
 /*        Only performance will be impacted, likely negatively.              */
 /*****************************************************************************/
 SBMA_EXTERN int
-ipc_madmit(struct ipc * const ipc, size_t const value, int const admitd)
+ipc_madmit(struct ipc * const ipc, size_t const value, int const admit)
 {
-  int retval, ret, i, ii, id, n_procs;
-  size_t mx_c_mem, mx_d_mem, s_mem;
-  int * pid;
-  volatile size_t * c_mem, * d_mem;
+  int retval, id, event;
+  size_t s_mem, need, extra, r_take, c_take;
+  ssize_t ret;
+  struct timespec ts, tmr;
 
   /* Default return value is success. */
   retval = 0;
@@ -57,86 +114,159 @@ ipc_madmit(struct ipc * const ipc, size_t const value, int const admitd)
   if (0 == value)
     goto RETURN;
 
-  id      = ipc->id;
-  n_procs = ipc->n_procs;
-  c_mem   = ipc->c_mem;
-  d_mem   = ipc->d_mem;
-  pid     = ipc->pid;
+  /* Serve as much of the request as possible from the memory held for
+   * admitted tickets, and then from the credit pool. */
+  need   = value;
+  r_take = 0;
+  c_take = 0;
+  if (0 != ipc->chunk || 0 != ipc->credit || NULL != ipc->rsv_head) {
+    /*=======================================================================*/
+    IPC_INTRA_CRITICAL_SECTION_BEG(ipc);
+    /*=======================================================================*/
 
-  /*=========================================================================*/
-  IPC_INTER_CRITICAL_SECTION_BEG(ipc);
-  /*=========================================================================*/
+    r_take = ipc_rsv_use(ipc, need, 0);
+    need  -= r_take;
 
-  s_mem = *ipc->s_mem;
-  while (s_mem < value) {
-    ii       = -1;
-    mx_c_mem = 0;
-    mx_d_mem = SIZE_MAX;
-
-    /* Find a candidate process to release memory. */
-    for (i=0; i<n_procs; ++i) {
-      /* Skip oneself. */
-      if (i == id) {
-        continue;
-      }
-      /* Skip process which are ineligible. */
-      else if (!ipc_is_eligible(ipc, i)) {
-        continue;
-      }
+    c_take = (ipc->credit < need) ? ipc->credit : need;
+    ipc->credit -= c_take;
+    need        -= c_take;
 
-      /*
-       *  Choose the process to evict as follows:
-       *    1) If no candidate process has resident memory greater than the
-       *       requested memory, then choose the candidate which has the most
-       *       resident memory.
-       *    2) If some candidate process(es) have resident memory greater than
-       *       the requested memory, then:
-       *       2.1) If VMM_ADMITD != admitd, then choose from these, the
-       *            candidate which has the least resident memory.
-       *       2.2) If VMM_ADMITD == admitd, then choose from these, the
-       *            candidate which has the least dirty memory.
-       */
-      if ((mx_c_mem < value-s_mem && c_mem[i] > mx_c_mem) ||\
-          (c_mem[i] >= value-s_mem &&\
-            ((VMM_ADMITD != admitd && c_mem[i] < mx_c_mem) ||\
-             (VMM_ADMITD == admitd && d_mem[i] < mx_d_mem))))
-      {
-        ii = i;
-        mx_c_mem = c_mem[i];
-        mx_d_mem = d_mem[i];
-      }
-    }
+    if (0 == need)
+      (void)ipc_rsv_use(ipc, r_take, 1);
 
-    /* No valid candidate process exists, retry loop in case a stale value was
-     * read. */
-    if (-1 == ii) {
-      continue;
-    }
+    /*=======================================================================*/
+    IPC_INTRA_CRITICAL_SECTION_END(ipc);
+    /*=======================================================================*/
+
+    if (0 == need)
+      goto RETURN;
+  }
+
+  id = ipc->id;
 
-    /* Tell the chosen candidate process to free memory. */
-    ret = kill(pid[ii], SIGIPC);
+  /* The rest of the request is admitted from the system, possibly after
+   * waiting for other processes to release memory. */
+  TIMER_START(&(tmr));
+
+  for (;;) {
+    /*=======================================================================*/
+    IPC_INTER_CRITICAL_SECTION_BEG(ipc);
+    /*=======================================================================*/
+
+    /* Stop waiting once the system can support the request, counting the
+     * memory of any processes which died without leaving. The critical
+     * section is left below, after the memory has been admitted. */
+    s_mem = *ipc->s_mem;
+    if (s_mem < need && 0 != ipc_mreap(ipc))
+      s_mem = *ipc->s_mem;
+    if (s_mem >= need)
+      break;
+
+    /* Ask the processes which are to release memory. With the gang
+     * co-scheduler, only processes in the gang may ask. */
+    if (0 == *ipc->gang || 1 == ipc_mgang(ipc))
+      (void)ipc_mplan(ipc, need-s_mem, need, admit, 0);
+
+    /* Cache the event counter before leaving the critical section, so that
+     * a wake-up which happens before the wait is not missed. */
+    event = ipc->mbox[id].event;
+
+    /*=======================================================================*/
+    IPC_INTER_CRITICAL_SECTION_END(ipc);
+    /*=======================================================================*/
+
+    /* Serve any requests made to this process while it waits, so that two
+     * processes waiting for each other cannot deadlock. */
+    ret = ipc_mserve(ipc, 0);
+    if (0 != ret && 0 != c_take) {
+      /* Return the memory which was taken from the pool. The memory held
+       * for tickets has not been used yet. */
+      /*=====================================================================*/
+      IPC_INTRA_CRITICAL_SECTION_BEG(ipc);
+      /*=====================================================================*/
+
+      ipc->credit += c_take;
+
+      /*=====================================================================*/
+      IPC_INTRA_CRITICAL_SECTION_END(ipc);
+      /*=====================================================================*/
+    }
     if (-1 == ret) {
       goto ERREXIT;
     }
+    else if (0 != ret) {
+      /* Some of this process's memory was released, so the request must be
+       * re-computed. */
 
-    /* Wait for it to signal it has finished. */
-    ret = sem_wait(ipc->done);
-    if (-1 == ret) {
-      goto ERREXIT;
+      /* Leave the gang queue, since the request may not be made again. */
+      if (IPC_GANG_WAIT == ipc->slot[id].gang) {
+        /*===================================================================*/
+        IPC_INTER_CRITICAL_SECTION_BEG(ipc);
+        /*===================================================================*/
+
+        if (IPC_GANG_WAIT == ipc->slot[id].gang)
+          ipc->slot[id].gang = IPC_GANG_NONE;
+
+        /*===================================================================*/
+        IPC_INTER_CRITICAL_SECTION_END(ipc);
+        /*===================================================================*/
+      }
+
+      TIMER_STOP(&(tmr));
+      IPC_TRACK(ipc, tmrad, IPC_TO_NSEC(&(tmr)));
+
+      retval = -2;
+      goto RETURN;
     }
 
-    /* Re-cache system memory value. */
-    s_mem = *ipc->s_mem;
+    /* Wait for one of the requests to be served, or time out in case memory
+     * was released without this process being told, e.g., by a free. */
+    ts.tv_sec  = 0;
+    ts.tv_nsec = IPC_WAIT_NSEC;
+    IPC_MBOX_WAIT(&(ipc->mbox[id]), event, &ts);
   }
 
-  ASSERT(s_mem >= value);
+  ASSERT(s_mem >= need);
+
+  /* Leave the gang queue, if the memory became free while waiting. */
+  if (IPC_GANG_WAIT == ipc->slot[id].gang)
+    ipc->slot[id].gang = IPC_GANG_NONE;
 
-  ipc_atomic_inc(ipc, value);
+  /* Top up the credit pool with memory that is already free. */
+  extra = 0;
+  if (0 != ipc->chunk)
+    extra = (s_mem-need < ipc->chunk) ? s_mem-need : ipc->chunk;
+
+  ipc_atomic_inc(ipc, need+extra);
 
   /*=========================================================================*/
   IPC_INTER_CRITICAL_SECTION_END(ipc);
   /*=========================================================================*/
 
+  /*=========================================================================*/
+  IPC_INTRA_CRITICAL_SECTION_BEG(ipc);
+  /*=========================================================================*/
+
+  /* Use the memory held for tickets now that the rest has been admitted. If
+   * some of it was revoked in the meantime, the request cannot be completed,
+   * so the memory admitted for it is moved to the pool, and the request must
+   * be re-computed. */
+  if (r_take == ipc_rsv_use(ipc, r_take, 0)) {
+    (void)ipc_rsv_use(ipc, r_take, 1);
+    ipc->credit += extra;
+  }
+  else {
+    ipc->credit += c_take+need+extra;
+    retval = -2;
+  }
+
+  /*=========================================================================*/
+  IPC_INTRA_CRITICAL_SECTION_END(ipc);
+  /*=========================================================================*/
+
+  TIMER_STOP(&(tmr));
+  IPC_TRACK(ipc, tmrad, IPC_TO_NSEC(&(tmr)));
+
   goto RETURN;
 
   ERREXIT:
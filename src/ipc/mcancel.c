@@ -0,0 +1,86 @@
+/*
+Copyright (c) 2015,2016 Jeremy Iverson
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+
+#ifndef _GNU_SOURCE
+# define _GNU_SOURCE 1
+#endif
+
+
+#include <pthread.h> /* pthread_mutex_lock, pthread_mutex_unlock */
+#include <stddef.h>  /* NULL */
+#include "common.h"
+#include "ipc.h"
+#include "sbma.h"
+
+
+/*****************************************************************************/
+/*  MP-Safe                                                                  */
+/*  MT-Safe                                                                  */
+/*                                                                           */
+/*  Note:                                                                    */
+/*    1)  A ticket which is not found has either been admitted, or is being  */
+/*        completed by ipc_mgrant(), so its status is about to change.       */
+/*****************************************************************************/
+SBMA_EXTERN int
+ipc_mcancel(struct ipc * const ipc, struct sbma_ticket * const tkt)
+{
+  int ret, retval;
+  struct sbma_ticket * prev, * cur;
+
+  ret = pthread_mutex_lock(&(ipc->tkt_mtx));
+  if (0 != ret)
+    return -1;
+
+  for (prev=NULL,cur=ipc->tkt_head; NULL!=cur&&tkt!=cur; cur=cur->next)
+    prev = cur;
+
+  if (NULL == cur) {
+    retval = -1;
+  }
+  else {
+    if (NULL == prev)
+      ipc->tkt_head = cur->next;
+    else
+      prev->next = cur->next;
+    if (ipc->tkt_tail == cur)
+      ipc->tkt_tail = prev;
+    retval = 0;
+  }
+
+  ret = pthread_mutex_unlock(&(ipc->tkt_mtx));
+  if (0 != ret)
+    return -1;
+
+  return retval;
+}
+
+
+#ifdef TEST
+int
+main(int argc, char * argv[])
+{
+  if (0 == argc || NULL == argv) {}
+
+  return 0;
+}
+#endif
@@ -33,17 +33,18 @@ THE SOFTWARE.
 
 
 /*****************************************************************************/
-/*  MP-Unsafe race:wr(ipc->d_mem[ipc->id])                                   */
+/*  MP-Unsafe race:wr(ipc->slot[ipc->id].d_mem)                              */
 /*  MT-Safe                                                                  */
 /*                                                                           */
 /*  Note:                                                                    */ 
 /*    1)  Only other threads from this process will ever modify              */
-/*        ipc->d_mem[ipc->id], so the IPC_INTRA_CRICITAL_SECTION is          */
+/*        ipc->slot[ipc->id].d_mem, so the IPC_INTRA_CRICITAL_SECTION is     */
 /*        sufficient to make that variable MT-Safe.                          */
 /*                                                                           */
 /*  Mitigation:                                                              */
-/*    1)  Functions that READ ipc->d_mem[ipc->id] from a different process   */
-/*        SHOULD be aware of the possibility of reading a stale value.       */
+/*    1)  Functions that READ ipc->slot[ipc->id].d_mem from a different      */
+/*        process SHOULD be aware of the possibility of reading a stale      */
+/*        value.                                                             */
 /*****************************************************************************/
 SBMA_EXTERN int
 ipc_mdirty(struct ipc * const ipc, ssize_t const value)
@@ -56,10 +57,10 @@ ipc_mdirty(struct ipc * const ipc, ssize_t const value)
   /*=========================================================================*/
 
   if (value < 0) {
-    ASSERT(ipc->d_mem[ipc->id] >= (size_t)(-value));
+    ASSERT(ipc->slot[ipc->id].d_mem >= (size_t)(-value));
   }
 
-  ipc->d_mem[ipc->id] += value;
+  ipc->slot[ipc->id].d_mem += value;
 
   /*=========================================================================*/
   IPC_INTRA_CRITICAL_SECTION_END(ipc);
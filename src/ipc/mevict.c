@@ -34,18 +34,54 @@ THE SOFTWARE.
 /*****************************************************************************/
 /*  MP-Safe                                                                  */
 /*  MT-Safe                                                                  */
+/*                                                                           */
+/*  Note:                                                                    */
+/*    1)  When ipc->chunk is non-zero, released pages are kept in the        */
+/*        process's credit pool and only the surplus beyond ipc->chunk pages */
+/*        is returned to the system.                                         */
 /*****************************************************************************/
 SBMA_EXTERN int
 ipc_mevict(struct ipc * const ipc, size_t const c_pages, size_t const d_pages)
 {
+  size_t surplus;
+
   if (0 == c_pages && 0 == d_pages)
     return 0;
 
+  if (0 == ipc->chunk) {
+    surplus = c_pages;
+  }
+  else {
+    /*=======================================================================*/
+    IPC_INTRA_CRITICAL_SECTION_BEG(ipc);
+    /*=======================================================================*/
+
+    ipc->credit += c_pages;
+    if (ipc->credit > ipc->chunk) {
+      surplus = ipc->credit-ipc->chunk;
+      ipc->credit = ipc->chunk;
+    }
+    else {
+      surplus = 0;
+    }
+
+    /*=======================================================================*/
+    IPC_INTRA_CRITICAL_SECTION_END(ipc);
+    /*=======================================================================*/
+
+    /* Nothing is being returned to the system, so only the local dirty
+     * accounting needs to change. */
+    if (0 == surplus) {
+      ipc_atomic_dec(ipc, 0, d_pages);
+      return 0;
+    }
+  }
+
   /*=========================================================================*/
   IPC_INTER_CRITICAL_SECTION_BEG(ipc);
   /*=========================================================================*/
 
-  ipc_atomic_dec(ipc, c_pages, d_pages);
+  ipc_atomic_dec(ipc, surplus, d_pages);
 
   /*=========================================================================*/
   IPC_INTER_CRITICAL_SECTION_END(ipc);
@@ -0,0 +1,167 @@
+/*
+Copyright (c) 2015,2016 Jeremy Iverson
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+
+#ifndef _GNU_SOURCE
+# define _GNU_SOURCE 1
+#endif
+
+
+#include <stddef.h> /* size_t */
+#include <stdint.h> /* uint64_t */
+#include <time.h>   /* CLOCK_MONOTONIC, struct timespec, clock_gettime */
+#include "common.h"
+#include "ipc.h"
+#include "sbma.h"
+
+
+/*****************************************************************************/
+/*  Compute the number of processes allowed to hold a place in the gang. If  */
+/*  the gang size is automatic, as many processes are allowed as the memory  */
+/*  can hold the mean observed working set of.                               */
+/*                                                                           */
+/*  MP-Unsafe race:rd(ipc->slot,ipc->gang)                                   */
+/*  MT-Safe                                                                  */
+/*                                                                           */
+/*  Mitigation:                                                              */
+/*    1)  Call from within an IPC_INTER_CRITICAL_SECTION.                    */
+/*****************************************************************************/
+SBMA_STATIC int
+ipc_mgang_size(struct ipc * const ipc)
+{
+  int i, n_obs;
+  size_t w_mem;
+
+  if (0 < *ipc->gang)
+    return *ipc->gang;
+
+  for (n_obs=0,w_mem=0,i=0; i<ipc->n_procs; ++i) {
+    if (0 != ipc->slot[i].pid && 0 != ipc->slot[i].w_mem) {
+      w_mem += ipc->slot[i].w_mem;
+      n_obs++;
+    }
+  }
+
+  /* Without any observations, the gang is not limited. */
+  if (0 == n_obs || 0 == w_mem)
+    return ipc->n_procs;
+
+  w_mem /= n_obs;
+
+  return (*ipc->t_mem < w_mem) ? 1 : (int)(*ipc->t_mem/w_mem);
+}
+
+
+/*****************************************************************************/
+/*  MP-Unsafe race:rw(ipc->slot,ipc->g_tkt)                                  */
+/*  MT-Safe                                                                  */
+/*                                                                           */
+/*  Note:                                                                    */
+/*    1)  Only processes in the gang compete for memory, i.e., ask others to */
+/*        release memory, so that the working sets of the processes outside  */
+/*        the gang are not all evicted at once. Returns 1 if the calling     */
+/*        process holds a place in the gang, and 0 if it must wait.          */
+/*    2)  Places are given out in the order in which processes start to      */
+/*        wait. Once the first waiting process has waited IPC_GANG_NSEC, the */
+/*        process which has held its place the longest, and for at least     */
+/*        IPC_GANG_NSEC, gives it up, so that processes run in rotating      */
+/*        waves.                                                             */
+/*                                                                           */
+/*  Mitigation:                                                              */
+/*    1)  Call from within an IPC_INTER_CRITICAL_SECTION.                    */
+/*****************************************************************************/
+SBMA_EXTERN int
+ipc_mgang(struct ipc * const ipc)
+{
+  int i, id, hh, first, n_hold;
+  uint64_t now;
+  struct timespec ts;
+  volatile struct ipc_slot * slot;
+
+  id   = ipc->id;
+  slot = ipc->slot;
+
+  if (IPC_GANG_HOLD == slot[id].gang)
+    return 1;
+
+  (void)clock_gettime(CLOCK_MONOTONIC, &ts);
+  now = (uint64_t)ts.tv_sec*1000000000lu+(uint64_t)ts.tv_nsec;
+
+  /* Join the queue. */
+  if (IPC_GANG_WAIT != slot[id].gang) {
+    slot[id].gang   = IPC_GANG_WAIT;
+    slot[id].ticket = (*ipc->g_tkt)++;
+    slot[id].g_ns   = now;
+  }
+
+  /* Count the holders, find the holder which has held its place the longest,
+   * and check whether the calling process is first in the queue. */
+  n_hold = 0;
+  hh     = -1;
+  first  = 1;
+  for (i=0; i<ipc->n_procs; ++i) {
+    if (0 == slot[i].pid) {
+      continue;
+    }
+    else if (IPC_GANG_HOLD == slot[i].gang) {
+      n_hold++;
+      if (-1 == hh || slot[i].g_ns < slot[hh].g_ns)
+        hh = i;
+    }
+    else if (IPC_GANG_WAIT == slot[i].gang && slot[i].ticket < slot[id].ticket)
+    {
+      first = 0;
+    }
+  }
+
+  if (0 == first)
+    return 0;
+
+  /* Take over the place of the longest holder, if both it and the calling
+   * process have waited long enough. Its memory is then released as that of
+   * any process outside the gang. */
+  if (n_hold >= ipc_mgang_size(ipc)) {
+    if (-1 == hh || now-slot[id].g_ns < IPC_GANG_NSEC ||\
+        now-slot[hh].g_ns < IPC_GANG_NSEC)
+    {
+      return 0;
+    }
+    slot[hh].gang = IPC_GANG_NONE;
+  }
+
+  slot[id].gang  = IPC_GANG_HOLD;
+  slot[id].g_ns  = now;
+  slot[id].w_mem = slot[id].c_mem;
+
+  return 1;
+}
+
+
+#ifdef TEST
+int
+main(int argc, char * argv[])
+{
+  if (0 == argc || NULL == argv) {}
+
+  return 0;
+}
+#endif
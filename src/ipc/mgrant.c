@@ -0,0 +1,216 @@
+/*
+Copyright (c) 2015,2016 Jeremy Iverson
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+
+#ifndef _GNU_SOURCE
+# define _GNU_SOURCE 1
+#endif
+
+
+#include <pthread.h>  /* pthread_mutex_lock, pthread_mutex_unlock */
+#include <stddef.h>   /* NULL, size_t */
+#include <sys/mman.h> /* mmap */
+#include <unistd.h>   /* sysconf */
+#include "common.h"
+#include "ipc.h"
+#include "sbma.h"
+
+
+/*****************************************************************************/
+/*  Take an unused reservation, mapping a page of them if there is none. The */
+/*  first reservation of each page is not used, but links the pages, so that */
+/*  they can be unmapped by ipc_destroy().                                   */
+/*                                                                           */
+/*  MT-Unsafe race:rw(ipc->rsv_free,ipc->rsv_pool)                           */
+/*                                                                           */
+/*  Mitigation:                                                              */
+/*    1)  Call from within an IPC_INTRA_CRITICAL_SECTION.                    */
+/*****************************************************************************/
+SBMA_STATIC struct ipc_rsv *
+ipc_rsv_get(struct ipc * const ipc)
+{
+  size_t i, num;
+  struct ipc_rsv * rsv;
+
+  if (NULL == ipc->rsv_free) {
+    num = (size_t)sysconf(_SC_PAGESIZE)/sizeof(struct ipc_rsv);
+    rsv = mmap(NULL, num*sizeof(struct ipc_rsv), PROT_READ|PROT_WRITE,\
+      MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+    if (MAP_FAILED == rsv)
+      return NULL;
+
+    rsv[0].pages  = num;
+    rsv[0].next   = ipc->rsv_pool;
+    ipc->rsv_pool = rsv;
+    for (i=1; i<num; ++i) {
+      rsv[i].next   = ipc->rsv_free;
+      ipc->rsv_free = &(rsv[i]);
+    }
+  }
+
+  rsv = ipc->rsv_free;
+  ipc->rsv_free = rsv->next;
+
+  return rsv;
+}
+
+
+/*****************************************************************************/
+/*  MP-Safe                                                                  */
+/*  MT-Safe                                                                  */
+/*                                                                           */
+/*  Note:                                                                    */
+/*    1)  Admitted memory is held for the ticket, and the next admissions of */
+/*        the process are served from it, see ipc_madmit(). Unlike credits,  */
+/*        it is not returned to the system when the process is asked to      */
+/*        release memory, see ipc_mserve(), but only once it is used or the  */
+/*        ticket is canceled, see ipc_mrevoke().                             */
+/*    2)  Tickets are admitted in the order in which they were queued. A     */
+/*        ticket for more memory than is shared by all processes fails.      */
+/*    3)  Tickets are completed outside of the critical sections, so that    */
+/*        their callbacks may queue new tickets.                             */
+/*****************************************************************************/
+SBMA_EXTERN int
+ipc_mgrant(struct ipc * const ipc, int const admit)
+{
+  int ret, retval, status;
+  size_t s_mem, need;
+  struct sbma_ticket * tkt, * head, * tail;
+  struct ipc_rsv * rsv;
+
+  /* Shortcut if there are no tickets. */
+  if (NULL == ipc->tkt_head)
+    return 0;
+
+  head = NULL;
+  tail = NULL;
+
+  ret = pthread_mutex_lock(&(ipc->tkt_mtx));
+  if (0 != ret)
+    return -1;
+
+  while (NULL != (tkt=ipc->tkt_head)) {
+    need = tkt->pages;
+
+    /*=======================================================================*/
+    IPC_INTER_CRITICAL_SECTION_BEG(ipc);
+    /*=======================================================================*/
+
+    s_mem = *ipc->s_mem;
+    if (s_mem < need && 0 != ipc_mreap(ipc))
+      s_mem = *ipc->s_mem;
+
+    if (need > *ipc->t_mem) {
+      status = -1;
+    }
+    else if (s_mem >= need) {
+      /* Leave the gang queue, if the memory became free while waiting. */
+      if (IPC_GANG_WAIT == ipc->slot[ipc->id].gang)
+        ipc->slot[ipc->id].gang = IPC_GANG_NONE;
+
+      /*=====================================================================*/
+      IPC_INTRA_CRITICAL_SECTION_BEG(ipc);
+      /*=====================================================================*/
+
+      rsv = ipc_rsv_get(ipc);
+      if (NULL != rsv) {
+        rsv->pages = need;
+        rsv->tkt   = tkt;
+        rsv->next  = NULL;
+        if (NULL == ipc->rsv_tail)
+          ipc->rsv_head = rsv;
+        else
+          ipc->rsv_tail->next = rsv;
+        ipc->rsv_tail = rsv;
+      }
+
+      /*=====================================================================*/
+      IPC_INTRA_CRITICAL_SECTION_END(ipc);
+      /*=====================================================================*/
+
+      if (NULL == rsv) {
+        status = -1;
+      }
+      else {
+        status = 0;
+
+        ipc_atomic_inc(ipc, need);
+        (void)__sync_fetch_and_add(&(ipc->slot[ipc->id].r_mem), need);
+      }
+    }
+    else {
+      status = 1;
+
+      /* Ask the processes which are to release memory. With the gang
+       * co-scheduler, only processes in the gang may ask. */
+      if (0 == *ipc->gang || 1 == ipc_mgang(ipc))
+        (void)ipc_mplan(ipc, need-s_mem, need, admit, 0);
+    }
+
+    /*=======================================================================*/
+    IPC_INTER_CRITICAL_SECTION_END(ipc);
+    /*=======================================================================*/
+
+    if (1 == status)
+      break;
+
+    /* Move the ticket to the list of completed tickets, marking a failed
+     * ticket by clearing its pages, since no ticket is queued for none. */
+    ipc->tkt_head = tkt->next;
+    if (NULL == ipc->tkt_head)
+      ipc->tkt_tail = NULL;
+
+    tkt->next = NULL;
+    if (-1 == status)
+      tkt->pages = 0;
+    if (NULL == tail)
+      head = tkt;
+    else
+      tail->next = tkt;
+    tail = tkt;
+  }
+
+  retval = (NULL != ipc->tkt_head);
+
+  ret = pthread_mutex_unlock(&(ipc->tkt_mtx));
+  if (0 != ret)
+    retval = -1;
+
+  /* Complete the tickets which were admitted or failed. */
+  while (NULL != (tkt=head)) {
+    head = tkt->next;
+    IPC_TICKET_DONE(tkt, (0 == tkt->pages) ? -1 : 0);
+  }
+
+  return retval;
+}
+
+
+#ifdef TEST
+int
+main(int argc, char * argv[])
+{
+  if (0 == argc || NULL == argv) {}
+
+  return 0;
+}
+#endif
@@ -0,0 +1,285 @@
+/*
+Copyright (c) 2015,2016 Jeremy Iverson
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+
+#ifndef _GNU_SOURCE
+# define _GNU_SOURCE 1
+#endif
+
+
+#include <stddef.h> /* size_t, SIZE_MAX */
+#include <stdint.h> /* uint8_t */
+#include "common.h"
+#include "ipc.h"
+#include "sbma.h"
+
+
+/*****************************************************************************/
+/*  Check whether the request ring of process ii holds a request from the    */
+/*  calling process.                                                         */
+/*                                                                           */
+/*  MP-Unsafe race:rd(ipc->mbox[ii])                                         */
+/*  MT-Safe                                                                  */
+/*                                                                           */
+/*  Mitigation:                                                              */
+/*    1)  Call from within an IPC_INTER_CRITICAL_SECTION.                    */
+/*****************************************************************************/
+SBMA_STATIC int
+ipc_mbox_has(struct ipc * const ipc, int const ii)
+{
+  int i;
+  volatile struct ipc_mbox * mbox;
+
+  mbox = &(ipc->mbox[ii]);
+  for (i=0; i<mbox->count; ++i) {
+    if (ipc->id == mbox->req[(mbox->head+i)%IPC_MBOX_LEN])
+      return 1;
+  }
+
+  return 0;
+}
+
+
+/*****************************************************************************/
+/*  Choose the next process to release memory, given that deficit more pages */
+/*  must still be released for a request of need pages. Processes which have */
+/*  already been asked by the calling process are not considered. Returns -1 */
+/*  if there is no candidate. If any is non-zero, the request is made on     */
+/*  behalf of the system, rather than the calling process, see ipc_mplan().  */
+/*                                                                           */
+/*  MP-Unsafe race:rd(ipc->slot,ipc->mbox)                                   */
+/*  MT-Safe                                                                  */
+/*                                                                           */
+/*  Mitigation:                                                              */
+/*    1)  Call from within an IPC_INTER_CRITICAL_SECTION.                    */
+/*****************************************************************************/
+SBMA_STATIC int
+ipc_mvictim(struct ipc * const ipc, size_t const deficit, size_t const need,
+            int const admit, int const any)
+{
+  int i, ii, pass, id;
+  size_t e_mem, mx_e_mem, mx_d_mem;
+  volatile struct ipc_slot * slot;
+
+  id   = ipc->id;
+  slot = ipc->slot;
+
+  ii = -1;
+
+  /* Processes which have signaling enabled, or are outside of the gang, are
+   * preferred, since they are not expected to need their memory soon. */
+  for (pass=0; pass<2 && -1==ii; ++pass) {
+    mx_e_mem = 0;
+    mx_d_mem = SIZE_MAX;
+
+    for (i=0; i<ipc->n_procs; ++i) {
+      /* Skip oneself, unless on behalf of the system. */
+      if (i == id && 0 == any) {
+        continue;
+      }
+      /* Skip process which are ineligible. */
+      else if (!ipc_is_eligible(ipc, i)) {
+        continue;
+      }
+      /* Skip process which are not accepting signals, nor outside of the
+       * gang, on the first pass. */
+      else if (0 == pass && IPC_SIGON != (slot[i].flags&IPC_SIGON) &&\
+               (0 == *ipc->gang || IPC_GANG_HOLD == slot[i].gang))
+      {
+        continue;
+      }
+      /* Skip process whose request ring is full or which have already been
+       * asked. */
+      else if (IPC_MBOX_LEN == ipc->mbox[i].count || ipc_mbox_has(ipc, i)) {
+        continue;
+      }
+
+      /* Only the memory beyond the quota and the pinned memory of a process
+       * can be released. */
+      e_mem = slot[i].c_mem-IPC_FLOOR(slot[i]);
+
+      if (VMM_ADMITF == (admit&VMM_ADMITF)) {
+        /*
+         *  Choose the process to evict by weighted max-min fair share:
+         *    1) Unless on behalf of the system, skip any candidate process
+         *       which, relative to its priority, holds no more resident
+         *       memory than the calling process will once the request is
+         *       admitted.
+         *    2) Choose from the rest, the candidate which holds the most
+         *       resident memory relative to its priority.
+         */
+        if (0 == any &&\
+            slot[i].c_mem*slot[id].prio <= (slot[id].c_mem+need)*slot[i].prio)
+        {
+          continue;
+        }
+        if (-1 == ii ||\
+            slot[i].c_mem*slot[ii].prio > slot[ii].c_mem*slot[i].prio)
+        {
+          ii = i;
+        }
+      }
+      else {
+        /*
+         *  Choose the process to evict as follows:
+         *    1) If no candidate process has releasable memory greater than
+         *       the outstanding memory, then choose the candidate which has
+         *       the most releasable memory.
+         *    2) If some candidate process(es) have releasable memory greater
+         *       than the outstanding memory, then:
+         *       2.1) If admitd is not selected, then choose from these, the
+         *            candidate which has the least releasable memory.
+         *       2.2) If admitd is selected, then choose from these, the
+         *            candidate which has the least dirty memory.
+         */
+        if ((mx_e_mem < deficit && e_mem > mx_e_mem) ||\
+            (e_mem >= deficit &&\
+              ((VMM_ADMITD != (admit&VMM_ADMITD) && e_mem < mx_e_mem) ||\
+               (VMM_ADMITD == (admit&VMM_ADMITD) && slot[i].d_mem < mx_d_mem))))
+        {
+          ii = i;
+          mx_e_mem = e_mem;
+          mx_d_mem = slot[i].d_mem;
+        }
+      }
+    }
+  }
+
+  return ii;
+}
+
+
+/*****************************************************************************/
+/*  Ask process ii to release memory on behalf of the calling process.       */
+/*                                                                           */
+/*  MP-Unsafe race:rw(ipc->mbox[ii])                                         */
+/*  MT-Safe                                                                  */
+/*                                                                           */
+/*  Mitigation:                                                              */
+/*    1)  Call from within an IPC_INTER_CRITICAL_SECTION.                    */
+/*****************************************************************************/
+SBMA_STATIC void
+ipc_mrequest(struct ipc * const ipc, int const ii)
+{
+  volatile struct ipc_mbox * mbox;
+
+  mbox = &(ipc->mbox[ii]);
+  mbox->req[(mbox->head+mbox->count)%IPC_MBOX_LEN] = ipc->id;
+  mbox->count++;
+  IPC_MBOX_POST(mbox);
+
+  IPC_TRACK(ipc, numreq, 1);
+}
+
+
+/*****************************************************************************/
+/*  MP-Unsafe race:rw(ipc->mbox)                                             */
+/*            race:rd(ipc->slot)                                             */
+/*  MT-Safe                                                                  */
+/*                                                                           */
+/*  Note:                                                                    */
+/*    1)  With VMM_ADMITF, a process which holds more than its fair share    */
+/*        is made to release its own memory rather than evict its peers.     */
+/*    2)  If any is non-zero, the request is made on behalf of the system,   */
+/*        e.g., to shrink the memory budget, so the calling process is a     */
+/*        candidate like any other and fair share is not relative to it.     */
+/*                                                                           */
+/*  Mitigation:                                                              */
+/*    1)  Call from within an IPC_INTER_CRITICAL_SECTION.                    */
+/*****************************************************************************/
+SBMA_EXTERN int
+ipc_mplan(struct ipc * const ipc, size_t const deficit, size_t const need,
+          int const admit, int const any)
+{
+  int i, ii, id, n_ask;
+  size_t left, e_mem;
+  volatile struct ipc_slot * slot;
+
+  id   = ipc->id;
+  slot = ipc->slot;
+
+  /* Plan the set of processes to release memory, such that their combined
+   * releasable memory covers the deficit, and ask them all at once, so that
+   * they evict in parallel. Processes which have already been asked, and have
+   * yet to answer, count towards the deficit. */
+  left = deficit;
+  n_ask = 0;
+  for (i=0; i<ipc->n_procs && 0!=left; ++i) {
+    if ((i != id || 0 != any) && ipc_mbox_has(ipc, i) &&\
+        ipc_is_eligible(ipc, i))
+    {
+      e_mem = slot[i].c_mem-IPC_FLOOR(slot[i]);
+      left -= (e_mem < left) ? e_mem : left;
+      n_ask++;
+    }
+  }
+  for (; 0!=left; ++n_ask) {
+    ii = ipc_mvictim(ipc, left, need, admit, any);
+    if (-1 == ii)
+      break;
+
+    ipc_mrequest(ipc, ii);
+
+    e_mem = slot[ii].c_mem-IPC_FLOOR(slot[ii]);
+    left -= (e_mem < left) ? e_mem : left;
+  }
+
+  /* With fair share, if no other process holds more than its share, nor has
+   * been asked already, then this process is the one beyond its share and
+   * must release its own memory. If it has none to release, a process is
+   * chosen as if fair share were disabled instead. */
+  if (0 == any && VMM_ADMITF == (admit&VMM_ADMITF) && 0 != left &&\
+      0 == n_ask)
+  {
+    if (ipc_is_eligible(ipc, id)) {
+      if (!ipc_mbox_has(ipc, id) && IPC_MBOX_LEN != ipc->mbox[id].count) {
+        ipc_mrequest(ipc, id);
+        n_ask++;
+      }
+    }
+    else {
+      for (; 0!=left; ++n_ask) {
+        ii = ipc_mvictim(ipc, left, need, admit&~VMM_ADMITF, any);
+        if (-1 == ii)
+          break;
+
+        ipc_mrequest(ipc, ii);
+
+        e_mem = slot[ii].c_mem-IPC_FLOOR(slot[ii]);
+        left -= (e_mem < left) ? e_mem : left;
+      }
+    }
+  }
+
+  return n_ask;
+}
+
+
+#ifdef TEST
+int
+main(int argc, char * argv[])
+{
+  if (0 == argc || NULL == argv) {}
+
+  return 0;
+}
+#endif
@@ -0,0 +1,74 @@
+/*
+Copyright (c) 2015,2016 Jeremy Iverson
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+
+#ifndef _GNU_SOURCE
+# define _GNU_SOURCE 1
+#endif
+
+
+#include <stddef.h> /* size_t */
+#include "common.h"
+#include "ipc.h"
+#include "sbma.h"
+
+
+/*****************************************************************************/
+/*  MP-Safe                                                                  */
+/*  MT-Safe                                                                  */
+/*                                                                           */
+/*  Note:                                                                    */
+/*    1)  The quota is a number of system pages which the process is never   */
+/*        asked to release. The priority is the weight of the process when   */
+/*        victims are chosen by fair share, see ipc_madmit(), and must be    */
+/*        positive.                                                          */
+/*****************************************************************************/
+SBMA_EXTERN int
+ipc_mpolicy(struct ipc * const ipc, size_t const quota, int const prio)
+{
+  if (0 >= prio)
+    return -1;
+
+  /*=========================================================================*/
+  IPC_INTER_CRITICAL_SECTION_BEG(ipc);
+  /*=========================================================================*/
+
+  ipc->slot[ipc->id].quota = quota;
+  ipc->slot[ipc->id].prio  = prio;
+
+  /*=========================================================================*/
+  IPC_INTER_CRITICAL_SECTION_END(ipc);
+  /*=========================================================================*/
+
+  return 0;
+}
+
+
+#ifdef TEST
+int
+main(int argc, char * argv[])
+{
+  if (0 == argc || NULL == argv) {}
+
+  return 0;
+}
+#endif
@@ -0,0 +1,79 @@
+/*
+Copyright (c) 2015,2016 Jeremy Iverson
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+
+#ifndef _GNU_SOURCE
+# define _GNU_SOURCE 1
+#endif
+
+
+#include <pthread.h> /* pthread_mutex_lock, pthread_mutex_unlock */
+#include <stddef.h>  /* NULL */
+#include "common.h"
+#include "ipc.h"
+#include "sbma.h"
+
+
+/*****************************************************************************/
+/*  MP-Safe                                                                  */
+/*  MT-Safe                                                                  */
+/*                                                                           */
+/*  Note:                                                                    */
+/*    1)  The eviction thread is woken, so that it starts admitting the      */
+/*        memory of the ticket, see ipc_mgrant().                            */
+/*****************************************************************************/
+SBMA_EXTERN int
+ipc_mqueue(struct ipc * const ipc, struct sbma_ticket * const tkt)
+{
+  int ret;
+
+  ret = pthread_mutex_lock(&(ipc->tkt_mtx));
+  if (0 != ret)
+    return -1;
+
+  tkt->status = 1;
+  tkt->next   = NULL;
+  if (NULL == ipc->tkt_tail)
+    ipc->tkt_head = tkt;
+  else
+    ipc->tkt_tail->next = tkt;
+  ipc->tkt_tail = tkt;
+
+  ret = pthread_mutex_unlock(&(ipc->tkt_mtx));
+  if (0 != ret)
+    return -1;
+
+  IPC_MBOX_POST(&(ipc->mbox[ipc->id]));
+
+  return 0;
+}
+
+
+#ifdef TEST
+int
+main(int argc, char * argv[])
+{
+  if (0 == argc || NULL == argv) {}
+
+  return 0;
+}
+#endif
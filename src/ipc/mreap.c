@@ -0,0 +1,75 @@
+/*
+Copyright (c) 2015,2016 Jeremy Iverson
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+
+#ifndef _GNU_SOURCE
+# define _GNU_SOURCE 1
+#endif
+
+
+#include <errno.h>     /* errno library */
+#include <signal.h>    /* kill */
+#include <sys/types.h> /* pid_t */
+#include "common.h"
+#include "ipc.h"
+#include "sbma.h"
+
+
+/*****************************************************************************/
+/*  MP-Unsafe race:rw(ipc->pid)                                              */
+/*  MT-Safe                                                                  */
+/*                                                                           */
+/*  Note:                                                                    */
+/*    1)  A process is considered dead once its pid no longer exists. A      */
+/*        process which has exited, but not yet been waited for by its       */
+/*        parent, still holds its slot.                                      */
+/*                                                                           */
+/*  Mitigation:                                                              */
+/*    1)  Call from within an IPC_INTER_CRITICAL_SECTION.                    */
+/*****************************************************************************/
+SBMA_EXTERN int
+ipc_mreap(struct ipc * const ipc)
+{
+  int i, n_reap;
+
+  for (n_reap=0,i=0; i<ipc->n_procs; ++i) {
+    if (i == ipc->id || 0 == ipc->slot[i].pid)
+      continue;
+    if (-1 == kill((pid_t)ipc->slot[i].pid, 0) && ESRCH == errno) {
+      ipc_mrelease(ipc, i);
+      n_reap++;
+    }
+  }
+
+  return n_reap;
+}
+
+
+#ifdef TEST
+int
+main(int argc, char * argv[])
+{
+  if (0 == argc || NULL == argv) {}
+
+  return 0;
+}
+#endif
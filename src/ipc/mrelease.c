@@ -0,0 +1,84 @@
+/*
+Copyright (c) 2015,2016 Jeremy Iverson
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+
+#ifndef _GNU_SOURCE
+# define _GNU_SOURCE 1
+#endif
+
+
+#include "common.h"
+#include "ipc.h"
+#include "sbma.h"
+
+
+/*****************************************************************************/
+/*  MP-Unsafe race:rw(ipc->s_mem,ipc->slot[ii],ipc->mbox[ii],ipc->memb)      */
+/*  MT-Safe                                                                  */
+/*                                                                           */
+/*  Note:                                                                    */
+/*    1)  Any requests still pending in the ring of the process will never   */
+/*        be served, so the processes which made them are woken up instead.  */
+/*                                                                           */
+/*  Mitigation:                                                              */
+/*    1)  Call from within an IPC_INTER_CRITICAL_SECTION.                    */
+/*****************************************************************************/
+SBMA_EXTERN void
+ipc_mrelease(struct ipc * const ipc, int const ii)
+{
+  volatile struct ipc_mbox * mbox;
+
+  /* Return the memory charged to the process to the system. */
+  *ipc->s_mem         += ipc->slot[ii].c_mem;
+  ipc->slot[ii].c_mem  = 0;
+  ipc->slot[ii].d_mem  = 0;
+  ipc->slot[ii].flags  = 0;
+  ipc->slot[ii].quota  = 0;
+  ipc->slot[ii].p_mem  = 0;
+  ipc->slot[ii].r_mem  = 0;
+  ipc->slot[ii].prio   = 1;
+  ipc->slot[ii].gang   = IPC_GANG_NONE;
+  ipc->slot[ii].w_mem  = 0;
+
+  /* Wake up the processes with requests pending in the ring. */
+  mbox = &(ipc->mbox[ii]);
+  for (; 0!=mbox->count; mbox->count--) {
+    IPC_MBOX_POST(&(ipc->mbox[mbox->req[mbox->head]]));
+    mbox->head = (mbox->head+1)%IPC_MBOX_LEN;
+  }
+  mbox->head = 0;
+
+  /* Free the slot. */
+  ipc->slot[ii].pid = 0;
+  (*ipc->memb)--;
+}
+
+
+#ifdef TEST
+int
+main(int argc, char * argv[])
+{
+  if (0 == argc || NULL == argv) {}
+
+  return 0;
+}
+#endif
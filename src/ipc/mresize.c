@@ -0,0 +1,134 @@
+/*
+Copyright (c) 2015,2016 Jeremy Iverson
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+
+#ifndef _GNU_SOURCE
+# define _GNU_SOURCE 1
+#endif
+
+
+#include <stddef.h>    /* size_t */
+#include <sys/types.h> /* ssize_t */
+#include <time.h>      /* struct timespec */
+#include "common.h"
+#include "ipc.h"
+#include "sbma.h"
+
+
+/*****************************************************************************/
+/*  MP-Safe                                                                  */
+/*  MT-Safe                                                                  */
+/*                                                                           */
+/*  Note:                                                                    */
+/*    1)  Growing takes effect immediately. Shrinking takes memory from the  */
+/*        system as it becomes free, asking processes to release memory in   */
+/*        the meantime, so the budget is reduced incrementally.              */
+/*    2)  If no process can release any more memory, e.g., because all of    */
+/*        them are at their quota, shrinking stops early and -2 is returned. */
+/*        The budget is then left between its old size and value.            */
+/*****************************************************************************/
+SBMA_EXTERN int
+ipc_mresize(struct ipc * const ipc, size_t const value, int const admit)
+{
+  int retval, n_ask, event;
+  size_t debt, take;
+  ssize_t ret;
+  struct timespec ts;
+
+  /* Default return value is success. */
+  retval = 0;
+
+  for (;;) {
+    /*=======================================================================*/
+    IPC_INTER_CRITICAL_SECTION_BEG(ipc);
+    /*=======================================================================*/
+
+    /* The debt is re-computed on each iteration, so that concurrent resizes
+     * do not shrink the budget twice. */
+    if (value >= *ipc->t_mem) {
+      *ipc->s_mem += value-*ipc->t_mem;
+      *ipc->t_mem  = value;
+      debt = 0;
+    }
+    else {
+      debt = *ipc->t_mem-value;
+    }
+
+    /* Take as much of the debt as possible from free memory, including that
+     * of any processes which died without leaving. */
+    if (*ipc->s_mem < debt)
+      (void)ipc_mreap(ipc);
+    take = (*ipc->s_mem < debt) ? *ipc->s_mem : debt;
+    *ipc->s_mem -= take;
+    *ipc->t_mem -= take;
+    debt        -= take;
+
+    /* Ask processes to release the rest. */
+    n_ask = 0;
+    if (0 != debt)
+      n_ask = ipc_mplan(ipc, debt, 0, admit, 1);
+
+    /* Cache the event counter before leaving the critical section, so that
+     * a wake-up which happens before the wait is not missed. */
+    event = ipc->mbox[ipc->id].event;
+
+    /*=======================================================================*/
+    IPC_INTER_CRITICAL_SECTION_END(ipc);
+    /*=======================================================================*/
+
+    if (0 == debt)
+      break;
+    if (0 == n_ask) {
+      retval = -2;
+      break;
+    }
+
+    /* Serve any requests made to this process, including those made above. */
+    ret = ipc_mserve(ipc, 0);
+    if (-1 == ret)
+      goto ERREXIT;
+
+    /* Wait for one of the requests to be served. */
+    ts.tv_sec  = 0;
+    ts.tv_nsec = IPC_WAIT_NSEC;
+    IPC_MBOX_WAIT(&(ipc->mbox[ipc->id]), event, &ts);
+  }
+
+  goto RETURN;
+
+  ERREXIT:
+  retval = -1;
+
+  RETURN:
+  return retval;
+}
+
+
+#ifdef TEST
+int
+main(int argc, char * argv[])
+{
+  if (0 == argc || NULL == argv) {}
+
+  return 0;
+}
+#endif
@@ -0,0 +1,104 @@
+/*
+Copyright (c) 2015,2016 Jeremy Iverson
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+
+#ifndef _GNU_SOURCE
+# define _GNU_SOURCE 1
+#endif
+
+
+#include <stddef.h> /* NULL, size_t */
+#include "common.h"
+#include "ipc.h"
+#include "sbma.h"
+
+
+/*****************************************************************************/
+/*  MP-Safe                                                                  */
+/*  MT-Safe                                                                  */
+/*                                                                           */
+/*  Note:                                                                    */
+/*    1)  Memory held for a ticket is charged to the process, so returning   */
+/*        it only moves memory from the process to the system, as for        */
+/*        credits, see ipc_atomic_flush().                                   */
+/*****************************************************************************/
+SBMA_EXTERN int
+ipc_mrevoke(struct ipc * const ipc, struct sbma_ticket * const tkt)
+{
+  size_t pages;
+  struct ipc_rsv * prev, * rsv;
+
+  /*=========================================================================*/
+  IPC_INTER_CRITICAL_SECTION_BEG(ipc);
+  /*=========================================================================*/
+
+  /*=========================================================================*/
+  IPC_INTRA_CRITICAL_SECTION_BEG(ipc);
+  /*=========================================================================*/
+
+  for (prev=NULL,rsv=ipc->rsv_head; NULL!=rsv&&tkt!=rsv->tkt; rsv=rsv->next)
+    prev = rsv;
+
+  pages = 0;
+  if (NULL != rsv) {
+    if (NULL == prev)
+      ipc->rsv_head = rsv->next;
+    else
+      prev->next = rsv->next;
+    if (ipc->rsv_tail == rsv)
+      ipc->rsv_tail = prev;
+
+    pages         = rsv->pages;
+    rsv->next     = ipc->rsv_free;
+    ipc->rsv_free = rsv;
+  }
+
+  /*=========================================================================*/
+  IPC_INTRA_CRITICAL_SECTION_END(ipc);
+  /*=========================================================================*/
+
+  if (0 != pages) {
+    ASSERT(ipc->slot[ipc->id].c_mem >= pages);
+    ASSERT(ipc->slot[ipc->id].r_mem >= pages);
+
+    *ipc->s_mem += pages;
+    ipc->slot[ipc->id].c_mem -= pages;
+    (void)__sync_fetch_and_sub(&(ipc->slot[ipc->id].r_mem), pages);
+  }
+
+  /*=========================================================================*/
+  IPC_INTER_CRITICAL_SECTION_END(ipc);
+  /*=========================================================================*/
+
+  return (NULL == rsv) ? -1 : 0;
+}
+
+
+#ifdef TEST
+int
+main(int argc, char * argv[])
+{
+  if (0 == argc || NULL == argv) {}
+
+  return 0;
+}
+#endif
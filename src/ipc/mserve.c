@@ -0,0 +1,175 @@
+/*
+Copyright (c) 2015,2016 Jeremy Iverson
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+
+#ifndef _GNU_SOURCE
+# define _GNU_SOURCE 1
+#endif
+
+
+#include <pthread.h>   /* pthread library */
+#include <stddef.h>    /* size_t */
+#include <sys/types.h> /* ssize_t */
+#include "common.h"
+#include "ipc.h"
+#include "sbma.h"
+
+
+/*****************************************************************************/
+/*  MP-Safe                                                                  */
+/*  MT-Safe                                                                  */
+/*                                                                           */
+/*  Note:                                                                    */
+/*    1)  All pending requests are served by a single call to ipc->evict,    */
+/*        after which every requesting process is woken up so that it can    */
+/*        re-check the system state. The process never releases memory below */
+/*        its quota.                                                         */
+/*    2)  A process which is waiting for memory also serves its own ring,    */
+/*        so that two processes waiting on each other cannot deadlock.       */
+/*****************************************************************************/
+SBMA_EXTERN ssize_t
+ipc_mserve(struct ipc * const ipc, int const block)
+{
+  int ret, i, n_req;
+  size_t max, c_pages, d_pages;
+  ssize_t retval;
+  int req[IPC_MBOX_LEN];
+  volatile struct ipc_mbox * mbox;
+
+  /* Default return value. */
+  retval = 0;
+
+  /* Serialize serving of requests within the process. */
+  if (0 == block) {
+    ret = pthread_mutex_trylock(&(ipc->mbox_mtx));
+    if (0 != ret)
+      goto RETURN;
+  }
+  else {
+    ret = pthread_mutex_lock(&(ipc->mbox_mtx));
+    ERRCHK(ERREXIT, 0 != ret);
+  }
+
+  mbox = &(ipc->mbox[ipc->id]);
+
+  /*=========================================================================*/
+  IPC_INTER_CRITICAL_SECTION_BEG(ipc);
+  /*=========================================================================*/
+
+  /* Dequeue all pending requests. */
+  for (n_req=0; 0!=mbox->count; ++n_req) {
+    req[n_req]  = mbox->req[mbox->head];
+    mbox->head  = (mbox->head+1)%IPC_MBOX_LEN;
+    mbox->count--;
+  }
+
+  /*=========================================================================*/
+  IPC_INTER_CRITICAL_SECTION_END(ipc);
+  /*=========================================================================*/
+
+  /* Shortcut if there is nothing to serve. */
+  if (0 == n_req)
+    goto UNLOCK;
+
+  /*=========================================================================*/
+  IPC_INTER_CRITICAL_SECTION_BEG(ipc);
+  /*=========================================================================*/
+
+  /* Return any credits held in the local pool, since the process is being
+   * asked to release memory. Memory held for admitted tickets is kept, see
+   * ipc_mgrant(). */
+  (void)ipc_atomic_flush(ipc);
+
+  /* Compute how much memory can be released without going below the quota
+   * of the process, nor releasing its pinned memory. */
+  if (ipc->slot[ipc->id].c_mem > IPC_FLOOR(ipc->slot[ipc->id]))
+    max = ipc->slot[ipc->id].c_mem-IPC_FLOOR(ipc->slot[ipc->id]);
+  else
+    max = 0;
+
+  /*=========================================================================*/
+  IPC_INTER_CRITICAL_SECTION_END(ipc);
+  /*=========================================================================*/
+
+  /* Evict as much memory as allowed. */
+  c_pages = 0;
+  d_pages = 0;
+  ret = ipc->evict(n_req, max, &c_pages, &d_pages);
+  ERRCHK(CLEANUP, -1 == ret);
+
+  /*=========================================================================*/
+  IPC_INTER_CRITICAL_SECTION_BEG(ipc);
+  /*=========================================================================*/
+
+  /* Update ipc memory statistics. */
+  ipc_atomic_dec(ipc, c_pages, d_pages);
+
+  /* Tell the requesting processes that their requests have been served. */
+  for (i=0; i<n_req; ++i)
+    IPC_MBOX_POST(&(ipc->mbox[req[i]]));
+
+  /*=========================================================================*/
+  IPC_INTER_CRITICAL_SECTION_END(ipc);
+  /*=========================================================================*/
+
+  retval = c_pages;
+  goto UNLOCK;
+
+  CLEANUP:
+  /*=========================================================================*/
+  IPC_INTER_CRITICAL_SECTION_BEG(ipc);
+  /*=========================================================================*/
+
+  /* Wake the requesting processes anyway, so that they do not wait on a
+   * process which failed to serve them. */
+  for (i=0; i<n_req; ++i)
+    IPC_MBOX_POST(&(ipc->mbox[req[i]]));
+
+  /*=========================================================================*/
+  IPC_INTER_CRITICAL_SECTION_END(ipc);
+  /*=========================================================================*/
+
+  retval = -1;
+
+  UNLOCK:
+  ret = pthread_mutex_unlock(&(ipc->mbox_mtx));
+  ERRCHK(ERREXIT, 0 != ret);
+
+  goto RETURN;
+
+  ERREXIT:
+  retval = -1;
+
+  RETURN:
+  return retval;
+}
+
+
+#ifdef TEST
+int
+main(int argc, char * argv[])
+{
+  if (0 == argc || NULL == argv) {}
+
+  return 0;
+}
+#endif
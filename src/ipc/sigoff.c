@@ -31,8 +31,8 @@ THE SOFTWARE.
 
 
 /*****************************************************************************/
-/*  MP-Unsafe race:rw(ipc->flags[ipc->id])                                   */
-/*  MT-Unsafe race:rw(ipc->flags[ipc->id])                                   */
+/*  MP-Unsafe race:rw(ipc->slot[ipc->id].flags)                              */
+/*  MT-Unsafe race:rw(ipc->slot[ipc->id].flags)                              */
 /*                                                                           */
 /*  Mitigation:                                                              */
 /*    1)  See note in ipc_sigon().                                           */
@@ -40,7 +40,7 @@ THE SOFTWARE.
 SBMA_EXTERN void
 ipc_sigoff(struct ipc * const ipc)
 {
-  ipc->flags[ipc->id] &= ~IPC_SIGON;
+  ipc->slot[ipc->id].flags &= ~IPC_SIGON;
 }
 
 
@@ -31,18 +31,18 @@ THE SOFTWARE.
 
 
 /*****************************************************************************/
-/*  MP-Unsafe race:rw(ipc->flags[ipc->id])                                   */
-/*  MT-Unsafe race:rw(ipc->flags[ipc->id])                                   */
+/*  MP-Unsafe race:rw(ipc->slot[ipc->id].flags)                              */
+/*  MT-Unsafe race:rw(ipc->slot[ipc->id].flags)                              */
 /*                                                                           */
 /*  Mitigation:                                                              */
-/*    1)  None. ipc->flags[ipc->id] is shared by all threads in a process,   */
-/*        so its value should be updated by a SINGLE thread whenever its     */
-/*        status changes.                                                    */
+/*    1)  None. ipc->slot[ipc->id].flags is shared by all threads in a       */
+/*        process, so its value should be updated by a SINGLE thread         */
+/*        whenever its status changes.                                       */
 /*****************************************************************************/
 SBMA_EXTERN void
 ipc_sigon(struct ipc * const ipc)
 {
-  ipc->flags[ipc->id] |= IPC_SIGON;
+  ipc->slot[ipc->id].flags |= IPC_SIGON;
 }
 
 
@@ -156,7 +156,6 @@ the possibly moved allocated space.
 /*--------------------------------------------------------------------------*/
 
 
-#ifdef USE_THREAD
 # define DEADLOCK 0   /* 0: no deadlock diagnostics, */
                       /* 1: deadlock diagnostics */
 
@@ -263,12 +262,6 @@ do {                                                                        \
   if (DEADLOCK) printf("[%5d] mtx let %s:%d %s (%p)\n",                     \
     (int)syscall(SYS_gettid), __func__, __LINE__, #LOCK, (void*)(LOCK));    \
 } while (0)
-#else
-# define INIT_LOCK(LOCK)
-# define FREE_LOCK(LOCK)
-# define GET_LOCK(LOCK)
-# define LET_LOCK(LOCK)
-#endif
 
 
 /*--------------------------------------------------------------------------*/
@@ -1044,18 +1037,14 @@ typedef struct kl_mem
   kl_fix_block_t * brick_bin[BRICK_BIN_NUM];
   kl_chunk_t * chunk_bin[CHUNK_BIN_NUM];
 
-#ifdef USE_THREAD
   pthread_mutex_t init_lock;  /* mutex guarding initialization */
   pthread_mutex_t lock;       /* mutex guarding struct */
-#endif
 } kl_mem_t;
 
 
 static kl_mem_t _mem_=
 {
-#ifdef USE_THREAD
   .init_lock = PTHREAD_MUTEX_INITIALIZER,
-#endif
   .init = 0,
   .enabled = M_ENABLED_OFF
 };
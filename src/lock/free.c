@@ -26,12 +26,9 @@ THE SOFTWARE.
 #endif
 
 
-/****************************************************************************/
-/*! Pthread configurations. */
-/****************************************************************************/
-#ifdef USE_THREAD
-# include <pthread.h>     /* pthread library */
-# include "common.h"
+#include <pthread.h>     /* pthread library */
+#include "common.h"
+#include "lock.h"
 
 
 /*****************************************************************************/
@@ -52,11 +49,6 @@ lock_free(pthread_mutex_t * const lock)
   RETURN:
   return retval;
 }
-#else
-/* Required incase USE_THREAD is not defined, so that this is not an empty
- * translation unit. */
-typedef int make_iso_compilers_happy;
-#endif
 
 
 #ifdef TEST
@@ -26,16 +26,13 @@ THE SOFTWARE.
 #endif
 
 
-/****************************************************************************/
-/*! Pthread configurations. */
-/****************************************************************************/
-#ifdef USE_THREAD
-# include <pthread.h>     /* pthread library */
-# include <sys/syscall.h> /* SYS_gettid */
-# include <time.h>        /* CLOCK_REALTIME, struct timespec, clock_gettime */
-# include <unistd.h>      /* syscall */
-# include "common.h"
-# include "lock.h"
+#include <pthread.h>     /* pthread library */
+#include <stddef.h>      /* NULL */
+#include <sys/syscall.h> /* SYS_gettid */
+#include <time.h>        /* CLOCK_REALTIME, struct timespec, clock_gettime */
+#include <unistd.h>      /* syscall */
+#include "common.h"
+#include "lock.h"
 
 
 /*****************************************************************************/
@@ -72,14 +69,12 @@ lock_get_int(char const * const func, int const line,
   DL_PRINTF("[%5d] mtx get %s:%d %s (%p)\n", (int)syscall(SYS_gettid), func,\
      line, lock_str, (void*)(lock));
 
+  /* suppress unused warnings when DL_PRINTF is disabled */
+  if (NULL == func || 0 == line || NULL == lock_str) {}
+
   RETURN:
   return retval;
 }
-#else
-/* Required incase USE_THREAD is not defined, so that this is not an empty
- * translation unit. */
-typedef int make_iso_compilers_happy;
-#endif
 
 
 #ifdef TEST
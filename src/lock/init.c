@@ -26,12 +26,9 @@ THE SOFTWARE.
 #endif
 
 
-/****************************************************************************/
-/*! Pthread configurations. */
-/****************************************************************************/
-#ifdef USE_THREAD
-# include <pthread.h>     /* pthread library */
-# include "common.h"
+#include <pthread.h>     /* pthread library */
+#include "common.h"
+#include "lock.h"
 
 
 /*****************************************************************************/
@@ -60,11 +57,6 @@ lock_init(pthread_mutex_t * const lock)
   RETURN:
   return retval;
 }
-#else
-/* Required incase USE_THREAD is not defined, so that this is not an empty
- * translation unit. */
-typedef int make_iso_compilers_happy;
-#endif
 
 
 #ifdef TEST
@@ -76,9 +68,10 @@ typedef int make_iso_compilers_happy;
 int
 main(int argc, char * argv[])
 {
-  if (0 == argc || NULL == argv) {}
-
   int ret;
+  pthread_mutex_t lock;
+
+  if (0 == argc || NULL == argv) {}
 
   ret = lock_init(&lock);
   ERRCHK(FAILURE, 0 != ret);
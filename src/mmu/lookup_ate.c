@@ -57,7 +57,7 @@ mmu_lookup_ate(struct mmu * const mmu, void const * const addr)
 
   /* Search doubly linked list for a ate which contains addr. */
   for (ate=mmu->a_tbl; NULL!=ate; ate=ate->next) {
-    len  = ate->n_pages*mmu->page_size;
+    len  = ate->n_pages*ate->page_size;
     addr_ = (void*)ate->base;
     if (addr_ <= addr && addr < (void*)((uintptr_t)addr_+len))
       break;
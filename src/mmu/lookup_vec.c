@@ -0,0 +1,217 @@
+/*
+Copyright (c) 2015,2016 Jeremy Iverson
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+
+#ifndef _GNU_SOURCE
+# define _GNU_SOURCE 1
+#endif
+
+
+#include <stdint.h>    /* uintptr_t */
+#include <stddef.h>    /* NULL, size_t */
+#include <sys/types.h> /* ssize_t */
+#include "common.h"
+#include "lock.h"
+#include "mmu.h"
+
+
+/*****************************************************************************/
+/*  Restore the max-heap property of run[i..num), by beg.                    */
+/*                                                                           */
+/*  MT-Safe                                                                  */
+/*****************************************************************************/
+SBMA_STATIC void
+mmu_sift(struct mmu_run * const run, size_t i, size_t const num)
+{
+  size_t c;
+  struct mmu_run tmp;
+
+  for (;;) {
+    c = 2*i+1;
+    if (c >= num)
+      break;
+    if (c+1 < num && run[c+1].beg > run[c].beg)
+      c++;
+    if (run[i].beg >= run[c].beg)
+      break;
+
+    tmp    = run[i];
+    run[i] = run[c];
+    run[c] = tmp;
+    i      = c;
+  }
+}
+
+
+/*****************************************************************************/
+/*  Heap sort run by beg. Unlike qsort(), this never allocates memory, which */
+/*  would be served by the runtime itself.                                   */
+/*                                                                           */
+/*  MT-Safe                                                                  */
+/*****************************************************************************/
+SBMA_STATIC void
+mmu_sort(struct mmu_run * const run, size_t const num)
+{
+  size_t i;
+  struct mmu_run tmp;
+
+  if (num < 2)
+    return;
+
+  for (i=num/2; i>0; --i)
+    mmu_sift(run, i-1, num);
+
+  for (i=num-1; i>0; --i) {
+    tmp    = run[0];
+    run[0] = run[i];
+    run[i] = tmp;
+    mmu_sift(run, 0, i);
+  }
+}
+
+
+/*****************************************************************************/
+/*  MT-Safe                                                                  */
+/*                                                                           */
+/*  Note:                                                                    */
+/*    1)  On success, this function will acquire, but not release, the       */
+/*        lock for each distinct ate in run[0..retval). The runs of an ate   */
+/*        are consecutive and the ates are ordered by address.               */
+/*    2)  Byte ranges which are empty or not contained in any ate are        */
+/*        dropped. Page ranges which overlap or abut are merged.             */
+/*    3)  All ates are locked while the mmu lock is held, as                 */
+/*        mmu_lookup_ate() does, and in order of address, so that two        */
+/*        callers cannot deadlock.                                           */
+/*****************************************************************************/
+SBMA_EXTERN ssize_t
+mmu_lookup_vec(struct mmu * const mmu, struct mmu_run * const run,
+               size_t const num)
+{
+  int ret;
+  size_t i, j, beg, end, len;
+  ssize_t retval;
+  uintptr_t limit;
+  struct ate * ate;
+
+  /* Default return value. */
+  retval = -1;
+
+  /* Sort the byte ranges by address, so that the ranges of each ate are
+   * consecutive. */
+  mmu_sort(run, num);
+
+  /* Acquire mmu lock. */
+  ret = lock_get(&(mmu->lock));
+  ERRCHK(RETURN, 0 != ret);
+
+  for (ate=NULL,limit=0,i=0,j=0; i<num; ++i) {
+    /* Skip empty ranges. */
+    if (run[i].end <= run[i].beg)
+      continue;
+
+    /* Search doubly linked list for the ate which contains the range, once
+     * the range is past the current one. */
+    if (NULL == ate || run[i].beg >= limit) {
+      for (ate=mmu->a_tbl; NULL!=ate; ate=ate->next) {
+        len = ate->n_pages*ate->page_size;
+        if (ate->base <= run[i].beg && run[i].beg < ate->base+len)
+          break;
+      }
+      if (NULL == ate)
+        continue;
+
+      /* Acquire ate lock. */
+      ret = lock_get(&(ate->lock));
+      ERRCHK(REVERT, 0 != ret);
+
+      limit = ate->base+ate->n_pages*ate->page_size;
+    }
+
+    /* need to make sure that all bytes are captured, thus beg is a floor
+     * operation and end is a ceil operation. */
+    beg = (run[i].beg-ate->base)/ate->page_size;
+    end = 1+(((run[i].end < limit ? run[i].end : limit)-ate->base-1)/\
+      ate->page_size);
+
+    /* Merge with the previous range of the same ate, since j <= i, this
+     * never overwrites a range which has not yet been read. */
+    if (0 != j && ate == run[j-1].ate && beg <= run[j-1].end) {
+      if (end > run[j-1].end)
+        run[j-1].end = end;
+    }
+    else {
+      run[j].ate = ate;
+      run[j].beg = beg;
+      run[j].end = end;
+      j++;
+    }
+  }
+
+  /* Release mmu lock. */
+  ret = lock_let(&(mmu->lock));
+  ERRCHK(FATAL, 0 != ret);
+
+  /***************************************************************************/
+  /* Successful exit -- return number of page ranges. */
+  /***************************************************************************/
+  retval = (ssize_t)j;
+  goto RETURN;
+
+  /***************************************************************************/
+  /* Error exit -- revert changes to runtime state and return. */
+  /***************************************************************************/
+  REVERT:
+  /* Release the ate locks acquired so far. */
+  for (i=0; i<j; ++i) {
+    if (0 == i || run[i].ate != run[i-1].ate) {
+      ret = lock_let(&(run[i].ate->lock));
+      ERRCHK(FATAL, 0 != ret);
+    }
+  }
+  /* Release mmu lock. */
+  ret = lock_let(&(mmu->lock));
+  ERRCHK(FATAL, 0 != ret);
+
+  /***************************************************************************/
+  /* Return point -- return. */
+  /***************************************************************************/
+  RETURN:
+  return retval;
+
+  /***************************************************************************/
+  /* Fatal error -- an unrecoverable error has occured, the runtime state
+   * cannot be reverted to its state before this function was called. */
+  /***************************************************************************/
+  FATAL:
+  FATAL_ABORT(ret);
+}
+
+
+#ifdef TEST
+int
+main(int argc, char * argv[])
+{
+  if (0 == argc || NULL == argv) {}
+
+  return 0;
+}
+#endif
@@ -0,0 +1,233 @@
+/*
+Copyright (c) 2015,2016 Jeremy Iverson
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+
+#ifndef _GNU_SOURCE
+# define _GNU_SOURCE 1
+#endif
+
+
+#include <fcntl.h>     /* O_RDONLY */
+#include <stddef.h>    /* NULL, size_t */
+#include <stdio.h>     /* FILENAME_MAX, snprintf */
+#include <stdlib.h>    /* strtod, strtoull */
+#include <string.h>    /* strchr, strncmp, strstr */
+#include <sys/types.h> /* ssize_t */
+#include <time.h>      /* struct timespec, nanosleep */
+#include <unistd.h>    /* close, sysconf */
+#include "common.h"
+#include "ipc.h"
+#include "sbma.h"
+#include "vmm.h"
+
+
+/*****************************************************************************/
+/*  Read the contents of a small file into buf, as a null terminated string. */
+/*  Returns -1 if the file cannot be read.                                   */
+/*                                                                           */
+/*  MT-Safe                                                                  */
+/*****************************************************************************/
+SBMA_STATIC ssize_t
+vmm_adapt_read(char const * const fname, char * const buf, size_t const len)
+{
+  int fd;
+  ssize_t ret;
+
+  fd = libc_open(fname, O_RDONLY);
+  if (-1 == fd)
+    return -1;
+
+  ret = libc_read(fd, buf, len-1);
+  (void)close(fd);
+  if (-1 == ret)
+    return -1;
+
+  buf[ret] = '\0';
+
+  return ret;
+}
+
+
+/*****************************************************************************/
+/*  Get the 10 second average of the percentage of time in which some tasks  */
+/*  were stalled on memory. Returns -1.0 if it is not available.             */
+/*                                                                           */
+/*  MT-Safe                                                                  */
+/*****************************************************************************/
+SBMA_STATIC double
+vmm_adapt_psi(void)
+{
+  char * tok;
+  char buf[256];
+
+  if (-1 == vmm_adapt_read("/proc/pressure/memory", buf, sizeof(buf)))
+    return -1.0;
+
+  tok = strstr(buf, "some avg10=");
+  if (NULL == tok)
+    return -1.0;
+
+  return strtod(tok+sizeof("some avg10=")-1, NULL);
+}
+
+
+/*****************************************************************************/
+/*  Get the number of bytes of memory which can still be used, from the      */
+/*  cgroup v2 of the process if it has a memory limit, otherwise from the    */
+/*  system. Returns -1 if it is not available.                               */
+/*                                                                           */
+/*  MT-Safe                                                                  */
+/*****************************************************************************/
+SBMA_STATIC ssize_t
+vmm_adapt_headroom(void)
+{
+  unsigned long long max, cur;
+  char * tok, * end;
+  char buf[FILENAME_MAX], fmax[FILENAME_MAX], fcur[FILENAME_MAX];
+
+  /* The cgroup v2 path is the line of /proc/self/cgroup starting with 0::. */
+  if (-1 != vmm_adapt_read("/proc/self/cgroup", buf, sizeof(buf))) {
+    tok = strstr(buf, "0::");
+    if (NULL != tok && (tok == buf || '\n' == tok[-1])) {
+      tok += sizeof("0::")-1;
+      end  = strchr(tok, '\n');
+      if (NULL != end)
+        *end = '\0';
+
+      /* Both file names are built before buf, which holds the path, is
+       * re-used. */
+      (void)snprintf(fmax, FILENAME_MAX, "/sys/fs/cgroup%s/memory.max", tok);
+      (void)snprintf(fcur, FILENAME_MAX, "/sys/fs/cgroup%s/memory.current",\
+        tok);
+
+      if (-1 != vmm_adapt_read(fmax, buf, sizeof(buf)) &&\
+        0 != strncmp(buf, "max", 3))
+      {
+        max = strtoull(buf, NULL, 10);
+
+        if (-1 != vmm_adapt_read(fcur, buf, sizeof(buf))) {
+          cur = strtoull(buf, NULL, 10);
+          return (cur < max) ? (ssize_t)(max-cur) : 0;
+        }
+      }
+    }
+  }
+
+  /* Otherwise, use the memory available to the system. */
+  if (-1 == vmm_adapt_read("/proc/meminfo", buf, sizeof(buf)))
+    return -1;
+
+  tok = strstr(buf, "MemAvailable:");
+  if (NULL == tok)
+    return -1;
+
+  return (ssize_t)strtoull(tok+sizeof("MemAvailable:")-1, NULL, 10)*1024;
+}
+
+
+/*****************************************************************************/
+/*  MT-Safe                                                                  */
+/*                                                                           */
+/*  Note:                                                                    */
+/*    1)  The budget covers the memory which the processes already use plus  */
+/*        7/8 of the headroom, so that the runtime does not compete with the */
+/*        rest of the system for the last of its memory. While memory is     */
+/*        under pressure, it is instead shrunk to 7/8 of what is in use.     */
+/*****************************************************************************/
+SBMA_EXTERN void *
+vmm_adapt(void * const arg)
+{
+  int ret, tick;
+  size_t page_size, used, t_mem, l_mem, target, floor, i;
+  ssize_t headroom;
+  double psi;
+  struct timespec ts;
+  struct ipc * ipc;
+
+  ipc       = &(_vmm_.ipc);
+  page_size = (size_t)sysconf(_SC_PAGESIZE);
+
+  for (tick=1; 1==_vmm_.adapt; ++tick) {
+    ts.tv_sec  = 0;
+    ts.tv_nsec = VMM_ADAPT_NSEC;
+    (void)libc_nanosleep(&ts, NULL);
+
+    if (0 != tick%VMM_ADAPT_TICKS)
+      continue;
+
+    psi      = vmm_adapt_psi();
+    headroom = vmm_adapt_headroom();
+    if (0.0 > psi && -1 == headroom)
+      continue;
+
+    /*=======================================================================*/
+    IPC_INTER_CRITICAL_SECTION_BEG(ipc);
+    /*=======================================================================*/
+
+    t_mem = *ipc->t_mem;
+    l_mem = *ipc->l_mem;
+    used  = t_mem-*ipc->s_mem;
+    for (floor=0,i=0; i<(size_t)ipc->n_procs; ++i)
+      floor += IPC_FLOOR(ipc->slot[i]);
+
+    /*=======================================================================*/
+    IPC_INTER_CRITICAL_SECTION_END(ipc);
+    /*=======================================================================*/
+
+    if (VMM_ADAPT_PSI <= psi)
+      target = used-used/8;
+    else if (-1 != headroom)
+      target = used+(size_t)headroom/page_size-(size_t)headroom/page_size/8;
+    else
+      continue;
+
+    /* Never shrink below the memory guaranteed to the processes. */
+    if (target < floor)
+      target = floor;
+
+    /* Never grow beyond the limit set with M_MAXMEM, if any. */
+    if (0 != l_mem && target > l_mem)
+      target = l_mem;
+
+    /* Avoid resizing for small changes. */
+    if ((target > t_mem ? target-t_mem : t_mem-target) <= t_mem/VMM_ADAPT_HYST)
+      continue;
+
+    ret = ipc_mresize(ipc, target, _vmm_.opts&(VMM_ADMITD|VMM_ADMITF));
+    ASSERT(-1 != ret);
+  }
+
+  if (NULL == arg) {} /* suppress unused warning */
+
+  return NULL;
+}
+
+
+#ifdef TEST
+int
+main(int argc, char * argv[])
+{
+  if (0 == argc || NULL == argv) {}
+
+  return 0;
+}
+#endif
@@ -26,9 +26,15 @@ THE SOFTWARE.
 #endif
 
 
-#include <errno.h>  /* errno library */
-#include <signal.h> /* struct sigaction, siginfo_t, sigemptyset, sigaction */
-#include <stddef.h> /* NULL, size_t */
+#include <errno.h>       /* errno library */
+#include <limits.h>      /* INT_MAX */
+#include <linux/futex.h> /* FUTEX_WAKE */
+#include <pthread.h>     /* pthread_join */
+#include <signal.h>      /* sigaction */
+#include <stddef.h>      /* NULL, size_t */
+#include <sys/mman.h>    /* munmap */
+#include <sys/syscall.h> /* SYS_futex */
+#include <unistd.h>      /* STDERR_FILENO, syscall */
 #include "common.h"
 #include "ipc.h"
 #include "lock.h"
@@ -40,6 +46,8 @@ SBMA_EXTERN int
 vmm_destroy(struct vmm * const vmm)
 {
   int retval;
+  size_t i;
+  struct sbma_ticket * tkt;
 
   /* Default return value. */
   retval = 0;
@@ -54,14 +62,81 @@ vmm_destroy(struct vmm * const vmm)
   retval = sigaction(SIGSEGV, &(vmm->oldact_segv), NULL);
   ERRCHK(FATAL, -1 == retval);
 
-  /* reset signal handler for SIGIPC */
-  retval = sigaction(SIGIPC, &(vmm->oldact_ipc), NULL);
+  /* stop adaptation thread, which may still be serving eviction requests */
+  if (1 == vmm->adapt) {
+    vmm->adapt = 0;
+    retval = pthread_join(vmm->adaptor, NULL);
+    ERRCHK(FATAL, 0 != retval);
+  }
+
+  /* stop I/O threads, which may be waiting on admissions served by the
+   * eviction thread, and fail any prefetches they did not start */
+  if (1 == vmm->io) {
+    vmm->io = 0;
+    (void)__sync_fetch_and_add(&(vmm->io_event), 1);
+    (void)syscall(SYS_futex, &(vmm->io_event), FUTEX_WAKE, INT_MAX, NULL,\
+      NULL, 0);
+    for (i=0; i<VMM_IO_THREADS; ++i) {
+      retval = pthread_join(vmm->io_thread[i], NULL);
+      ERRCHK(FATAL, 0 != retval);
+    }
+  }
+  while (NULL != (tkt=vmm->io_head)) {
+    vmm->io_head = tkt->next;
+    IPC_TICKET_DONE(tkt, -1);
+  }
+  vmm->io_tail = NULL;
+
+  /* release the fault log, whose prefetches have all completed */
+  if (NULL != vmm->rec_log) {
+    retval = munmap(vmm->rec_log, vmm->rec_max*sizeof(*vmm->rec_log));
+    ERRCHK(FATAL, -1 == retval);
+    vmm->rec_log = NULL;
+  }
+  vmm->rec     = 0;
+  vmm->rec_num = 0;
+  vmm->rec_max = 0;
+
+  /* stop eviction thread */
+  vmm->evict = 0;
+  IPC_MBOX_POST(&(vmm->ipc.mbox[vmm->ipc.id]));
+  retval = pthread_join(vmm->evictor, NULL);
+  ERRCHK(FATAL, 0 != retval);
+
+  /* serve any eviction requests which arrived after the thread stopped, so
+   * that no process is left waiting on this one */
+  retval = ipc_mserve(&(vmm->ipc), 1);
   ERRCHK(FATAL, -1 == retval);
+  retval = 0;
+
+  /* report the allocation sites, once no more I/O is done, and store the
+   * policies learned for them */
+  if (VMM_SITES == (vmm->opts&VMM_SITES)) {
+    retval = vmm_site_report(vmm, STDERR_FILENO);
+    ERRCHK(RETURN, -1 == retval);
+  }
+  if (VMM_PROF == (vmm->opts&VMM_PROF)) {
+    retval = vmm_prof_save(vmm);
+    ERRCHK(RETURN, -1 == retval);
+  }
 
   /* destroy mmu */
   retval = mmu_destroy(&(vmm->mmu));
   ERRCHK(RETURN, 0 != retval);
 
+  /* release the table of allocation sites, which the ates pointed into */
+  if (NULL != vmm->sites) {
+    retval = munmap(vmm->sites, VMM_SITE_MAX*sizeof(*vmm->sites));
+    ERRCHK(RETURN, -1 == retval);
+    vmm->sites = NULL;
+  }
+  if (NULL != vmm->prof) {
+    retval = munmap(vmm->prof, VMM_SITE_MAX*sizeof(*vmm->prof));
+    ERRCHK(RETURN, -1 == retval);
+    vmm->prof     = NULL;
+    vmm->prof_num = 0;
+  }
+
   /* destroy ipc */
   retval = ipc_destroy(&(vmm->ipc));
   ERRCHK(RETURN, 0 != retval);
@@ -70,6 +145,18 @@ vmm_destroy(struct vmm * const vmm)
   retval = lock_free(&(vmm->lock));
   ERRCHK(RETURN, 0 != retval);
 
+  /* destroy vmm statistics lock */
+  retval = lock_free(&(vmm->stat_lock));
+  ERRCHK(RETURN, 0 != retval);
+
+  /* destroy prefetch queue lock */
+  retval = lock_free(&(vmm->io_lock));
+  ERRCHK(RETURN, 0 != retval);
+
+  /* destroy fault log lock */
+  retval = lock_free(&(vmm->rec_lock));
+  ERRCHK(RETURN, 0 != retval);
+
   /***************************************************************************/
   /* Successful exit -- return 0. */
   /***************************************************************************/
@@ -26,14 +26,16 @@ THE SOFTWARE.
 #endif
 
 
-#include <errno.h>    /* errno library */
-#include <signal.h>   /* struct sigaction, siginfo_t, sigemptyset, sigaction */
-#include <stddef.h>   /* NULL, size_t */
-#include <stdint.h>   /* uint8_t, uintptr_t */
-#include <stdio.h>    /* FILENAME_MAX */
-#include <string.h>   /* strncpy */
-#include <sys/mman.h> /* mprotect */
-#include <time.h>     /* struct timespec */
+#include <errno.h>     /* errno library */
+#include <pthread.h>   /* pthread library */
+#include <signal.h>    /* struct sigaction, siginfo_t, sigemptyset, sigaction */
+#include <stddef.h>    /* NULL, size_t */
+#include <stdint.h>    /* uint8_t, uintptr_t */
+#include <stdio.h>     /* FILENAME_MAX */
+#include <string.h>    /* strncpy */
+#include <sys/mman.h>  /* mprotect */
+#include <sys/types.h> /* ssize_t */
+#include <time.h>      /* struct timespec */
 #include "common.h"
 #include "ipc.h"
 #include "lock.h"
@@ -50,9 +52,9 @@ THE SOFTWARE.
 SBMA_STATIC void
 vmm_sigsegv(int const sig, siginfo_t * const si, void * const ctx)
 {
-  int ret;
-  size_t ip, page_size, _len;
-  uintptr_t addr;
+  int ret, group, io;
+  size_t ip, jp, kp, page_size, _len, n_ra;
+  uintptr_t addr, base;
   void * _addr;
   volatile uint8_t * flags;
   struct ate * ate;
@@ -61,19 +63,107 @@ vmm_sigsegv(int const sig, siginfo_t * const si, void * const ctx)
   ASSERT(SIGSEGV == sig);
 
   /* setup local variables */
-  page_size = _vmm_.page_size;
-  addr      = (uintptr_t)si->si_addr;
+  addr = (uintptr_t)si->si_addr;
 
   /* lookup allocation table entry */
   ate = mmu_lookup_ate(&(_vmm_.mmu), (void*)addr);
   ASSERT((struct ate*)-1 != ate);
   ASSERT(NULL != ate);
 
+  page_size = ate->page_size;
+
   ip    = (addr-ate->base)/page_size;
   flags = ate->flags;
 
-  if (MMU_RSDNT == (flags[ip]&MMU_RSDNT)) {
-    if (VMM_LZYRD == (_vmm_.opts&VMM_LZYRD)) {
+  if (MMU_RSDNT == (flags[ip]&MMU_RSDNT) && 0 != ate->group) {
+    /* A group is loaded as a unit. The ate lock is released first, since
+     * the members are locked in order of address. */
+    VMM_SITE_TRACK(ate, numrf, 1);
+
+    io    = (MMU_ZFILL == (flags[ip]&MMU_ZFILL));
+    group = ate->group;
+    base  = ate->base;
+    _addr = (void*)(ate->base+ip*page_size);
+    _len  = page_size;
+
+    ret = lock_let(&(ate->lock));
+    ASSERT(-1 != ret);
+
+    ret = sbma_mgroup_touch(group);
+    ASSERT(-1 != ret);
+
+    if (-2 == ret) {
+      /* The group does not fit in the memory of the system, so the page is
+       * loaded on its own instead. */
+      ate = mmu_lookup_ate(&(_vmm_.mmu), (void*)addr);
+      ASSERT((struct ate*)-1 != ate);
+      ASSERT(NULL != ate);
+
+      page_size = ate->page_size;
+
+      ip    = (addr-ate->base)/page_size;
+      flags = ate->flags;
+      group = 0;
+    }
+    else {
+      VMM_TRACK(&_vmm_, numrf, 1);
+      VMM_TRACK(&_vmm_, numrfio, io);
+
+      if (1 == _vmm_.rec) {
+        ret = vmm_record(&_vmm_, base, _addr, _len);
+        ASSERT(-1 != ret);
+      }
+    }
+  }
+  else {
+    group = 0;
+  }
+
+  if (0 != group) {
+    /* the page was loaded with its group */
+  }
+  else if (MMU_RSDNT == (flags[ip]&MMU_RSDNT)) {
+    /* Advice given for the page overrides the read granularity of the
+     * runtime options. */
+    if (MMU_ADVSQ == (flags[ip]&MMU_ADVSQ)) {
+      for (jp=ip+1; jp<ate->n_pages && jp-ip<VMM_READAHEAD; ++jp) {
+        if (MMU_ADVSQ != (flags[jp]&MMU_ADVSQ))
+          break;
+      }
+      _addr = (void*)(ate->base+ip*page_size);
+      _len  = (jp-ip)*page_size;
+    }
+    else if (MMU_ADVRN == (flags[ip]&MMU_ADVRN)) {
+      _addr = (void*)(ate->base+ip*page_size);
+      _len  = page_size;
+    }
+    /* Otherwise, the read granularity may be learned from the fraction of
+     * the allocation which was loaded before it was last evicted. */
+    else if (VMM_LEARN == (ate->opts&VMM_LEARN)) {
+      if (VMM_LEARN_LO > ate->r_frac ||\
+          0 == (ate->r_cnt+1)%VMM_LEARN_PROBE)
+      {
+        _addr = (void*)(ate->base+ip*page_size);
+        _len  = page_size;
+      }
+      else if (VMM_LEARN_HI <= ate->r_frac) {
+        _addr = (void*)ate->base;
+        _len  = ate->n_pages*page_size;
+
+        ate->r_bulk = 1;
+      }
+      else {
+        jp    = ip-ip%VMM_READAHEAD;
+        _addr = (void*)(ate->base+jp*page_size);
+        if (jp+VMM_READAHEAD < ate->n_pages)
+          _len = VMM_READAHEAD*page_size;
+        else
+          _len = (ate->n_pages-jp)*page_size;
+
+        ate->r_bulk = 1;
+      }
+    }
+    else if (VMM_LZYRD == (ate->opts&VMM_LZYRD)) {
       _addr = (void*)(ate->base+ip*page_size);
       _len  = page_size;
     }
@@ -82,40 +172,69 @@ vmm_sigsegv(int const sig, siginfo_t * const si, void * const ctx)
       _len  = ate->n_pages*page_size;
     }
 
+    /* Mark the pages which are read ahead of the faulting page, so that a
+     * later write to one of them is counted as a readahead hit. */
+    io = (MMU_ZFILL == (flags[ip]&MMU_ZFILL));
+    jp = ((uintptr_t)_addr-ate->base)/page_size;
+    for (n_ra=0,kp=jp; kp<jp+_len/page_size; ++kp) {
+      if (kp != ip && MMU_RSDNT == (flags[kp]&MMU_RSDNT)) {
+        flags[kp] |= MMU_RDAHD;
+        n_ra++;
+      }
+    }
+
     ret = sbma_mtouch(ate, _addr, _len);
     ASSERT(-1 != ret);
 
+    /* a fault in a group was counted before the group was tried */
+    if (0 == ate->group)
+      VMM_SITE_TRACK(ate, numrf, 1);
+
+    base = ate->base;
+
     ret = lock_let(&(ate->lock));
     ASSERT(-1 != ret);
 
-    VMM_INTRA_CRITICAL_SECTION_BEG(&_vmm_);
     VMM_TRACK(&_vmm_, numrf, 1);
-    VMM_INTRA_CRITICAL_SECTION_END(&_vmm_);
+    VMM_TRACK(&_vmm_, numrfio, io);
+    VMM_TRACK(&_vmm_, bytra, n_ra*page_size);
+
+    /* The read is recorded once the ate lock is released, see
+     * vmm_record(). */
+    if (1 == _vmm_.rec) {
+      ret = vmm_record(&_vmm_, base, _addr, _len);
+      ASSERT(-1 != ret);
+    }
   }
   else {
     /* sanity check */
     ASSERT(MMU_DIRTY != (flags[ip]&MMU_DIRTY)); /* not dirty */
 
+    /* a page read ahead of an earlier fault was used */
+    n_ra = (MMU_RDAHD == (flags[ip]&MMU_RDAHD));
+
     /* flag: 100 */
-    flags[ip] = MMU_DIRTY;
+    flags[ip] = (flags[ip]&MMU_ATTRS)|MMU_DIRTY;
 
     /* update protection to read-write */
     ret = mprotect((void*)(ate->base+(ip*page_size)), page_size,\
       PROT_READ|PROT_WRITE);
     ASSERT(-1 != ret);
 
-    /* release lock on alloction table entry */
-    ret = lock_let(&(ate->lock));
+    /* increase count of dirty pages before releasing the lock, so that the
+     * eviction thread never cleans the page before it has been counted */
+    ate->d_pages++;
+    ret = ipc_mdirty(&(_vmm_.ipc), VMM_TO_SYS(page_size, 1));
     ASSERT(-1 != ret);
 
-    /* increase count of dirty pages */
-    ate->d_pages++;
-    ret = ipc_mdirty(&(_vmm_.ipc), VMM_TO_SYS(1));
+    VMM_SITE_TRACK(ate, numwf, 1);
+
+    /* release lock on alloction table entry */
+    ret = lock_let(&(ate->lock));
     ASSERT(-1 != ret);
 
-    VMM_INTRA_CRITICAL_SECTION_BEG(&_vmm_);
     VMM_TRACK(&_vmm_, numwf, 1);
-    VMM_INTRA_CRITICAL_SECTION_END(&_vmm_);
+    VMM_TRACK(&_vmm_, bytrh, n_ra*page_size);
   }
 
   if (NULL == ctx) {} /* suppress unused warning */
@@ -123,65 +242,339 @@ vmm_sigsegv(int const sig, siginfo_t * const si, void * const ctx)
 
 
 /*****************************************************************************/
-/*  SIGIPC handler.                                                          */
+/*  Evict an allocation, unless it is in use by the application, i.e., its   */
+/*  lock is held, and add the system pages released, of which dirty, and     */
+/*  written to c_pages, d_pages and numwr. At most max system pages are      */
+/*  released, so if the allocation holds more, only as many of its pages,    */
+/*  from the start, are evicted.                                             */
 /*                                                                           */
 /*  MT-Safe                                                                  */
 /*****************************************************************************/
-SBMA_STATIC void
-vmm_sigipc(int const sig, siginfo_t * const si, void * const ctx)
+SBMA_STATIC int
+vmm_evict_ate(struct ate * const ate, size_t const max, size_t * const c_pages,
+              size_t * const d_pages, size_t * const numwr)
 {
   int ret;
-  size_t c_pages, d_pages, numwr;
+  size_t ip, np, s_pages, c_beg, d_beg;
+  ssize_t numwr_;
+
+  if (0 == max)
+    return 0;
+
+  ret = lock_try(&(ate->lock));
+  if (EBUSY == ret)
+    return 0;
+  ERRCHK(ERREXIT, 0 != ret);
+
+  c_beg = ate->c_pages;
+  d_beg = ate->d_pages;
+
+  /* Count in system pages, since allocations may differ in page size. */
+  if (VMM_TO_SYS(ate->page_size, ate->c_pages-ate->p_pages) <= max) {
+    numwr_ = vmm_swap_o(ate, 0, ate->n_pages);
+    ERRCHK(CLEANUP, -1 == numwr_);
+    *numwr += VMM_TO_SYS(ate->page_size, numwr_);
+
+    /* Pinned pages remain resident and charged. */
+    ASSERT(ate->l_pages == ate->p_pages);
+    ASSERT(ate->c_pages == ate->p_pages);
+  }
+  else {
+    /* Each page of a range releases at most one page, so a range no longer
+     * than the pages left to release never releases too many. */
+    s_pages = VMM_TO_SYS(ate->page_size, 1);
+    for (ip=0; ip<ate->n_pages; ip+=np) {
+      np = (max-VMM_TO_SYS(ate->page_size, c_beg-ate->c_pages))/s_pages;
+      if (0 == np)
+        break;
+      if (np > ate->n_pages-ip)
+        np = ate->n_pages-ip;
+
+      numwr_ = vmm_swap_o(ate, ip, np);
+      ERRCHK(CLEANUP, -1 == numwr_);
+      *numwr += VMM_TO_SYS(ate->page_size, numwr_);
+    }
+  }
+
+  *c_pages += VMM_TO_SYS(ate->page_size, c_beg-ate->c_pages);
+  *d_pages += VMM_TO_SYS(ate->page_size, d_beg-ate->d_pages);
+
+  ret = lock_let(&(ate->lock));
+  ERRCHK(ERREXIT, 0 != ret);
+
+  return 0;
+
+  CLEANUP:
+  ret = lock_let(&(ate->lock));
+  ASSERT(0 == ret);
+  ERREXIT:
+  return -1;
+}
+
+
+/*****************************************************************************/
+/*  Evict max system pages of the process's memory, if possible, without     */
+/*  waiting for any thread of the application. Memory which is in use by the */
+/*  application, i.e., whose lock is held, is skipped. Whole allocations are */
+/*  evicted, together with the other members of their group, see             */
+/*  sbma_mgroup_add(), but never more than max pages, so the last allocation */
+/*  or group evicted may only be evicted in part.                            */
+/*                                                                           */
+/*  MT-Safe                                                                  */
+/*****************************************************************************/
+SBMA_STATIC int
+vmm_evict(int const n_req, size_t const max, size_t * const c_pages,
+          size_t * const d_pages)
+{
+  int ret, prio;
+  size_t c_pages_, d_pages_, numwr;
   struct timespec tmr;
+  struct ate * ate, * gate;
+
+  c_pages_ = 0;
+  d_pages_ = 0;
+  numwr    = 0;
+
+  /*=========================================================================*/
+  TIMER_START(&(tmr));
+  /*=========================================================================*/
+
+  /* Hold the mmu lock while walking the allocation table, so that entries are
+   * not removed from under the walk. */
+  ret = lock_try(&(_vmm_.mmu.lock));
+  if (0 == ret) {
+    /* Evict cold allocations first and hot allocations last. */
+    for (prio=MMU_COLD; prio<=MMU_PHASE; ++prio) {
+      for (ate=_vmm_.mmu.a_tbl; NULL!=ate; ate=ate->next) {
+        if (c_pages_ >= max)
+          break;
+        if (prio != MMU_PRIO(ate))
+          continue;
+
+        ret = vmm_evict_ate(ate, max-c_pages_, &c_pages_, &d_pages_,\
+          &numwr);
+        ERRCHK(CLEANUP, -1 == ret);
+
+        /* A group is evicted as a unit. */
+        if (0 == ate->group)
+          continue;
+        for (gate=_vmm_.mmu.a_tbl; NULL!=gate; gate=gate->next) {
+          if (gate == ate || gate->group != ate->group)
+            continue;
+          ret = vmm_evict_ate(gate, max-c_pages_, &c_pages_, &d_pages_,\
+            &numwr);
+          ERRCHK(CLEANUP, -1 == ret);
+        }
+      }
+    }
 
-  /* Sanity check: make sure we received a SIGIPC. */
-  ASSERT(SIGIPC <= SIGRTMAX);
-  ASSERT(SIGIPC == sig);
-
-  /* Only honor the SIGIPC if my status is still eligible. */
-  if (ipc_is_eligible(&(_vmm_.ipc), _vmm_.ipc.id)) {
-    /* XXX Is it possible / what happens / does it matter if the process
-     * receives a SIGIPC at this point in the execution of the signal handler?
-     * */
-    /* XXX This is not possible according to signal.h man pages. There it
-     * states that ``In addition, the signal which triggered the handler will
-     * be blocked, unless the SA_NODEFER flag is used.''. In the current code,
-     * SA_NODEFER is not used. */
-
-    /*=======================================================================*/
-    TIMER_START(&(tmr));
-    /*=======================================================================*/
-
-    /* Evict all memory. */
-    ret = sbma_mevictall_int(&c_pages, &d_pages, &numwr);
-    ASSERT(-1 != ret);
+    ret = lock_let(&(_vmm_.mmu.lock));
+    ERRCHK(ERREXIT, 0 != ret);
+  }
+  else {
+    ERRCHK(ERREXIT, EBUSY != ret);
+  }
 
-    /* Update ipc memory statistics. */
-    ipc_atomic_dec(&(_vmm_.ipc), c_pages, d_pages);
+  /*=========================================================================*/
+  TIMER_STOP(&(tmr));
+  /*=========================================================================*/
+
+  *c_pages = c_pages_;
+  *d_pages = d_pages_;
+
+  /* Track number of eviction requests received and time taken evicting,
+   * and, if any memory was released, bytes written to disk, time taken for
+   * writing, and number of eviction requests honored. */
+  VMM_TRACK(&_vmm_, numipc, n_req);
+  VMM_TRACK(&_vmm_, tmrev, VMM_TO_NSEC(&(tmr)));
+  if (0 != c_pages_) {
+    VMM_TRACK(&_vmm_, bytwr, VMM_SYS_BYTES(numwr));
+    VMM_TRACK(&_vmm_, tmrwr, VMM_TO_NSEC(&(tmr)));
+    VMM_TRACK(&_vmm_, numhipc, n_req);
+  }
 
-    /*=======================================================================*/
-    TIMER_STOP(&(tmr));
-    /*=======================================================================*/
+  return 0;
 
-    /* Track number of number of syspages written to disk, time taken for
-     * writing, and number of SIGIPC honored. */
-    VMM_INTRA_CRITICAL_SECTION_BEG(&_vmm_);
-    VMM_TRACK(&_vmm_, numwr, numwr);
-    VMM_TRACK(&_vmm_, tmrwr, (double)tmr.tv_sec+(double)tmr.tv_nsec/1000000000.0);
-    VMM_TRACK(&_vmm_, numhipc, 1);
-    VMM_INTRA_CRITICAL_SECTION_END(&_vmm_);
+  CLEANUP:
+  ret = lock_let(&(_vmm_.mmu.lock));
+  ASSERT(0 == ret);
+  ERREXIT:
+  return -1;
+}
+
+
+/*****************************************************************************/
+/*  Check if the process should clean some of its dirty memory, i.e., if     */
+/*  signaling is enabled and more than 100-_vmm_.flush percent of its        */
+/*  resident memory is dirty.                                                */
+/*                                                                           */
+/*  MP-Unsafe race:rd(ipc->slot[ipc->id].*)                                  */
+/*  MT-Safe                                                                  */
+/*****************************************************************************/
+SBMA_STATIC int
+vmm_flush_due(void)
+{
+  int flush;
+  volatile struct ipc_slot * slot;
+
+  flush = _vmm_.flush;
+  slot  = &(_vmm_.ipc.slot[_vmm_.ipc.id]);
+
+  if (0 == flush || IPC_SIGON != (slot->flags&IPC_SIGON))
+    return 0;
+  return (100*slot->d_mem > (size_t)(100-flush)*slot->c_mem);
+}
+
+
+/*****************************************************************************/
+/*  Write dirty memory of the process to disk, keeping it resident, until    */
+/*  vmm_flush_due() no longer holds, so that a later eviction request only   */
+/*  has to drop clean pages. Memory which is in use by the application is    */
+/*  skipped, and cleaning stops as soon as an eviction request arrives, so   */
+/*  that requests are served first. Whole allocations are cleaned, so more   */
+/*  memory than necessary may be written. Returns 1 if cleaning should be    */
+/*  retried, 0 otherwise.                                                    */
+/*                                                                           */
+/*  MT-Safe                                                                  */
+/*****************************************************************************/
+SBMA_STATIC int
+vmm_flush(void)
+{
+  int ret, retval, prio, done;
+  ssize_t numwr, numwr_;
+  struct timespec tmr;
+  struct ate * ate;
+  volatile struct ipc_mbox * mbox;
+
+  /* Shortcut if there is nothing to clean. */
+  if (0 == vmm_flush_due())
+    return 0;
+
+  retval = 0;
+  numwr  = 0;
+  mbox   = &(_vmm_.ipc.mbox[_vmm_.ipc.id]);
+
+  /*=========================================================================*/
+  TIMER_START(&(tmr));
+  /*=========================================================================*/
+
+  ret = lock_try(&(_vmm_.mmu.lock));
+  if (0 == ret) {
+    /* Clean cold allocations first, and hot allocations, which are likely
+     * to be written again, last. */
+    for (done=0,prio=MMU_COLD; prio<=MMU_PHASE&&0==done; ++prio) {
+      for (ate=_vmm_.mmu.a_tbl; NULL!=ate; ate=ate->next) {
+        if (0 != mbox->count) {
+          retval = 1;
+          done   = 1;
+          break;
+        }
+        if (0 == vmm_flush_due()) {
+          done = 1;
+          break;
+        }
+        if (prio != MMU_PRIO(ate) || 0 == ate->d_pages)
+          continue;
+
+        ret = lock_try(&(ate->lock));
+        if (EBUSY == ret) {
+          retval = 1;
+          continue;
+        }
+        ERRCHK(CLEANUP1, 0 != ret);
+
+        numwr_ = vmm_swap_c(ate, 0, ate->n_pages);
+        ERRCHK(CLEANUP2, -1 == numwr_);
+        numwr_ = VMM_TO_SYS(ate->page_size, numwr_);
+        numwr += numwr_;
+
+        ret = lock_let(&(ate->lock));
+        ERRCHK(CLEANUP1, 0 != ret);
+
+        ret = ipc_mdirty(&(_vmm_.ipc), -numwr_);
+        ERRCHK(CLEANUP1, -1 == ret);
+      }
+    }
+
+    ret = lock_let(&(_vmm_.mmu.lock));
+    ERRCHK(ERREXIT, 0 != ret);
+  }
+  else {
+    ERRCHK(ERREXIT, EBUSY != ret);
+    retval = 1;
   }
 
-  /* Signal to the waiting process that the memory has been released. */
-  ret = sem_post(_vmm_.ipc.done);
-  ASSERT(-1 != ret);
+  /*=========================================================================*/
+  TIMER_STOP(&(tmr));
+  /*=========================================================================*/
+
+  if (0 != numwr) {
+    VMM_TRACK(&_vmm_, bytwr, VMM_SYS_BYTES(numwr));
+    VMM_TRACK(&_vmm_, tmrwr, VMM_TO_NSEC(&(tmr)));
+  }
+
+  return retval;
+
+  CLEANUP2:
+  ret = lock_let(&(ate->lock));
+  ASSERT(0 == ret);
+  CLEANUP1:
+  ret = lock_let(&(_vmm_.mmu.lock));
+  ASSERT(0 == ret);
+  ERREXIT:
+  return -1;
+}
+
 
-  /* Track the number of SIGIPC received. */
-  VMM_INTRA_CRITICAL_SECTION_BEG(&_vmm_);
-  VMM_TRACK(&_vmm_, numipc, 1);
-  VMM_INTRA_CRITICAL_SECTION_END(&_vmm_);
+/*****************************************************************************/
+/*  Eviction thread. Serves the eviction requests made to the process by     */
+/*  other processes, admits the memory of asynchronous admission tickets,    */
+/*  see SBMA_madmit_async(), and, while the process has signaling enabled,   */
+/*  cleans its dirty memory, see M_FLUSH.                                    */
+/*                                                                           */
+/*  MT-Safe                                                                  */
+/*****************************************************************************/
+SBMA_STATIC void *
+vmm_evictor(void * const arg)
+{
+  int event, pending;
+  ssize_t ret;
+  struct timespec ts_tkt, ts_flush;
+  volatile struct ipc_mbox * mbox;
+
+  mbox = &(_vmm_.ipc.mbox[_vmm_.ipc.id]);
+
+  ts_tkt.tv_sec    = 0;
+  ts_tkt.tv_nsec   = IPC_WAIT_NSEC;
+  ts_flush.tv_sec  = 0;
+  ts_flush.tv_nsec = VMM_FLUSH_NSEC;
+
+  while (1 == _vmm_.evict) {
+    /* Cache the event counter before serving, so that a request which
+     * arrives while serving is not missed. */
+    event = mbox->event;
+
+    ret = ipc_mserve(&(_vmm_.ipc), 1);
+    ASSERT(-1 != ret);
+
+    pending = ipc_mgrant(&(_vmm_.ipc), _vmm_.opts&(VMM_ADMITD|VMM_ADMITF));
+    ASSERT(-1 != pending);
 
-  if (NULL == si || NULL == ctx) {}
+    ret = vmm_flush();
+    ASSERT(-1 != ret);
+
+    /* Re-check the system state after a while if a ticket is still pending,
+     * in case memory was released without this process being told, and
+     * retry cleaning after a while if some dirty memory was in use. */
+    if (1 == pending)
+      IPC_MBOX_WAIT(mbox, event, &ts_tkt);
+    else
+      IPC_MBOX_WAIT(mbox, event, (1 == ret) ? &ts_flush : NULL);
+  }
+
+  if (NULL == arg) {} /* suppress unused warning */
+
+  return NULL;
 }
 
 
@@ -191,6 +584,7 @@ vmm_init(struct vmm * const vmm, char const * const fstem, int const uniq,
          int const opts)
 {
   int retval;
+  sigset_t set, oldset;
 
   /* Default return value. */
   retval = 0;
@@ -202,22 +596,25 @@ vmm_init(struct vmm * const vmm, char const * const fstem, int const uniq,
   if (VMM_INVLD == (opts&VMM_INVLD))
     goto ERREXIT;
 
-  /* Set page size. */
+  /* Set page size, large allocations use the same page size by default. */
   vmm->page_size = page_size;
+  vmm->big_size  = page_size;
 
   /* Set options. */
   vmm->opts = opts;
 
-  /* Initialize statistics. */
-  vmm->numipc   = 0;
-  vmm->numhipc  = 0;
-  vmm->numrf    = 0;
-  vmm->numwf    = 0;
-  vmm->numrd    = 0;
-  vmm->numwr    = 0;
-  vmm->tmrrd    = 0.0;
-  vmm->tmrwr    = 0.0;
-  vmm->numpages = 0;
+  /* No allocation groups have been created. */
+  vmm->groups = 0;
+
+  /* Memory is only written when it is evicted by default. */
+  vmm->flush = 0;
+
+  /* Initialize ipc first, since joining fails without side effects if every
+   * process slot is taken. This also resets the statistics of the process,
+   * see struct sbma_stats. */
+  retval = ipc_init(&(vmm->ipc), uniq, n_procs, max_mem);
+  ERRCHK(ERREXIT, -1 == retval);
+  vmm->ipc.evict = vmm_evict;
 
   /* Copy file stem. */
   strncpy(vmm->fstem, fstem, FILENAME_MAX-1);
@@ -231,25 +628,65 @@ vmm_init(struct vmm * const vmm, char const * const fstem, int const uniq,
   retval = sigaction(SIGSEGV, &(vmm->act_segv), &(vmm->oldact_segv));
   ERRCHK(FATAL, -1 == retval);
 
-  /* Setup the signal handler for SIGIPC. */
-  vmm->act_ipc.sa_flags     = SA_SIGINFO;
-  vmm->act_ipc.sa_sigaction = vmm_sigipc;
-  retval = sigemptyset(&(vmm->act_ipc.sa_mask));
+  /* Initialize mmu. */
+  retval = mmu_init(&(vmm->mmu), page_size);
   ERRCHK(FATAL, -1 == retval);
-  retval = sigaction(SIGIPC, &(vmm->act_ipc), &(vmm->oldact_ipc));
+
+  /* Initialize vmm lock. */
+  retval = lock_init(&(vmm->lock));
   ERRCHK(FATAL, -1 == retval);
 
-  /* Initialize mmu. */
-  retval = mmu_init(&(vmm->mmu), page_size);
+  /* Initialize vmm statistics lock. */
+  retval = lock_init(&(vmm->stat_lock));
   ERRCHK(FATAL, -1 == retval);
 
-  /* Initialize ipc. */
-  retval = ipc_init(&(vmm->ipc), uniq, n_procs, max_mem);
+  /* Initialize prefetch queue, whose I/O threads are started on demand. */
+  vmm->io       = 0;
+  vmm->io_event = 0;
+  vmm->io_head  = NULL;
+  vmm->io_tail  = NULL;
+  retval = lock_init(&(vmm->io_lock));
   ERRCHK(FATAL, -1 == retval);
 
-  /* Initialize vmm lock. */
-  retval = lock_init(&(vmm->lock));
+  /* No faults are recorded until SBMA_mrecord() is called. */
+  vmm->rec      = 0;
+  vmm->rec_mark = 0;
+  vmm->rec_num  = 0;
+  vmm->rec_max  = 0;
+  vmm->rec_log  = NULL;
+  retval = lock_init(&(vmm->rec_lock));
+  ERRCHK(FATAL, -1 == retval);
+
+  /* Start the eviction and adaptation threads with all signals blocked, so
+   * that signals meant for the application are never delivered to them. */
+  retval = sigfillset(&set);
   ERRCHK(FATAL, -1 == retval);
+  retval = pthread_sigmask(SIG_BLOCK, &set, &oldset);
+  ERRCHK(FATAL, 0 != retval);
+  vmm->evict = 1;
+  retval = pthread_create(&(vmm->evictor), NULL, vmm_evictor, NULL);
+  ERRCHK(FATAL, 0 != retval);
+  /* The memory budget is adapted by the first process only. */
+  if (VMM_ADAPT == (opts&VMM_ADAPT) && 0 == vmm->ipc.id) {
+    vmm->adapt = 1;
+    retval = pthread_create(&(vmm->adaptor), NULL, vmm_adapt, NULL);
+    ERRCHK(FATAL, 0 != retval);
+  }
+  else {
+    vmm->adapt = 0;
+  }
+  retval = pthread_sigmask(SIG_SETMASK, &oldset, NULL);
+  ERRCHK(FATAL, 0 != retval);
+
+  /* Create the table of allocation sites last, since any memory allocated
+   * while it is created is allocated without a site. */
+  vmm->sites    = NULL;
+  vmm->prof     = NULL;
+  vmm->prof_num = 0;
+  if (0 != (opts&(VMM_SITES|VMM_PROF))) {
+    retval = vmm_site_init(vmm, opts&VMM_PROF);
+    ERRCHK(FATAL, -1 == retval);
+  }
 
   vmm->init = 1;
 
@@ -0,0 +1,212 @@
+/*
+Copyright (c) 2015,2016 Jeremy Iverson
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+
+#ifndef _GNU_SOURCE
+# define _GNU_SOURCE 1
+#endif
+
+
+#include <errno.h>       /* errno library */
+#include <linux/futex.h> /* FUTEX_WAIT, FUTEX_WAKE */
+#include <pthread.h>     /* pthread_create, pthread_sigmask */
+#include <signal.h>      /* sigset_t, sigfillset, sigdelset */
+#include <stddef.h>      /* NULL */
+#include <sys/syscall.h> /* SYS_futex */
+#include <sys/types.h>   /* ssize_t */
+#include <unistd.h>      /* syscall */
+#include "common.h"
+#include "ipc.h"
+#include "lock.h"
+#include "sbma.h"
+#include "vmm.h"
+
+
+/*****************************************************************************/
+/*  MT-Safe                                                                  */
+/*                                                                           */
+/*  Note:                                                                    */
+/*    1)  The threads wait on io_event with a raw futex, since the pthread   */
+/*        and semaphore waits are hooked when VMM_AUTOSIG is set.            */
+/*    2)  The application does not wait for the prefetch, so the memory is   */
+/*        read as for an allocation with ghost pages, i.e., each page is     */
+/*        made accessible only once its contents are in place.               */
+/*****************************************************************************/
+SBMA_EXTERN void *
+vmm_prefetch(void * const arg)
+{
+  int ret, event;
+  ssize_t numin;
+  struct sbma_ticket * tkt;
+
+  if (NULL == arg) {}
+
+  while (1 == _vmm_.io) {
+    event = _vmm_.io_event;
+
+    ret = lock_get(&(_vmm_.io_lock));
+    ERRCHK(FATAL, 0 != ret);
+    tkt = _vmm_.io_head;
+    if (NULL != tkt) {
+      _vmm_.io_head = tkt->next;
+      if (NULL == _vmm_.io_head)
+        _vmm_.io_tail = NULL;
+    }
+    ret = lock_let(&(_vmm_.io_lock));
+    ERRCHK(FATAL, 0 != ret);
+
+    if (NULL == tkt) {
+      (void)syscall(SYS_futex, &(_vmm_.io_event), FUTEX_WAIT, event, NULL,\
+        NULL, 0);
+      continue;
+    }
+
+    numin = sbma_mtouch_ex(NULL, tkt->addr, tkt->len, VMM_GHOST);
+    IPC_TICKET_DONE(tkt, (-1 == numin) ? -1 : 0);
+  }
+
+  return NULL;
+
+  /***************************************************************************/
+  /* Fatal error -- an unrecoverable error has occured, the runtime state
+   * cannot be reverted to its state before this function was called. */
+  /***************************************************************************/
+  FATAL:
+  FATAL_ABORT(errno);
+}
+
+
+/*****************************************************************************/
+/*  MT-Safe                                                                  */
+/*****************************************************************************/
+SBMA_EXTERN int
+vmm_prefetch_push(struct vmm * const vmm, struct sbma_ticket * const tkt)
+{
+  int ret;
+  size_t i;
+  sigset_t set, oldset;
+
+  tkt->status = 1;
+  tkt->next   = NULL;
+
+  ret = lock_get(&(vmm->io_lock));
+  ERRCHK(FATAL, 0 != ret);
+
+  /* Start the I/O threads with all signals but SIGSEGV blocked. Unlike the
+   * eviction thread, they are started once memory is allocated, so that the
+   * allocations made by pthread_create() may fault on memory managed by the
+   * runtime, as may any made by the threads themselves. */
+  if (0 == vmm->io) {
+    ret = sigfillset(&set);
+    ERRCHK(FATAL, -1 == ret);
+    ret = sigdelset(&set, SIGSEGV);
+    ERRCHK(FATAL, -1 == ret);
+    ret = pthread_sigmask(SIG_BLOCK, &set, &oldset);
+    ERRCHK(FATAL, 0 != ret);
+    vmm->io = 1;
+    for (i=0; i<VMM_IO_THREADS; ++i) {
+      ret = pthread_create(&(vmm->io_thread[i]), NULL, vmm_prefetch, NULL);
+      ERRCHK(FATAL, 0 != ret);
+    }
+    ret = pthread_sigmask(SIG_SETMASK, &oldset, NULL);
+    ERRCHK(FATAL, 0 != ret);
+  }
+
+  if (NULL == vmm->io_tail)
+    vmm->io_head = tkt;
+  else
+    vmm->io_tail->next = tkt;
+  vmm->io_tail = tkt;
+
+  ret = lock_let(&(vmm->io_lock));
+  ERRCHK(FATAL, 0 != ret);
+
+  (void)__sync_fetch_and_add(&(vmm->io_event), 1);
+  (void)syscall(SYS_futex, &(vmm->io_event), FUTEX_WAKE, 1, NULL, NULL, 0);
+
+  return 0;
+
+  /***************************************************************************/
+  /* Fatal error -- an unrecoverable error has occured, the runtime state
+   * cannot be reverted to its state before this function was called. */
+  /***************************************************************************/
+  FATAL:
+  FATAL_ABORT(errno);
+}
+
+
+/*****************************************************************************/
+/*  MT-Safe                                                                  */
+/*                                                                           */
+/*  Note:                                                                    */
+/*    1)  A ticket which is not found has either been completed, or is being */
+/*        served by an I/O thread, so its status is about to change.         */
+/*****************************************************************************/
+SBMA_EXTERN int
+vmm_prefetch_cancel(struct vmm * const vmm, struct sbma_ticket * const tkt)
+{
+  int ret, retval;
+  struct sbma_ticket * prev, * cur;
+
+  retval = -1;
+
+  ret = lock_get(&(vmm->io_lock));
+  ERRCHK(FATAL, 0 != ret);
+
+  for (prev=NULL,cur=vmm->io_head; NULL!=cur; prev=cur,cur=cur->next) {
+    if (cur != tkt)
+      continue;
+
+    if (NULL == prev)
+      vmm->io_head = cur->next;
+    else
+      prev->next = cur->next;
+    if (vmm->io_tail == cur)
+      vmm->io_tail = prev;
+
+    retval = 0;
+    break;
+  }
+
+  ret = lock_let(&(vmm->io_lock));
+  ERRCHK(FATAL, 0 != ret);
+
+  return retval;
+
+  /***************************************************************************/
+  /* Fatal error -- an unrecoverable error has occured, the runtime state
+   * cannot be reverted to its state before this function was called. */
+  /***************************************************************************/
+  FATAL:
+  FATAL_ABORT(errno);
+}
+
+
+#ifdef TEST
+int
+main(int argc, char * argv[])
+{
+  if (0 == argc || NULL == argv) {}
+
+  return 0;
+}
+#endif
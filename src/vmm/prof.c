@@ -0,0 +1,252 @@
+/*
+Copyright (c) 2015,2016 Jeremy Iverson
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+
+#ifndef _GNU_SOURCE
+# define _GNU_SOURCE 1
+#endif
+
+
+#include <errno.h>     /* program_invocation_short_name */
+#include <fcntl.h>     /* O_RDONLY, O_WRONLY, O_CREAT, O_TRUNC */
+#include <stddef.h>    /* NULL, size_t */
+#include <stdint.h>    /* uint64_t */
+#include <stdio.h>     /* FILENAME_MAX, rename, snprintf */
+#include <sys/mman.h>  /* mmap, munmap */
+#include <sys/stat.h>  /* S_IRUSR, S_IWUSR */
+#include <sys/types.h> /* ssize_t */
+#include <unistd.h>    /* close, getpid, unlink */
+#include "common.h"
+#include "mmu.h"
+#include "sbma.h"
+#include "vmm.h"
+
+
+/*****************************************************************************/
+/*  Name of the profile of the program, which is shared by the processes of  */
+/*  the program which use the same file stem.                                */
+/*****************************************************************************/
+SBMA_STATIC int
+vmm_prof_name(struct vmm const * const vmm, char * const fname)
+{
+  int ret;
+
+  ret = snprintf(fname, FILENAME_MAX, "%ssbma-%s.prof", vmm->fstem,\
+    program_invocation_short_name);
+  if (0 > ret || FILENAME_MAX <= ret)
+    return -1;
+
+  return 0;
+}
+
+
+/*****************************************************************************/
+/*  MT-Unsafe race:vmm->prof                                                 */
+/*                                                                           */
+/*  Mitigation:                                                              */
+/*    1)  Call only before the table of allocation sites is published, see   */
+/*        vmm_site_init().                                                   */
+/*                                                                           */
+/*  Note:                                                                    */
+/*    1)  A profile which is missing, unreadable or of another version is    */
+/*        treated as empty, it is replaced at SBMA_destroy().                */
+/*****************************************************************************/
+SBMA_EXTERN int
+vmm_prof_load(struct vmm * const vmm)
+{
+  int ret, fd;
+  ssize_t len;
+  struct vmm_prof * prof;
+  struct vmm_prof_hdr hdr;
+  char fname[FILENAME_MAX];
+
+  prof = mmap(NULL, VMM_SITE_MAX*sizeof(*prof), PROT_READ|PROT_WRITE,\
+    MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+  if (MAP_FAILED == prof)
+    return -1;
+
+  vmm->prof     = prof;
+  vmm->prof_num = 0;
+
+  ret = vmm_prof_name(vmm, fname);
+  if (-1 == ret)
+    return 0;
+
+  fd = libc_open(fname, O_RDONLY);
+  if (-1 == fd)
+    return 0;
+
+  len = libc_read(fd, &hdr, sizeof(hdr));
+  if (sizeof(hdr) == len && VMM_PROF_MAGIC == hdr.magic &&\
+      VMM_PROF_VERSION == hdr.version && VMM_SITE_MAX >= hdr.num)
+  {
+    len = libc_read(fd, prof, hdr.num*sizeof(*prof));
+    if ((ssize_t)(hdr.num*sizeof(*prof)) == len)
+      vmm->prof_num = hdr.num;
+  }
+
+  ret = close(fd);
+  if (-1 == ret)
+    return -1;
+
+  return 0;
+}
+
+
+/*****************************************************************************/
+/*  MT-Safe                                                                  */
+/*****************************************************************************/
+SBMA_EXTERN void
+vmm_prof_find(struct vmm * const vmm, struct vmm_site * const site)
+{
+  size_t i;
+
+  if (0 == site->pkey)
+    return;
+
+  for (i=0; i<vmm->prof_num; ++i) {
+    if (site->pkey == vmm->prof[i].pkey) {
+      site->prio = vmm->prof[i].prio;
+      site->opts = vmm->prof[i].opts;
+      return;
+    }
+  }
+}
+
+
+/*****************************************************************************/
+/*  MT-Unsafe race:vmm->sites                                                */
+/*                                                                           */
+/*  Mitigation:                                                              */
+/*    1)  Call only once no more memory is read or written, i.e., from       */
+/*        vmm_destroy().                                                     */
+/*                                                                           */
+/*  Note:                                                                    */
+/*    1)  The profile is written to a file of its own and renamed, so that   */
+/*        processes of the program which exit concurrently never leave a     */
+/*        torn profile, the last one to exit wins.                           */
+/*****************************************************************************/
+SBMA_EXTERN int
+vmm_prof_save(struct vmm * const vmm)
+{
+  int ret, fd, opts, prio;
+  size_t i, j, num;
+  ssize_t len;
+  struct vmm_site * site;
+  struct vmm_prof * prof;
+  struct vmm_prof_hdr hdr;
+  char fname[FILENAME_MAX], tname[FILENAME_MAX];
+
+  if (NULL == vmm->sites || NULL == vmm->prof)
+    return 0;
+
+  prof = mmap(NULL, VMM_SITE_MAX*sizeof(*prof), PROT_READ|PROT_WRITE,\
+    MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+  if (MAP_FAILED == prof)
+    return -1;
+
+  /* Learn the policy of the sites of this run. A site keeps the policy it
+   * had if its allocations were never evicted whole while read lazily, or
+   * if none of its memory was written. */
+  for (num=0,i=0; i<VMM_SITE_MAX; ++i) {
+    site = &(vmm->sites[i]);
+    if (0 == site->key || 0 == site->pkey)
+      continue;
+
+    opts = site->opts;
+    prio = site->prio;
+    if (0 != site->numsz) {
+      if (VMM_LEARN_HI <= (site->numld*VMM_LEARN_ONE)/site->numsz)
+        opts = 0;
+      else
+        opts = VMM_LZYRD|VMM_LEARN;
+    }
+    if (0 != site->numwr) {
+      if (site->numrd*VMM_PROF_RARE < site->numwr)
+        prio = MMU_COLD;
+      else
+        prio = MMU_WARM;
+    }
+    if (-1 == opts && MMU_WARM == prio)
+      continue;
+
+    prof[num].pkey = site->pkey;
+    prof[num].opts = opts;
+    prof[num].prio = prio;
+    num++;
+  }
+
+  /* Keep the policies of the sites which were not seen in this run. */
+  for (i=0; i<vmm->prof_num && num<VMM_SITE_MAX; ++i) {
+    for (j=0; j<num && prof[j].pkey!=vmm->prof[i].pkey; ++j);
+    if (j == num)
+      prof[num++] = vmm->prof[i];
+  }
+
+  hdr.magic   = VMM_PROF_MAGIC;
+  hdr.version = VMM_PROF_VERSION;
+  hdr.num     = num;
+
+  ret = vmm_prof_name(vmm, fname);
+  ERRCHK(CLEANUP1, -1 == ret);
+  ret = snprintf(tname, FILENAME_MAX, "%s.%d", fname, (int)getpid());
+  ERRCHK(CLEANUP1, 0 > ret || FILENAME_MAX <= ret);
+
+  fd = libc_open(tname, O_WRONLY|O_CREAT|O_TRUNC, S_IRUSR|S_IWUSR);
+  ERRCHK(CLEANUP1, -1 == fd);
+
+  len = libc_write(fd, &hdr, sizeof(hdr));
+  ERRCHK(CLEANUP2, sizeof(hdr) != len);
+  len = libc_write(fd, prof, num*sizeof(*prof));
+  ERRCHK(CLEANUP2, (ssize_t)(num*sizeof(*prof)) != len);
+
+  ret = close(fd);
+  ERRCHK(CLEANUP3, -1 == ret);
+
+  ret = rename(tname, fname);
+  ERRCHK(CLEANUP3, -1 == ret);
+
+  ret = munmap(prof, VMM_SITE_MAX*sizeof(*prof));
+  if (-1 == ret)
+    return -1;
+
+  return 0;
+
+  CLEANUP2:
+  (void)close(fd);
+  CLEANUP3:
+  (void)unlink(tname);
+  CLEANUP1:
+  (void)munmap(prof, VMM_SITE_MAX*sizeof(*prof));
+  return -1;
+}
+
+
+#ifdef TEST
+int
+main(int argc, char * argv[])
+{
+  if (0 == argc || NULL == argv) {}
+
+  return 0;
+}
+#endif
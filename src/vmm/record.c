@@ -0,0 +1,243 @@
+/*
+Copyright (c) 2015,2016 Jeremy Iverson
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+
+#ifndef _GNU_SOURCE
+# define _GNU_SOURCE 1
+#endif
+
+
+#include <errno.h>       /* errno library */
+#include <linux/futex.h> /* FUTEX_WAIT */
+#include <stddef.h>      /* NULL, size_t */
+#include <stdint.h>      /* uint8_t, uintptr_t */
+#include <sys/mman.h>    /* mmap, munmap */
+#include <sys/syscall.h> /* SYS_futex */
+#include <sys/types.h>   /* ssize_t */
+#include <unistd.h>      /* syscall */
+#include "common.h"
+#include "lock.h"
+#include "mmu.h"
+#include "sbma.h"
+#include "vmm.h"
+
+
+/*****************************************************************************/
+/*  MT-Safe                                                                  */
+/*                                                                           */
+/*  Note:                                                                    */
+/*    1)  The log is only moved while recording, when no prefetch queued by  */
+/*        vmm_replay() is pending, see vmm_record_reset().                   */
+/*    2)  No ate lock may be held by the caller, since vmm_replay() locks    */
+/*        allocations while holding the log lock.                            */
+/*****************************************************************************/
+SBMA_EXTERN int
+vmm_record(struct vmm * const vmm, uintptr_t const base, void * const addr,
+           size_t const len)
+{
+  int ret;
+  size_t max;
+  struct vmm_rec * log, * rec;
+
+  ret = lock_get(&(vmm->rec_lock));
+  ERRCHK(ERREXIT, 0 != ret);
+
+  /* A fault which continues the last one within the same allocation, as
+   * when an array is swept page by page, extends it. */
+  if (0 != vmm->rec_num) {
+    rec = &(vmm->rec_log[vmm->rec_num-1]);
+    if (rec->mark == vmm->rec_mark && rec->addr >= base &&\
+        rec->addr+rec->len == (uintptr_t)addr)
+    {
+      rec->len += len;
+      goto UNLOCK;
+    }
+  }
+
+  if (vmm->rec_num == vmm->rec_max) {
+    max = (0 == vmm->rec_max) ? VMM_REC_INIT : 2*vmm->rec_max;
+    log = mmap(NULL, max*sizeof(*log), PROT_READ|PROT_WRITE,\
+      MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+    ERRCHK(CLEANUP, MAP_FAILED == log);
+    if (NULL != vmm->rec_log) {
+      libc_memcpy(log, vmm->rec_log, vmm->rec_num*sizeof(*log));
+      ret = munmap(vmm->rec_log, vmm->rec_max*sizeof(*log));
+      ERRCHK(CLEANUP, -1 == ret);
+    }
+    vmm->rec_log = log;
+    vmm->rec_max = max;
+  }
+
+  rec = &(vmm->rec_log[vmm->rec_num++]);
+  rec->mark       = vmm->rec_mark;
+  rec->addr       = (uintptr_t)addr;
+  rec->len        = len;
+  rec->tkt.status = 0;
+
+  UNLOCK:
+  ret = lock_let(&(vmm->rec_lock));
+  ERRCHK(ERREXIT, 0 != ret);
+
+  return 0;
+
+  CLEANUP:
+  ret = lock_let(&(vmm->rec_lock));
+  ASSERT(0 == ret);
+  ERREXIT:
+  return -1;
+}
+
+
+/*****************************************************************************/
+/*  MT-Safe                                                                  */
+/*                                                                           */
+/*  Note:                                                                    */
+/*    1)  Only the pages which are not charged are counted against the free  */
+/*        memory, so faults whose memory is still resident cost nothing.     */
+/*    2)  The log is replayed circularly, so that the last phase of an       */
+/*        iteration prefetches for the first phase of the next one.          */
+/*    3)  Any allocation may be prefetched, since the I/O threads make its   */
+/*        pages accessible only once they are read, see vmm_prefetch().      */
+/*****************************************************************************/
+SBMA_EXTERN ssize_t
+vmm_replay(struct vmm * const vmm, int const mark)
+{
+  int ret;
+  size_t i, k, ip, beg, end, n_pages, avail, queued;
+  volatile uint8_t * flags;
+  struct vmm_rec * rec;
+  struct ate * ate;
+
+  ret = lock_get(&(vmm->rec_lock));
+  ERRCHK(ERREXIT, 0 != ret);
+
+  for (i=0; i<vmm->rec_num && mark!=vmm->rec_log[i].mark; ++i);
+
+  avail  = *vmm->ipc.s_mem+vmm->ipc.credit+vmm->ipc.slot[vmm->ipc.id].r_mem;
+  queued = 0;
+  for (k=0; i<vmm->rec_num && k<vmm->rec_num; ++k,i=(i+1)%vmm->rec_num) {
+    rec = &(vmm->rec_log[i]);
+
+    /* still being prefetched since an earlier replay */
+    if (1 == rec->tkt.status)
+      continue;
+
+    ate = mmu_lookup_ate(&(vmm->mmu), (void*)rec->addr);
+    ERRCHK(CLEANUP, (struct ate*)-1 == ate);
+    if (NULL == ate) /* freed since it was recorded */
+      continue;
+
+    beg = (rec->addr-ate->base)/ate->page_size;
+    end = beg+(rec->len+ate->page_size-1)/ate->page_size;
+    if (end > ate->n_pages)
+      end = ate->n_pages;
+
+    flags = ate->flags;
+    for (n_pages=0,ip=beg; ip<end; ++ip) {
+      if (MMU_CHRGD == (flags[ip]&MMU_CHRGD)) /* not charged */
+        n_pages++;
+    }
+    n_pages = VMM_TO_SYS(ate->page_size, n_pages);
+
+    ret = lock_let(&(ate->lock));
+    ERRCHK(CLEANUP, 0 != ret);
+
+    if (0 == n_pages)
+      continue;
+    if (queued+n_pages > avail)
+      break;
+
+    rec->tkt.addr = (void*)rec->addr;
+    rec->tkt.len  = rec->len;
+    rec->tkt.efd  = -1;
+    rec->tkt.cb   = NULL;
+    ret = vmm_prefetch_push(vmm, &(rec->tkt));
+    ERRCHK(CLEANUP, 0 != ret);
+
+    queued += n_pages;
+  }
+
+  ret = lock_let(&(vmm->rec_lock));
+  ERRCHK(ERREXIT, 0 != ret);
+
+  return (ssize_t)queued;
+
+  CLEANUP:
+  ret = lock_let(&(vmm->rec_lock));
+  ASSERT(0 == ret);
+  ERREXIT:
+  return -1;
+}
+
+
+/*****************************************************************************/
+/*  MT-Safe                                                                  */
+/*                                                                           */
+/*  Note:                                                                    */
+/*    1)  A prefetch which cannot be canceled is being served by an I/O      */
+/*        thread, so its status is about to change.                          */
+/*****************************************************************************/
+SBMA_EXTERN int
+vmm_record_reset(struct vmm * const vmm)
+{
+  int ret;
+  size_t i;
+  struct sbma_ticket * tkt;
+
+  ret = lock_get(&(vmm->rec_lock));
+  ERRCHK(ERREXIT, 0 != ret);
+
+  for (i=0; i<vmm->rec_num; ++i) {
+    tkt = &(vmm->rec_log[i].tkt);
+    if (1 != tkt->status)
+      continue;
+
+    if (0 == vmm_prefetch_cancel(vmm, tkt)) {
+      tkt->status = -1;
+      continue;
+    }
+    while (1 == tkt->status) {
+      (void)syscall(SYS_futex, &(tkt->status), FUTEX_WAIT, 1, NULL, NULL,\
+        0);
+    }
+  }
+  vmm->rec_num = 0;
+
+  ret = lock_let(&(vmm->rec_lock));
+  ERRCHK(ERREXIT, 0 != ret);
+
+  return 0;
+
+  ERREXIT:
+  return -1;
+}
+
+
+#ifdef TEST
+int
+main(int argc, char * argv[])
+{
+  if (0 == argc || NULL == argv) {}
+
+  return 0;
+}
+#endif
@@ -0,0 +1,247 @@
+/*
+Copyright (c) 2015,2016 Jeremy Iverson
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+
+#ifndef _GNU_SOURCE
+# define _GNU_SOURCE 1
+#endif
+
+
+#include <dlfcn.h>     /* Dl_info, dladdr */
+#include <execinfo.h>  /* backtrace, backtrace_symbols_fd */
+#include <stddef.h>    /* NULL, size_t */
+#include <stdint.h>    /* uintptr_t */
+#include <stdio.h>     /* dprintf */
+#include <string.h>    /* memset */
+#include <sys/mman.h>  /* mmap, munmap */
+#include <unistd.h>    /* getpid, sysconf */
+#include "common.h"
+#include "sbma.h"
+#include "vmm.h"
+
+
+/*****************************************************************************/
+/*  Hash of a backtrace which is the same in every run of a program, i.e.,   */
+/*  of the offsets of the return addresses into their objects, and of the    */
+/*  names of the objects, regardless of where they are loaded.               */
+/*****************************************************************************/
+SBMA_STATIC uint64_t
+vmm_site_pkey(void * const * const frames, int const depth)
+{
+  int i;
+  uint64_t pkey;
+  char const * name;
+  Dl_info info;
+
+  for (pkey=14695981039346656037ULL,i=0; i<depth; ++i) {
+    if (0 == dladdr(frames[i], &info) || NULL == info.dli_fbase)
+      return 0;
+
+    for (name=info.dli_fname; NULL!=name&&'\0'!=*name; ++name) {
+      pkey ^= (uint64_t)(unsigned char)*name;
+      pkey *= 1099511628211ULL;
+    }
+    pkey ^= (uint64_t)((uintptr_t)frames[i]-(uintptr_t)info.dli_fbase);
+    pkey *= 1099511628211ULL;
+  }
+
+  return (0 == pkey) ? 1 : pkey;
+}
+
+
+/*****************************************************************************/
+/*  MT-Safe                                                                  */
+/*                                                                           */
+/*  Note:                                                                    */
+/*    1)  The first call to backtrace() loads the unwinder, which allocates  */
+/*        memory, so it is made before the table is published, while every   */
+/*        allocation is still made without a site.                           */
+/*****************************************************************************/
+SBMA_EXTERN int
+vmm_site_init(struct vmm * const vmm, int const prof)
+{
+  int ret;
+  size_t i;
+  void * frames[VMM_SITE_DEPTH];
+  struct vmm_site * sites;
+
+  if (0 != prof && NULL == vmm->prof) {
+    ret = vmm_prof_load(vmm);
+    if (-1 == ret)
+      return -1;
+  }
+
+  if (NULL != vmm->sites)
+    return 0;
+
+  (void)backtrace(frames, VMM_SITE_DEPTH);
+
+  sites = mmap(NULL, VMM_SITE_MAX*sizeof(*sites), PROT_READ|PROT_WRITE,\
+    MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+  if (MAP_FAILED == sites)
+    return -1;
+
+  /* No site has learned a policy until it is found in the profile. */
+  for (i=0; i<VMM_SITE_MAX; ++i) {
+    sites[i].opts = -1;
+    sites[i].prio = MMU_WARM;
+  }
+
+  /* Another thread may have created the table meanwhile. */
+  if (!__sync_bool_compare_and_swap(&(vmm->sites), NULL, sites)) {
+    ret = munmap(sites, VMM_SITE_MAX*sizeof(*sites));
+    if (-1 == ret)
+      return -1;
+  }
+
+  return 0;
+}
+
+
+/*****************************************************************************/
+/*  MT-Safe                                                                  */
+/*                                                                           */
+/*  Note:                                                                    */
+/*    1)  The frames of the caller are part of the backtrace, they are the   */
+/*        same for every allocation made through the same function.          */
+/*****************************************************************************/
+SBMA_EXTERN struct vmm_site *
+vmm_site(struct vmm * const vmm)
+{
+  int i, depth;
+  size_t ip;
+  uintptr_t key;
+  void * frames[VMM_SITE_DEPTH+1];
+  struct vmm_site * sites, * site;
+
+  sites = vmm->sites;
+  if (NULL == sites)
+    return NULL;
+
+  /* the first frame is this function */
+  depth = backtrace(frames, VMM_SITE_DEPTH+1)-1;
+  if (0 >= depth)
+    return NULL;
+
+  /* FNV-1a hash of the return addresses, 0 marks an unused entry */
+  for (key=(uintptr_t)14695981039346656037ULL,i=1; i<=depth; ++i) {
+    key ^= (uintptr_t)frames[i];
+    key *= (uintptr_t)1099511628211ULL;
+  }
+  if (0 == key)
+    key = 1;
+
+  /* Probe linearly from the hash, claiming the first unused entry. */
+  for (ip=0; ip<VMM_SITE_MAX; ++ip) {
+    site = &(sites[(key+ip)%VMM_SITE_MAX]);
+    if (0 == site->key && __sync_bool_compare_and_swap(&(site->key), 0, key))
+    {
+      site->depth = depth;
+      for (i=0; i<depth; ++i)
+        site->frames[i] = frames[i+1];
+
+      /* A new site takes its policy from the profile, see VMM_PROF. */
+      if (VMM_PROF == (vmm->opts&VMM_PROF)) {
+        site->pkey = vmm_site_pkey(site->frames, depth);
+        vmm_prof_find(vmm, site);
+      }
+      return site;
+    }
+    /* claimed by this site, possibly by another thread meanwhile */
+    if (key == site->key)
+      return site;
+  }
+
+  return NULL;
+}
+
+
+/*****************************************************************************/
+/*  MT-Safe                                                                  */
+/*                                                                           */
+/*  Note:                                                                    */
+/*    1)  The frames are symbolized by backtrace_symbols_fd(), which, unlike */
+/*        backtrace_symbols(), does not allocate memory.                     */
+/*****************************************************************************/
+SBMA_EXTERN int
+vmm_site_report(struct vmm * const vmm, int const fd)
+{
+  int ret;
+  size_t i, j, rank, best;
+  double s_mem;
+  struct vmm_site * sites, * site;
+  char done[VMM_SITE_MAX];
+
+  sites = vmm->sites;
+  if (NULL == sites)
+    return 0;
+
+  s_mem = (double)sysconf(_SC_PAGESIZE)/1024.0/1024.0;
+
+  memset(done, 0, sizeof(done));
+
+  ret = dprintf(fd, "[%5d] allocation sites, ranked by I/O time\n",\
+    (int)getpid());
+  if (0 > ret)
+    return -1;
+
+  /* Rank by selection, the table is small. */
+  for (rank=1; ; ++rank) {
+    for (best=VMM_SITE_MAX,i=0; i<VMM_SITE_MAX; ++i) {
+      if (0 == sites[i].key || 0 != done[i])
+        continue;
+      j = best;
+      if (VMM_SITE_MAX == j || sites[i].tmrio > sites[j].tmrio ||\
+          (sites[i].tmrio == sites[j].tmrio &&\
+           sites[i].numrd+sites[i].numwr > sites[j].numrd+sites[j].numwr))
+      {
+        best = i;
+      }
+    }
+    if (VMM_SITE_MAX == best)
+      break;
+    done[best] = 1;
+
+    site = &(sites[best]);
+    ret = dprintf(fd, "[%5d] #%zu: %.3fs I/O, %zu allocations, %zu/%zu "\
+      "read/write faults, %.1f/%.1f MiB read/written, %zu evictions\n",\
+      (int)getpid(), rank, (double)site->tmrio/1000000000.0, site->numal,\
+      site->numrf, site->numwf, (double)site->numrd*s_mem,\
+      (double)site->numwr*s_mem, site->numev);
+    if (0 > ret)
+      return -1;
+    backtrace_symbols_fd(site->frames, site->depth, fd);
+  }
+
+  return 0;
+}
+
+
+#ifdef TEST
+int
+main(int argc, char * argv[])
+{
+  if (0 == argc || NULL == argv) {}
+
+  return 0;
+}
+#endif
@@ -0,0 +1,168 @@
+/*
+Copyright (c) 2015,2016 Jeremy Iverson
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+
+#ifndef _GNU_SOURCE
+# define _GNU_SOURCE 1
+#endif
+
+
+#include <fcntl.h>    /* O_WRONLY */
+#include <stddef.h>   /* NULL, size_t */
+#include <stdint.h>   /* uint8_t, uintptr_t */
+#include <stdio.h>    /* FILENAME_MAX */
+#include <string.h>   /* snprintf */
+#include <sys/mman.h> /* mprotect */
+#include "common.h"
+#include "mmu.h"
+#include "sbma.h"
+#include "vmm.h"
+
+
+/*****************************************************************************/
+/*  Write dirty pages to file, keeping them resident and charged, and        */
+/*  downgrade their memory protections to read-only, so that the next write  */
+/*  to any of them marks it dirty again.                                     */
+/*                                                                           */
+/*  MT-Unsafe race:ate->*                                                    */
+/*                                                                           */
+/*  Mitigation:                                                              */
+/*    1)  Call only when thread is in possession of ate->lock.               */
+/*****************************************************************************/
+SBMA_EXTERN ssize_t
+vmm_swap_c(struct ate * const ate, size_t const beg, size_t const num)
+{
+  int ret, fd;
+  size_t ip, jp, page_size, end, numwr=0;
+  ssize_t retval, ipfirst;
+  uintptr_t addr;
+  volatile uint8_t * flags;
+  struct timespec tmr;
+  char fname[FILENAME_MAX];
+
+  /* Sanity check input values. */
+  ASSERT(NULL != ate);
+  ASSERT(num <= ate->n_pages);
+  ASSERT(beg <= ate->n_pages-num);
+
+  /* Default return value. */
+  retval = 0;
+
+  TIMER_START(&(tmr));
+
+  /* Shortcut if no pages in range. */
+  if (0 == num)
+    goto RETURN;
+  /* Shortcut if there are no dirty pages. */
+  if (0 == ate->d_pages)
+    goto RETURN;
+
+  /* Setup local variables. */
+  page_size = ate->page_size;
+  addr      = ate->base;
+  flags     = ate->flags;
+  end       = beg+num;
+
+  /* Generate file name. */
+  ret = snprintf(fname, FILENAME_MAX, "%s%d-%zx", _vmm_.fstem, (int)getpid(),\
+    (uintptr_t)ate);
+  ERRCHK(ERREXIT, 0 > ret);
+  /* Open the file for writing. */
+  fd = libc_open(fname, O_WRONLY);
+  ERRCHK(ERREXIT, -1 == fd);
+
+  /* Go over the pages and write the ones that have changed. Perform the writes
+   * in contigous chunks of changed pages. */
+  for (ipfirst=-1,ip=beg; ip<=end; ++ip) {
+    if (ip != end && (MMU_DIRTY == (flags[ip]&MMU_DIRTY))) {
+      if (-1 == ipfirst)
+        ipfirst = ip;
+
+      ASSERT(MMU_RSDNT != (flags[ip]&MMU_RSDNT)); /* is resident */
+      ASSERT(MMU_CHRGD != (flags[ip]&MMU_CHRGD)); /* is charged */
+    }
+    else if (-1 != ipfirst) {
+      /* Downgrade the pages to read-only before writing them, so that a
+       * thread writing to them concurrently faults and waits on ate->lock
+       * instead of having its update lost. */
+      ret = mprotect((void*)(addr+(ipfirst*page_size)),\
+        (ip-ipfirst)*page_size, PROT_READ);
+      ERRCHK(CLEANUP, -1 == ret);
+
+      ret = vmm_write(fd, (void*)(addr+(ipfirst*page_size)),\
+        (ip-ipfirst)*page_size, ipfirst*page_size);
+      ERRCHK(CLEANUP, -1 == ret);
+
+      /* flag: 0001 */
+      for (jp=ipfirst; jp<ip; ++jp)
+        flags[jp] = (flags[jp]&MMU_ATTRS)|MMU_ZFILL;
+
+      numwr += (ip-ipfirst);
+
+      ASSERT(ate->d_pages >= ip-ipfirst);
+      ate->d_pages -= (ip-ipfirst);
+
+      ipfirst = -1;
+    }
+  }
+
+  /* close file */
+  ret = close(fd);
+  ERRCHK(ERREXIT, -1 == ret);
+
+  /***************************************************************************/
+  /* Successful exit -- return numwr. */
+  /***************************************************************************/
+  retval = numwr;
+  goto RETURN;
+
+  /***************************************************************************/
+  /* Error exit -- return -1. */
+  /***************************************************************************/
+  CLEANUP:
+  (void)close(fd);
+  ERREXIT:
+  retval = -1;
+
+  /***************************************************************************/
+  /* Return point -- return. */
+  /***************************************************************************/
+  RETURN:
+  /* Attribute the pages written to the allocation site. */
+  if (0 < retval) {
+    TIMER_STOP(&(tmr));
+    VMM_SITE_TRACK(ate, numwr, VMM_TO_SYS(ate->page_size, retval));
+    VMM_SITE_TRACK(ate, tmrio, VMM_TO_NSEC(&(tmr)));
+  }
+  return retval;
+}
+
+
+#ifdef TEST
+int
+main(int argc, char * argv[])
+{
+  if (0 == argc || NULL == argv) {}
+
+  return 0;
+}
+#endif
@@ -95,6 +95,7 @@ vmm_swap_i(struct ate * const ate, size_t const beg, size_t const num,
   ssize_t ipfirst;
   uintptr_t addr, raddr;
   volatile uint8_t * flags;
+  struct timespec tmr;
   char fname[FILENAME_MAX];
 
   /* Sanity check input values. */
@@ -105,6 +106,8 @@ vmm_swap_i(struct ate * const ate, size_t const beg, size_t const num,
   /* Default return value. */
   retval = 0;
 
+  TIMER_START(&(tmr));
+
   /* Shortcut if no pages in range. */
   if (0 == num)
     goto RETURN;
@@ -115,7 +118,7 @@ vmm_swap_i(struct ate * const ate, size_t const beg, size_t const num,
   }
 
   /* Setup local variables. */
-  page_size = _vmm_.page_size;
+  page_size = ate->page_size;
   flags     = ate->flags;
   end       = beg+num;
 
@@ -234,6 +237,12 @@ vmm_swap_i(struct ate * const ate, size_t const beg, size_t const num,
   /* Return point -- return. */
   /***************************************************************************/
   RETURN:
+  /* Attribute the pages read to the allocation site. */
+  if (0 < retval) {
+    TIMER_STOP(&(tmr));
+    VMM_SITE_TRACK(ate, numrd, VMM_TO_SYS(ate->page_size, retval));
+    VMM_SITE_TRACK(ate, tmrio, VMM_TO_NSEC(&(tmr)));
+  }
   return retval;
 
 }
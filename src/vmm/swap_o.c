@@ -40,46 +40,6 @@ THE SOFTWARE.
 #include "vmm.h"
 
 
-/*****************************************************************************/
-/*  Write data to file.                                                      */
-/*                                                                           */
-/*  MT-Unsafe race:buf                                                       */
-/*                                                                           */
-/*  Mitigation:                                                              */
-/*    1)  Call only when thread is in possession of ate->lock which          */
-/*        corresponds to the buffer in question.                             */
-/*****************************************************************************/
-SBMA_STATIC int
-vmm_write(int const fd, void const * const buf, size_t len, size_t off)
-{
-  ssize_t len_;
-  char * buf_ = (char*)buf;
-
-#ifndef HAVE_PWRITE
-  if (-1 == lseek(fd, off, SEEK_SET))
-    return -1;
-#endif
-
-  do {
-#ifdef HAVE_PWRITE
-    if (-1 == (len_=libc_pwrite(fd, buf_, len, off)))
-      return -1;
-    off += len_;
-#else
-    if (-1 == (len_=libc_write(fd, buf_, len)))
-      return -1;
-#endif
-
-    ASSERT(0 != len_);
-
-    buf_ += len_;
-    len -= len;
-  } while (len > 0);
-
-  return 0;
-}
-
-
 /*****************************************************************************/
 /*  Write dirty pages to file, remove zfill flag from those pages, and       */
 /*  update their memory protections.                                         */
@@ -89,8 +49,8 @@ vmm_write(int const fd, void const * const buf, size_t len, size_t off)
 /*  Mitigation:                                                              */
 /*    1)  Call only when thread is in possession of ate->lock.               */
 /*****************************************************************************/
-SBMA_EXTERN ssize_t
-vmm_swap_o(struct ate * const ate, size_t const beg, size_t const num)
+SBMA_STATIC ssize_t
+vmm_swap_o_int(struct ate * const ate, size_t const beg, size_t const num)
 {
   int retval, ret, fd;
   size_t ip, page_size, end, numwr=0;
@@ -117,7 +77,7 @@ vmm_swap_o(struct ate * const ate, size_t const beg, size_t const num)
     goto RETURN;
 
   /* Setup local variables. */
-  page_size = _vmm_.page_size;
+  page_size = ate->page_size;
   addr      = ate->base;
   flags     = ate->flags;
   end       = beg+num;
@@ -145,7 +105,7 @@ vmm_swap_o(struct ate * const ate, size_t const beg, size_t const num)
       }
 
       /* flag: 101* */
-      flags[ip] &= MMU_ZFILL;
+      flags[ip] &= (MMU_ZFILL|MMU_ATTRS);
       flags[ip] |= (MMU_CHRGD|MMU_RSDNT);
     }
 
@@ -162,9 +122,16 @@ vmm_swap_o(struct ate * const ate, size_t const beg, size_t const num)
       ate->c_pages--;
 
       /* flag: 1011 */
-      flags[ip] = (MMU_CHRGD|MMU_RSDNT|MMU_ZFILL);
+      flags[ip] = (flags[ip]&MMU_ATTRS)|MMU_CHRGD|MMU_RSDNT|MMU_ZFILL;
     }
     else if (-1 != ipfirst) {
+      /* Downgrade the pages to read-only before writing them, so that a
+       * thread writing to them concurrently faults and waits on ate->lock
+       * instead of having its update lost. */
+      ret = mprotect((void*)(addr+(ipfirst*page_size)),\
+        (ip-ipfirst)*page_size, PROT_READ);
+      ERRCHK(ERREXIT, -1 == ret);
+
       ret = vmm_write(fd, (void*)(addr+(ipfirst*page_size)),\
         (ip-ipfirst)*page_size, ipfirst*page_size);
       ERRCHK(ERREXIT, -1 == ret);
@@ -218,6 +185,95 @@ vmm_swap_o(struct ate * const ate, size_t const beg, size_t const num)
 }
 
 
+/*****************************************************************************/
+/*  Evict the pages in range, except for those which are pinned, which are   */
+/*  left resident and charged, and learn the read granularity of the         */
+/*  allocation, see VMM_LEARN_ONE.                                           */
+/*                                                                           */
+/*  MT-Unsafe race:ate->*                                                    */
+/*                                                                           */
+/*  Mitigation:                                                              */
+/*    1)  Call only when thread is in possession of ate->lock.               */
+/*****************************************************************************/
+SBMA_EXTERN ssize_t
+vmm_swap_o(struct ate * const ate, size_t const beg, size_t const num)
+{
+  unsigned frac;
+  size_t ip, end, l_pages;
+  ssize_t ipfirst, numwr, numwr_;
+  volatile uint8_t * flags;
+  struct timespec tmr;
+
+  /* Sample the fraction of the allocation which was loaded for its site, as
+   * for the allocation itself below, but only while it is read lazily, see
+   * VMM_PROF. */
+  if (VMM_LZYRD == (ate->opts&VMM_LZYRD) && 0 == beg &&\
+      ate->n_pages == num && 0 != ate->l_pages && 0 == ate->r_bulk)
+  {
+    VMM_SITE_TRACK(ate, numld, VMM_TO_SYS(ate->page_size, ate->l_pages));
+    VMM_SITE_TRACK(ate, numsz, VMM_TO_SYS(ate->page_size, ate->n_pages));
+  }
+
+  /* Sample the fraction of the allocation which was loaded, if it is being
+   * evicted whole, unless it was read more than a page at a time. The first
+   * sample, and those taken while the allocation is otherwise read in bulk,
+   * which are few, replace the average. */
+  if (VMM_LEARN == (ate->opts&VMM_LEARN) && 0 == beg &&\
+      ate->n_pages == num && 0 != ate->l_pages)
+  {
+    if (0 == ate->r_bulk) {
+      frac = (unsigned)((ate->l_pages*VMM_LEARN_ONE)/ate->n_pages);
+      if (0 == ate->r_cnt || VMM_LEARN_LO <= ate->r_frac)
+        ate->r_frac = frac;
+      else
+        ate->r_frac = ((VMM_LEARN_DECAY-1)*ate->r_frac+frac)/VMM_LEARN_DECAY;
+    }
+    ate->r_cnt++;
+    ate->r_bulk = 0;
+  }
+
+  flags   = ate->flags;
+  end     = beg+num;
+  l_pages = ate->l_pages;
+
+  TIMER_START(&(tmr));
+
+  /* Evict the contiguous chunks of unpinned pages, or the whole range at
+   * once if there are no pinned pages. */
+  if (0 == ate->p_pages) {
+    numwr = vmm_swap_o_int(ate, beg, num);
+    if (-1 == numwr)
+      return -1;
+  }
+  else {
+    for (numwr=0,ipfirst=-1,ip=beg; ip<=end; ++ip) {
+      if (ip != end && MMU_PINND != (flags[ip]&MMU_PINND)) {
+        if (-1 == ipfirst)
+          ipfirst = ip;
+      }
+      else if (-1 != ipfirst) {
+        numwr_ = vmm_swap_o_int(ate, ipfirst, ip-ipfirst);
+        if (-1 == numwr_)
+          return -1;
+        numwr += numwr_;
+
+        ipfirst = -1;
+      }
+    }
+  }
+
+  /* Attribute the eviction and the pages written to the allocation site. */
+  if (ate->l_pages < l_pages) {
+    TIMER_STOP(&(tmr));
+    VMM_SITE_TRACK(ate, numev, 1);
+    VMM_SITE_TRACK(ate, numwr, VMM_TO_SYS(ate->page_size, numwr));
+    VMM_SITE_TRACK(ate, tmrio, VMM_TO_NSEC(&(tmr)));
+  }
+
+  return numwr;
+}
+
+
 #ifdef TEST
 int
 main(int argc, char * argv[])
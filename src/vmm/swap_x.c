@@ -64,7 +64,7 @@ vmm_swap_x(struct ate * const ate, size_t const beg, size_t const num)
   /* TODO Shortcut if there are no dirty pages AND no pages stored on disk. */
 
   /* Setup local variables. */
-  page_size = _vmm_.page_size;
+  page_size = ate->page_size;
   flags     = ate->flags;
   end       = beg+num;
 
@@ -0,0 +1,85 @@
+/*
+Copyright (c) 2015,2016 Jeremy Iverson
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+
+#ifndef _GNU_SOURCE
+# define _GNU_SOURCE 1
+#endif
+
+
+#include <stddef.h>    /* size_t */
+#include <sys/types.h> /* ssize_t */
+#include <unistd.h>    /* lseek */
+#include "common.h"
+#include "sbma.h"
+#include "vmm.h"
+
+
+/*****************************************************************************/
+/*  Write data to file.                                                      */
+/*                                                                           */
+/*  MT-Unsafe race:buf                                                       */
+/*                                                                           */
+/*  Mitigation:                                                              */
+/*    1)  Call only when thread is in possession of ate->lock which          */
+/*        corresponds to the buffer in question.                             */
+/*****************************************************************************/
+SBMA_EXTERN int
+vmm_write(int const fd, void const * const buf, size_t len, size_t off)
+{
+  ssize_t len_;
+  char * buf_ = (char*)buf;
+
+#ifndef HAVE_PWRITE
+  if (-1 == lseek(fd, off, SEEK_SET))
+    return -1;
+#endif
+
+  do {
+#ifdef HAVE_PWRITE
+    if (-1 == (len_=libc_pwrite(fd, buf_, len, off)))
+      return -1;
+    off += len_;
+#else
+    if (-1 == (len_=libc_write(fd, buf_, len)))
+      return -1;
+#endif
+
+    ASSERT(0 != len_);
+
+    buf_ += len_;
+    len -= len_;
+  } while (len > 0);
+
+  return 0;
+}
+
+
+#ifdef TEST
+int
+main(int argc, char * argv[])
+{
+  if (0 == argc || NULL == argv) {}
+
+  return 0;
+}
+#endif